@@ -0,0 +1,352 @@
+//
+//  ECSimBatchSimulator.cpp
+//
+//
+//
+
+#include "ECSimBatchSimulator.h"
+#include "ECSimTaskScheduler.h"
+#include "ECSimTaskScheduler2.h"
+#include "ECSimWorkloadTasks.h"
+#include <algorithm>
+using namespace std;
+
+namespace ecsim
+{
+
+static const char *batchPolicyNames[EC_NUM_BATCH_POLICIES] = {"fifo", "lwtf", "rr", "priority"};
+
+// Flags of a task in a policy: a consecutive task ran an odd number of ticks (as ECConsecutiveIntervalTask's
+// FLAG_STARTED); the task is finished for the policy (retired, a hard task that waited, a consecutive one interrupted)
+static const unsigned char FLAG_STARTED = 1;
+static const unsigned char FLAG_DONE = 2;
+
+// Flat kind of an ECSimTask/ECSimTask2 kind
+static ECSimFlatTaskKind GetFlatKind(int kind)
+{
+    switch (kind)
+    {
+    case EC_HARD_INTERVAL:
+        return EC_FLAT_HARD_INTERVAL;
+    case EC_CONSECUTIVE_INTERVAL:
+        return EC_FLAT_CONSECUTIVE_INTERVAL;
+    case EC_PERIODIC:
+        return EC_FLAT_PERIODIC;
+    case EC_MULTI_INTERVALS:
+        return EC_FLAT_MULTI_INTERVALS;
+    default:
+        return EC_FLAT_SOFT_INTERVAL;
+    }
+}
+
+void ECSimBatchSimulator ::AddPolicy(int policy)
+{
+    listPolicies.push_back(policy);
+}
+
+ECSimTaskScheduler *ECSimBatchSimulator ::CreateScheduler(int policy)
+{
+    switch (policy)
+    {
+    case EC_POLICY_LWTF:
+        return new ECSimLWTFTaskScheduler;
+    case EC_POLICY_ROUND_ROBIN:
+        return new ECSimRoundRobinTaskScheduler;
+    case EC_POLICY_PRIORITY:
+        return new ECSimPriorityScheduler;
+    default:
+        return new ECSimFIFOTaskScheduler;
+    }
+}
+
+const char *ECSimBatchSimulator ::GetPolicyName(int policy)
+{
+    return batchPolicyNames[policy];
+}
+
+bool ECSimBatchSimulator ::Simulate(const ECSimWorkload &workload, ECSimTime duration)
+{
+    listResults.assign(listPolicies.size(), ECSimBatchResult());
+    for (size_t p = 0; p < listPolicies.size(); ++p)
+    {
+        listResults[p].policy = listPolicies[p];
+    }
+    fShared = Load(workload);
+    if (fShared)
+    {
+        SimulateShared(duration);
+        return true;
+    }
+    return SimulateFull(workload, duration);
+}
+
+// Read the top-level tasks into the shared arrays; false if some task isn't an ECSimTask/ECSimTask2 one
+bool ECSimBatchSimulator ::Load(const ECSimWorkload &workload)
+{
+    listKinds.clear();
+    listPriorities.clear();
+    listRunLens.clear();
+    listPeriods.clear();
+    listIntervalStarts.clear();
+    listIntervalEnds.clear();
+    listIntervalPos.assign(1, 0);
+    listActivate.clear();
+    listFinish.clear();
+    for (const auto &spec : workload.GetSpecs())
+    {
+        if (spec.kind > EC_MULTI_INTERVALS || !spec.listDecorators.empty() || !spec.listSubtasks.empty() ||
+            (spec.kind == EC_PERIODIC && spec.runLen + spec.sleepLen <= 0) ||
+            (spec.kind == EC_MULTI_INTERVALS && spec.listIntervals.empty()))
+        {
+            return false;
+        }
+    }
+    for (const auto &spec : workload.GetSpecs())
+    {
+        if (spec.fSubtask)
+        {
+            continue;
+        }
+        ECSimFlatTaskKind kind = GetFlatKind(spec.kind);
+        listKinds.push_back(kind);
+        listPriorities.push_back(ECSimTask::ClampPriority(spec.priority));
+        listRunLens.push_back(spec.runLen);
+        listPeriods.push_back((ECSimTime)spec.runLen + spec.sleepLen);
+        size_t posFirst = listIntervalStarts.size();
+        if (kind == EC_FLAT_MULTI_INTERVALS)
+        {
+            for (const auto &interval : spec.listIntervals)
+            {
+                listIntervalStarts.push_back(interval.first);
+                listIntervalEnds.push_back(interval.second);
+            }
+        }
+        else
+        {
+            listIntervalStarts.push_back(spec.tmStart);
+            listIntervalEnds.push_back(kind == EC_FLAT_PERIODIC ? spec.tmStart : spec.tmEnd);
+        }
+        listIntervalPos.push_back(listIntervalStarts.size());
+        // as the tasks' IsFinished and GetStartTime
+        ECSimTime tmFinish = ECSimFlatFinishTick(kind, &listIntervalEnds[posFirst], (int)(listIntervalEnds.size() - posFirst), EC_TIME_MAX);
+        ECSimTime tmFirst = *std::min_element(listIntervalStarts.begin() + posFirst, listIntervalStarts.end());
+        listActivate.push_back(min(tmFirst, tmFinish));
+        listFinish.push_back(tmFinish);
+    }
+    return true;
+}
+
+// Is a task ready at a tick by its time alone (a hard or consecutive task may be done for some policy)?
+bool ECSimBatchSimulator ::IsTimeReady(int index, ECSimTime tick) const
+{
+    size_t pos = listIntervalPos[index];
+    return ECSimFlatIsTimeReady(listKinds[index], tick, &listIntervalStarts[pos], &listIntervalEnds[pos], (int)(listIntervalPos[index + 1] - pos),
+                                listRunLens[index], listPeriods[index]);
+}
+
+// The task a policy runs among the ready ones (-1 if none), as its scheduler's ChooseTaskToSchedule
+int ECSimBatchSimulator ::Choose(int policy, const PolicyState &state) const
+{
+    int indexNext = -1;
+    for (int index : listTimeReady)
+    {
+        if (state.listFlags[index] & FLAG_DONE)
+        {
+            continue;
+        }
+        if (indexNext < 0)
+        {
+            indexNext = index;
+            if (policy == EC_POLICY_FIFO)
+            {
+                break;
+            }
+        }
+        else if (ECSimFlatPrefers(policy, state.listWait[index], state.listRun[index], listPriorities[index],
+                                  state.listWait[indexNext], state.listRun[indexNext], listPriorities[indexNext]))
+        {
+            indexNext = index;
+        }
+    }
+    return indexNext;
+}
+
+// One pass over the ticks for all the policies: each tick, the tasks are activated, retired and checked for
+// readiness once; then each policy chooses among those it hasn't finished, and counts
+void ECSimBatchSimulator ::SimulateShared(ECSimTime duration)
+{
+    int numTasks = (int)listKinds.size();
+    vector<PolicyState> listStates(listPolicies.size());
+    for (auto &state : listStates)
+    {
+        state.listRun.assign(numTasks, 0);
+        state.listWait.assign(numTasks, 0);
+        state.listFlags.assign(numTasks, 0);
+        state.numLeft = numTasks;
+        state.indexLoaded = -1;
+        state.fDone = false;
+    }
+    int numLive = (int)listStates.size();
+
+    // tasks not yet active, by the tick they get active (then workload order), and the active ones in workload order
+    vector<int> listPending(numTasks);
+    for (int i = 0; i < numTasks; ++i)
+    {
+        listPending[i] = i;
+    }
+    std::stable_sort(listPending.begin(), listPending.end(), [this](int x, int y)
+                     { return listActivate[x] < listActivate[y]; });
+    size_t posPending = 0;
+    vector<int> listActive;
+
+    ECSimTime durationUse = duration < 0 ? EC_TIME_MAX : duration;
+    ECSimTime tmCur = 0;
+    while (numLive > 0 && tmCur < durationUse && tmCur < EC_TIME_MAX)
+    {
+        ECSimTime tick = tmCur + 1;
+        if (listActive.empty() && posPending < listPending.size() && listActivate[listPending[posPending]] > tick)
+        {
+            // nothing is active until the next task is: the ticks before are idle under every policy
+            tmCur += min(listActivate[listPending[posPending]] - tick, durationUse - tmCur);
+            continue;
+        }
+
+        size_t numOld = listActive.size();
+        while (posPending < listPending.size() && listActivate[listPending[posPending]] <= tick)
+        {
+            listActive.push_back(listPending[posPending++]);
+        }
+        if (listActive.size() > numOld)
+        {
+            std::sort(listActive.begin() + numOld, listActive.end());
+            std::inplace_merge(listActive.begin(), listActive.begin() + numOld, listActive.end());
+        }
+
+        // retire the tasks finished by their time from every policy, and find the ready ones
+        listTimeReady.clear();
+        size_t numKept = 0;
+        for (int index : listActive)
+        {
+            if (listFinish[index] <= tick)
+            {
+                for (auto &state : listStates)
+                {
+                    if (!(state.listFlags[index] & FLAG_DONE))
+                    {
+                        state.listFlags[index] |= FLAG_DONE;
+                        --state.numLeft;
+                    }
+                }
+                continue;
+            }
+            listActive[numKept++] = index;
+            if (IsTimeReady(index, tick))
+            {
+                listTimeReady.push_back(index);
+            }
+        }
+        listActive.resize(numKept);
+
+        for (size_t p = 0; p < listStates.size(); ++p)
+        {
+            PolicyState &state = listStates[p];
+            ECSimBatchResult &result = listResults[p];
+            if (state.fDone)
+            {
+                continue;
+            }
+            if (state.numLeft == 0)
+            {
+                // no task left: the policy's simulation stops before this tick
+                state.fDone = true;
+                result.numTicks = tmCur;
+                --numLive;
+                continue;
+            }
+            int indexNext = Choose(listPolicies[p], state);
+            if (indexNext >= 0)
+            {
+                if (indexNext != state.indexLoaded)
+                {
+                    ++result.numSwitches;
+                    state.indexLoaded = indexNext;
+                }
+                ++result.numBusyTicks;
+                ++state.listRun[indexNext];
+                if (listKinds[indexNext] == EC_FLAT_CONSECUTIVE_INTERVAL)
+                {
+                    state.listFlags[indexNext] ^= FLAG_STARTED;
+                }
+            }
+            for (int index : listTimeReady)
+            {
+                unsigned char &flags = state.listFlags[index];
+                if (index == indexNext || (flags & FLAG_DONE))
+                {
+                    continue;
+                }
+                ++state.listWait[index];
+                ++result.tmTotWait;
+                // a hard task that waits is finished; so is a consecutive one that waits once started
+                if (listKinds[index] == EC_FLAT_HARD_INTERVAL || (listKinds[index] == EC_FLAT_CONSECUTIVE_INTERVAL && (flags & FLAG_STARTED)))
+                {
+                    flags |= FLAG_DONE;
+                    --state.numLeft;
+                }
+            }
+        }
+        tmCur = tick;
+    }
+
+    for (size_t p = 0; p < listStates.size(); ++p)
+    {
+        if (!listStates[p].fDone)
+        {
+            listResults[p].numTicks = tmCur;
+        }
+        listResults[p].listRunTimes.swap(listStates[p].listRun);
+        listResults[p].listWaitTimes.swap(listStates[p].listWait);
+    }
+}
+
+// Build the tasks and simulate them under each policy in turn
+bool ECSimBatchSimulator ::SimulateFull(const ECSimWorkload &workload, ECSimTime duration)
+{
+    ECSimTime durationUse = duration < 0 ? EC_TIME_MAX : duration;
+    for (size_t p = 0; p < listPolicies.size(); ++p)
+    {
+        ECSimBatchResult &result = listResults[p];
+        ECSimTaskScheduler *pScheduler = CreateScheduler(listPolicies[p]);
+        ECSimWorkloadTasks tasks;
+        if (!tasks.Build(workload, pScheduler))
+        {
+            delete pScheduler;
+            return false;
+        }
+        while (result.numTicks < durationUse)
+        {
+            ECSimTime numTicks = pScheduler->Step(durationUse - result.numTicks);
+            if (numTicks == 0)
+            {
+                break;
+            }
+            result.numTicks += numTicks;
+            bool fBusy = pScheduler->GetCurrTask() != NULL;
+            result.numBusyTicks += fBusy ? 1 : 0;
+            result.tmTotWait += pScheduler->GetNumReady() - (fBusy ? 1 : 0);
+        }
+        result.numSwitches = pScheduler->GetNumSwitches();
+        for (auto x : tasks.GetTasks())
+        {
+            result.listRunTimes.push_back(x->GetTotRunTime64());
+            result.listWaitTimes.push_back(x->GetTotWaitTime64());
+        }
+#ifdef ECSIM_PERF_COUNTERS
+        perfFull.Add(pScheduler->GetPerfCounters());
+#endif
+        delete pScheduler;
+    }
+    return true;
+}
+
+} // namespace ecsim
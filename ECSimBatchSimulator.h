@@ -0,0 +1,146 @@
+//
+//  ECSimBatchSimulator.h
+//
+//
+//  What-if comparison of scheduling policies: simulate one scenario (a workload) under several policies at once.
+//  The tasks are not built once per policy; the workload is read into flat arrays, and each tick the tasks whose
+//  interval (or period) admits the tick are found once and shared by all the policies. What a policy changes, the
+//  run / wait time of each task and the flags of hard and consecutive tasks, lives in arrays of its own, so each
+//  more policy only costs choosing among the ready tasks and counting. The tasks and policies follow the flat task
+//  model (ECSimFlatTask.h), as the compile-time schedules do.
+//
+//      ECSimBatchSimulator sim;
+//      sim.AddPolicy(EC_POLICY_FIFO); sim.AddPolicy(EC_POLICY_PRIORITY); ...
+//      sim.Simulate(workload, 100000);
+//      sim.GetResults()[1].tmTotWait      // as ECSimPriorityScheduler would have it
+//
+//  The results are those of a full simulation of each policy (without context switch cost). Workloads with
+//  ECSimTask3 tasks (decorators, composites) are simulated in full, one policy after the other
+//
+
+#ifndef ECSimBatchSimulator_h
+#define ECSimBatchSimulator_h
+
+#include <vector>
+#include "ECSimTime.h"
+#include "ECSimWorkload.h"
+#include "ECSimFlatTask.h"
+#include "ECSimPerfCounters.h"
+
+namespace ecsim
+{
+
+class ECSimTaskScheduler;
+
+//***********************************************************
+// Policies
+
+// those of the flat task model (EC_POLICY_FIFO, ...)
+typedef ECSimFlatPolicy ECSimBatchPolicy;
+const int EC_NUM_BATCH_POLICIES = EC_NUM_FLAT_POLICIES;
+
+//***********************************************************
+// What a simulation under one policy left
+
+struct ECSimBatchResult
+{
+    ECSimBatchResult() : policy(EC_POLICY_FIFO), numTicks(0), numBusyTicks(0), tmTotWait(0), numSwitches(0) {}
+
+    int policy;
+    // ticks simulated, as Simulate64 returns, and those in which some task ran
+    ECSimTime numTicks;
+    long long numBusyTicks;
+    // ticks waited by all tasks, and times a different task was chosen than the one before
+    long long tmTotWait;
+    long long numSwitches;
+    // run and wait time of each top-level task, in workload order
+    std::vector<ECSimTime> listRunTimes;
+    std::vector<ECSimTime> listWaitTimes;
+};
+
+//***********************************************************
+// Simulation of a scenario under several policies
+
+class ECSimBatchSimulator
+{
+public:
+    ECSimBatchSimulator() : fShared(false) {}
+
+    // Add a policy to compare (ECSimBatchPolicy); its results are in the same place of GetResults
+    void AddPolicy(int policy);
+    const std::vector<int> &GetPolicies() const { return listPolicies; }
+
+    // Simulate the workload for duration ticks (< 0: until no task is left) under every policy.
+    // Return false if the workload can't be built (a composite lists a later subtask)
+    bool Simulate(const ECSimWorkload &workload, ECSimTime duration);
+
+    // Results of the last Simulate, one per policy
+    const std::vector<ECSimBatchResult> &GetResults() const { return listResults; }
+
+    // Was the last Simulate a shared pass (no ECSimTask3 tasks), or a full simulation of each policy?
+    bool IsShared() const { return fShared; }
+
+    // A scheduler with the policy, and the name of a policy
+    static ECSimTaskScheduler *CreateScheduler(int policy);
+    static const char *GetPolicyName(int policy);
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of the schedulers of full simulations so far to perf (to print once the run is over);
+    // shared passes use no scheduler
+    void AddPerfCounters(ECSimPerfCounters &perf) const { perf.Add(perfFull); }
+#endif
+
+private:
+    ECSimBatchSimulator(const ECSimBatchSimulator &);
+    ECSimBatchSimulator &operator=(const ECSimBatchSimulator &);
+
+    // State of one policy: counters and flags of each task (indexed as the shared arrays), and its totals
+    struct PolicyState
+    {
+        std::vector<ECSimTime> listRun;
+        std::vector<ECSimTime> listWait;
+        std::vector<unsigned char> listFlags;
+        int numLeft;
+        int indexLoaded;
+        bool fDone;
+    };
+
+    bool Load(const ECSimWorkload &workload);
+    void SimulateShared(ECSimTime duration);
+    bool SimulateFull(const ECSimWorkload &workload, ECSimTime duration);
+    bool IsTimeReady(int index, ECSimTime tick) const;
+    int Choose(int policy, const PolicyState &state) const;
+
+    std::vector<int> listPolicies;
+    std::vector<ECSimBatchResult> listResults;
+    bool fShared;
+#ifdef ECSIM_PERF_COUNTERS
+    ECSimPerfCounters perfFull;
+#endif
+
+    // the top-level tasks of the workload, one array per field; the intervals of task i (one but for multi-interval
+    // tasks; [start, start] for periodic ones) are at [listIntervalPos[i], listIntervalPos[i + 1]) of
+    // listIntervalStarts / listIntervalEnds
+    std::vector<ECSimFlatTaskKind> listKinds;
+    std::vector<int> listPriorities;
+    std::vector<ECSimTime> listRunLens;
+    std::vector<ECSimTime> listPeriods;
+    std::vector<ECSimTime> listIntervalStarts;
+    std::vector<ECSimTime> listIntervalEnds;
+    std::vector<size_t> listIntervalPos;
+    // first tick a task can be ready or finished, and first tick it is finished whatever it did (EC_TIME_MAX: never)
+    std::vector<ECSimTime> listActivate;
+    std::vector<ECSimTime> listFinish;
+
+    // tasks ready by their time at the current tick, in workload order
+    std::vector<int> listTimeReady;
+};
+
+} // namespace ecsim
+
+using ecsim::ECSimBatchPolicy;
+using ecsim::EC_NUM_BATCH_POLICIES;
+using ecsim::ECSimBatchResult;
+using ecsim::ECSimBatchSimulator;
+
+#endif /* ECSimBatchSimulator_h */
@@ -0,0 +1,285 @@
+//
+//  ECSimDifferential.cpp
+//
+//
+//
+
+#include "ECSimDifferential.h"
+#include <sstream>
+#include <climits>
+#include <algorithm>
+using namespace std;
+
+//***********************************************************
+// Workload edits used by the shrinker
+
+// Copy of the workload without the flagged tasks; removing a composite removes its subtasks too,
+// and removed subtasks are dropped from their composite
+static ECSimWorkload RemoveTasks(const ECSimWorkload &workload, vector<bool> listRemove)
+{
+    const vector<ECSimTaskSpec> &listSpecs = workload.GetSpecs();
+    // subtasks come before their composite: walk backwards
+    for (int i = (int)listSpecs.size() - 1; i >= 0; --i)
+    {
+        if (listRemove[i])
+        {
+            for (int index : listSpecs[i].listSubtasks)
+            {
+                listRemove[index] = true;
+            }
+        }
+    }
+    vector<int> listNewIndex(listSpecs.size(), -1);
+    ECSimWorkload res;
+    for (size_t i = 0; i < listSpecs.size(); ++i)
+    {
+        if (listRemove[i])
+        {
+            continue;
+        }
+        ECSimTaskSpec spec = listSpecs[i];
+        spec.listSubtasks.clear();
+        for (int index : listSpecs[i].listSubtasks)
+        {
+            if (listNewIndex[index] >= 0)
+            {
+                spec.listSubtasks.push_back(listNewIndex[index]);
+            }
+        }
+        listNewIndex[i] = (int)res.GetSpecs().size();
+        res.GetSpecs().push_back(spec);
+    }
+    return res;
+}
+
+static vector<int> GetTopLevel(const ECSimWorkload &workload)
+{
+    vector<int> listTop;
+    for (size_t i = 0; i < workload.GetSpecs().size(); ++i)
+    {
+        if (!workload.GetSpecs()[i].fSubtask)
+        {
+            listTop.push_back((int)i);
+        }
+    }
+    return listTop;
+}
+
+// Shorter variant of a task (its intervals halved); false if it is already as short as it gets
+static bool ShortenTask(ECSimTaskSpec &spec)
+{
+    switch (spec.kind)
+    {
+    case EC_COMPOSITE3:
+        return false;
+    case EC_PERIODIC:
+        if (spec.runLen <= 1 && spec.sleepLen <= 1)
+        {
+            return false;
+        }
+        spec.runLen = max(1, spec.runLen / 2);
+        spec.sleepLen = max(1, spec.sleepLen / 2);
+        return true;
+    case EC_MULTI_INTERVALS:
+        if (spec.listIntervals.size() > 1)
+        {
+            spec.listIntervals.pop_back();
+            return true;
+        }
+        if (spec.listIntervals.empty() || spec.listIntervals[0].second <= spec.listIntervals[0].first)
+        {
+            return false;
+        }
+        spec.listIntervals[0].second = spec.listIntervals[0].first + (spec.listIntervals[0].second - spec.listIntervals[0].first) / 2;
+        return true;
+    default:
+        if (spec.tmEnd <= spec.tmStart)
+        {
+            return false;
+        }
+        spec.tmEnd = spec.tmStart + (spec.tmEnd - spec.tmStart) / 2;
+        return true;
+    }
+}
+
+// Move every time in the workload earlier by delta
+static void ShiftTimes(ECSimWorkload &workload, int delta)
+{
+    for (auto &spec : workload.GetSpecs())
+    {
+        spec.tmStart -= delta;
+        spec.tmEnd -= delta;
+        for (auto &interval : spec.listIntervals)
+        {
+            interval.first -= delta;
+            interval.second -= delta;
+        }
+        for (auto &decor : spec.listDecorators)
+        {
+            if (decor.first == EC_DECOR_START_DEADLINE || decor.first == EC_DECOR_END_DEADLINE)
+            {
+                decor.second -= delta;
+            }
+        }
+    }
+}
+
+//***********************************************************
+// Differential runs
+
+ECSimDifferential ::ECSimDifferential(const ECSimEngine &engineRefIn, const ECSimEngine &engineCandIn) : engineRef(engineRefIn), engineCand(engineCandIn), numComparisons(0)
+{
+}
+
+bool ECSimDifferential ::Compare(const ECSimWorkload &workload, string &diff) const
+{
+    ++numComparisons;
+    ECSimRunResult resRef = engineRef(workload);
+    ECSimRunResult resCand = engineCand(workload);
+    ostringstream out;
+    if (resRef.tmSimRun != resCand.tmSimRun)
+    {
+        out << "Simulate returned " << resRef.tmSimRun << " (reference) vs " << resCand.tmSimRun << " (candidate)";
+    }
+    else if (resRef.listIds != resCand.listIds)
+    {
+        out << "different task lists: " << resRef.listIds.size() << " vs " << resCand.listIds.size() << " tasks";
+    }
+    else
+    {
+        for (size_t i = 0; i < resRef.listIds.size(); ++i)
+        {
+            if (resRef.listRun[i] != resCand.listRun[i] || resRef.listWait[i] != resCand.listWait[i])
+            {
+                out << "task " << resRef.listIds[i] << ": run " << resRef.listRun[i] << " vs " << resCand.listRun[i]
+                    << ", wait " << resRef.listWait[i] << " vs " << resCand.listWait[i];
+                break;
+            }
+        }
+    }
+    diff = out.str();
+    return diff.empty();
+}
+
+bool ECSimDifferential ::Mismatch(const ECSimWorkload &workload) const
+{
+    string diff;
+    return !Compare(workload, diff);
+}
+
+ECSimWorkload ECSimDifferential ::Shrink(const ECSimWorkload &workload) const
+{
+    ECSimWorkload cur = workload;
+    bool fProgress = true;
+    while (fProgress)
+    {
+        fProgress = false;
+
+        // drop top-level tasks, in chunks of halving size
+        vector<int> listTop = GetTopLevel(cur);
+        for (size_t chunk = max((size_t)1, listTop.size() / 2); chunk >= 1 && listTop.size() > 1; chunk /= 2)
+        {
+            size_t pos = 0;
+            while (pos < listTop.size() && listTop.size() > 1)
+            {
+                vector<bool> listRemove(cur.GetSpecs().size(), false);
+                for (size_t i = pos; i < min(listTop.size(), pos + chunk); ++i)
+                {
+                    listRemove[listTop[i]] = true;
+                }
+                ECSimWorkload cand = RemoveTasks(cur, listRemove);
+                if (Mismatch(cand))
+                {
+                    cur = cand;
+                    listTop = GetTopLevel(cur);
+                    fProgress = true;
+                }
+                else
+                {
+                    pos += chunk;
+                }
+            }
+        }
+
+        // drop subtasks of composites
+        for (int i = (int)cur.GetSpecs().size() - 1; i >= 0; --i)
+        {
+            if (i < (int)cur.GetSpecs().size() && cur.GetSpecs()[i].fSubtask)
+            {
+                vector<bool> listRemove(cur.GetSpecs().size(), false);
+                listRemove[i] = true;
+                ECSimWorkload cand = RemoveTasks(cur, listRemove);
+                if (Mismatch(cand))
+                {
+                    cur = cand;
+                    fProgress = true;
+                }
+            }
+        }
+
+        // drop decorators and shorten intervals
+        for (size_t i = 0; i < cur.GetSpecs().size(); ++i)
+        {
+            for (size_t k = cur.GetSpecs()[i].listDecorators.size(); k-- > 0;)
+            {
+                ECSimWorkload cand = cur;
+                vector<pair<int, int> > &listDecorators = cand.GetSpecs()[i].listDecorators;
+                listDecorators.erase(listDecorators.begin() + k);
+                if (Mismatch(cand))
+                {
+                    cur = cand;
+                    fProgress = true;
+                }
+            }
+            while (true)
+            {
+                ECSimWorkload cand = cur;
+                if (!ShortenTask(cand.GetSpecs()[i]) || !Mismatch(cand))
+                {
+                    break;
+                }
+                cur = cand;
+                fProgress = true;
+            }
+        }
+
+        // move everything so the first task starts at tick 1
+        int tmFirst = INT_MAX;
+        for (const auto &spec : cur.GetSpecs())
+        {
+            if (spec.kind != EC_COMPOSITE3)
+            {
+                tmFirst = min(tmFirst, spec.kind == EC_MULTI_INTERVALS && !spec.listIntervals.empty() ? spec.listIntervals[0].first : spec.tmStart);
+            }
+        }
+        if (tmFirst != INT_MAX && tmFirst > 1)
+        {
+            ECSimWorkload cand = cur;
+            ShiftTimes(cand, tmFirst - 1);
+            if (Mismatch(cand))
+            {
+                cur = cand;
+                fProgress = true;
+            }
+        }
+    }
+    return cur;
+}
+
+bool ECSimDifferential ::Run(const ECSimWorkloadConfig &config, int numScenarios, ECSimWorkload &repro, string &diff) const
+{
+    for (int i = 0; i < numScenarios; ++i)
+    {
+        ECSimWorkloadConfig configRun = config;
+        configRun.seed = config.seed + i;
+        ECSimWorkload workload;
+        ECSimWorkloadGenerator(configRun).Generate(workload);
+        if (!Compare(workload, diff))
+        {
+            repro = Shrink(workload);
+            Compare(repro, diff);
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+//
+//  ECSimDifferential.h
+//
+//
+//  Differential validation: run the same workload through the reference
+//  Simulate loop and a candidate engine (timing wheel, or any later fast path),
+//  compare the Simulate return value and every task's run / wait time, and
+//  shrink a mismatching workload to a small reproducer.
+//  Engines are plain functions, so the harness works for either task hierarchy.
+//  The reference of the diff drivers is the same scheduler with the timing wheel
+//  off: it catches a candidate path that strays from the plain loop, not a bug in
+//  what both share (task kinds, composites, retirement, the policies); those need
+//  tests against known results.
+//
+
+#ifndef ECSimDifferential_h
+#define ECSimDifferential_h
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "ECSimWorkload.h"
+#include "ECSimTime.h"
+
+//***********************************************************
+// What an engine produced for one workload
+
+struct ECSimRunResult
+{
+    ECSimRunResult() : tmSimRun(0) {}
+
+    // Simulate64 return value
+    ECSimTime tmSimRun;
+    // per task (in the order of the engine's task list): id, total run time, total wait time
+    std::vector<std::string> listIds;
+    std::vector<ECSimTime> listRun;
+    std::vector<ECSimTime> listWait;
+};
+
+// Build the workload's tasks, simulate, and report
+typedef std::function<ECSimRunResult(const ECSimWorkload &)> ECSimEngine;
+
+//***********************************************************
+
+class ECSimDifferential
+{
+public:
+    ECSimDifferential(const ECSimEngine &engineRef, const ECSimEngine &engineCand);
+
+    // Run both engines; return false on any mismatch and describe the first one in diff
+    bool Compare(const ECSimWorkload &workload, std::string &diff) const;
+
+    // Smallest workload found (by removing tasks, subtasks and decorators, shortening
+    // intervals and moving everything earlier) that still mismatches
+    ECSimWorkload Shrink(const ECSimWorkload &workload) const;
+
+    // Generate numScenarios workloads (seeds config.seed, config.seed+1, ...) and compare each.
+    // On the first mismatch, return false with the shrunk reproducer and its diff
+    bool Run(const ECSimWorkloadConfig &config, int numScenarios, ECSimWorkload &repro, std::string &diff) const;
+
+    // Number of engine pairs run so far (both engines count as one)
+    int GetNumComparisons() const { return numComparisons; }
+
+private:
+    bool Mismatch(const ECSimWorkload &workload) const;
+
+    ECSimEngine engineRef;
+    ECSimEngine engineCand;
+    mutable int numComparisons;
+};
+
+#endif /* ECSimDifferential_h */
@@ -0,0 +1,109 @@
+//
+//  ECSimFlatTask.h
+//
+//
+//  Flat task model: the rules of the ECSimTask / ECSimTask2 interval and periodic kinds, and of the FIFO, LWTF,
+//  round-robin and priority policies, on plain fields instead of task objects. The compile-time schedules
+//  (ECSimStaticSchedule.h, with int ticks) and the batch simulator (ECSimBatchSimulator.h, with ECSimTime ticks)
+//  both go by these, so the rules are written once next to the task classes' own
+//
+
+#ifndef ECSimFlatTask_h
+#define ECSimFlatTask_h
+
+namespace ecsim
+{
+
+// Kinds of flat tasks: ECSoftIntervalTask (ECSimIntervalTask), ECHardIntervalTask, ECConsecutiveIntervalTask,
+// ECMultiIntervalsTask, ECPeriodicTask
+enum ECSimFlatTaskKind
+{
+    EC_FLAT_SOFT_INTERVAL = 0,
+    EC_FLAT_HARD_INTERVAL,
+    EC_FLAT_CONSECUTIVE_INTERVAL,
+    EC_FLAT_MULTI_INTERVALS,
+    EC_FLAT_PERIODIC
+};
+
+// Policies: ECSimFIFOTaskScheduler, ECSimLWTFTaskScheduler, ECSimRoundRobinTaskScheduler, ECSimPriorityScheduler
+enum ECSimFlatPolicy
+{
+    EC_POLICY_FIFO = 0,
+    EC_POLICY_LWTF,
+    EC_POLICY_ROUND_ROBIN,
+    EC_POLICY_PRIORITY,
+    EC_NUM_FLAT_POLICIES
+};
+
+// Is a task ready at a tick by its time alone? Its intervals are [listStarts[i], listEnds[i]] (the single-interval
+// kinds have one; a periodic task runs runLen ticks of each period from listStarts[0]). A hard task that waited and
+// a consecutive one that was interrupted are not ready either, by their state
+template <class TTime>
+constexpr bool ECSimFlatIsTimeReady(ECSimFlatTaskKind kind, TTime tick, const TTime *listStarts, const TTime *listEnds, int numIntervals, TTime runLen, TTime period)
+{
+    switch (kind)
+    {
+    case EC_FLAT_HARD_INTERVAL:
+        return tick == listStarts[0];
+    case EC_FLAT_MULTI_INTERVALS:
+        for (int i = 0; i < numIntervals; ++i)
+        {
+            if (tick >= listStarts[i] && tick <= listEnds[i])
+            {
+                return true;
+            }
+        }
+        return false;
+    case EC_FLAT_PERIODIC:
+        return tick >= listStarts[0] && (tick - listStarts[0]) % period < runLen;
+    default:
+        return tick >= listStarts[0] && tick <= listEnds[0];
+    }
+}
+
+// First tick at which a task is finished by its time alone, as its IsFinished (tmNever: never, for periodic tasks)
+template <class TTime>
+constexpr TTime ECSimFlatFinishTick(ECSimFlatTaskKind kind, const TTime *listEnds, int numIntervals, TTime tmNever)
+{
+    switch (kind)
+    {
+    case EC_FLAT_HARD_INTERVAL:
+        return listEnds[0];
+    case EC_FLAT_PERIODIC:
+        return tmNever;
+    case EC_FLAT_MULTI_INTERVALS:
+        return listEnds[numIntervals - 1] < tmNever ? listEnds[numIntervals - 1] + 1 : tmNever;
+    default:
+        return listEnds[0] < tmNever ? listEnds[0] + 1 : tmNever;
+    }
+}
+
+// Does a policy choose ready task a over task b, the one chosen so far among those before a? As ChooseTaskToSchedule:
+// the first of the ready tasks (FIFO), of those with the longest wait (LWTF), the least run (round robin) or the
+// smallest priority value
+template <class TTime>
+constexpr bool ECSimFlatPrefers(int policy, TTime tmWaitA, TTime tmRunA, int priorityA, TTime tmWaitB, TTime tmRunB, int priorityB)
+{
+    switch (policy)
+    {
+    case EC_POLICY_LWTF:
+        return tmWaitA > tmWaitB;
+    case EC_POLICY_ROUND_ROBIN:
+        return tmRunA < tmRunB;
+    case EC_POLICY_PRIORITY:
+        return priorityA < priorityB;
+    default:
+        return false;
+    }
+}
+
+} // namespace ecsim
+
+using ecsim::ECSimFlatTaskKind;
+using ecsim::ECSimFlatPolicy;
+using ecsim::EC_POLICY_FIFO;
+using ecsim::EC_POLICY_LWTF;
+using ecsim::EC_POLICY_ROUND_ROBIN;
+using ecsim::EC_POLICY_PRIORITY;
+
+#endif /* ECSimFlatTask_h */
@@ -0,0 +1,514 @@
+//
+//  ECSimIncrementalSimulator.cpp
+//
+//
+//
+
+#include "ECSimIncrementalSimulator.h"
+#include "ECSimTaskBase.h"
+#include "ECSimWorkloadTasks.h"
+#include <algorithm>
+using namespace std;
+
+namespace ecsim
+{
+
+// First tick a spec's task can be ready at: its start, the first of its intervals, or the first of its subtasks
+static ECSimTime GetFirstTick(const ECSimWorkload &workload, int index)
+{
+    const ECSimTaskSpec &spec = workload.GetSpecs()[index];
+    ECSimTime tmFirst = EC_TIME_MAX;
+    if (spec.kind == EC_MULTI_INTERVALS)
+    {
+        for (const auto &interval : spec.listIntervals)
+        {
+            tmFirst = min(tmFirst, (ECSimTime)interval.first);
+        }
+    }
+    else if (spec.kind == EC_COMPOSITE3)
+    {
+        for (int sub : spec.listSubtasks)
+        {
+            tmFirst = min(tmFirst, GetFirstTick(workload, sub));
+        }
+    }
+    else
+    {
+        tmFirst = spec.tmStart;
+    }
+    return tmFirst;
+}
+
+// Is spec index the task of spec top, or one of its subtasks (at any depth)?
+static bool IsPartOf(const ECSimWorkload &workload, int top, int index)
+{
+    if (top == index)
+    {
+        return true;
+    }
+    for (int sub : workload.GetSpecs()[top].listSubtasks)
+    {
+        if (sub >= 0 && sub < top && IsPartOf(workload, sub, index))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The same task but for its priority?
+static bool IsSameButPriority(const ECSimTaskSpec &spec1, const ECSimTaskSpec &spec2)
+{
+    return spec1.kind == spec2.kind && spec1.id == spec2.id && spec1.tmStart == spec2.tmStart && spec1.tmEnd == spec2.tmEnd &&
+           spec1.runLen == spec2.runLen && spec1.sleepLen == spec2.sleepLen && spec1.listIntervals == spec2.listIntervals &&
+           spec1.listSubtasks == spec2.listSubtasks && spec1.listDecorators == spec2.listDecorators && spec1.fSubtask == spec2.fSubtask;
+}
+
+//***********************************************************
+// Incremental simulation
+
+ECSimIncrementalSimulator ::ECSimIncrementalSimulator(const std::function<ECSimTaskScheduler *()> &createSchedulerIn) : createScheduler(createSchedulerIn), checkpointInterval(128), duration(0), pScheduler(NULL), pTasks(NULL), fWheel(false),
+                                                                                                                       numTicks(0), tmEdit(-1), tmResume(-1), tmConverge(-1)
+{
+}
+
+ECSimIncrementalSimulator ::~ECSimIncrementalSimulator()
+{
+    DeleteRun();
+}
+
+const std::vector<ECSimTask *> &ECSimIncrementalSimulator ::GetTasks() const
+{
+    static const vector<ECSimTask *> listNone;
+    return pTasks != NULL ? pTasks->GetTasks() : listNone;
+}
+
+ECSimTime ECSimIncrementalSimulator ::Simulate(const ECSimWorkload &workloadIn, ECSimTime durationIn)
+{
+    workload = workloadIn;
+    duration = durationIn < 0 ? EC_TIME_MAX : durationIn;
+    listCheckpoints.clear();
+    listDecisions.clear();
+    numTicks = 0;
+    tmEdit = -1;
+    tmResume = 0;
+    tmConverge = -1;
+    if (!BuildRun())
+    {
+        DeleteRun();
+        return 0;
+    }
+    size_t numTasks = GetTasks().size();
+    listEdited.assign(numTasks, false);
+    listContested.assign(numTasks, -1);
+    listLastWait.assign(numTasks, 0);
+    listTrack.clear();
+    for (size_t i = 0; i < numTasks; ++i)
+    {
+        listTrack.push_back((int)i);
+    }
+    listCheckpoints.push_back(Checkpoint());
+    Save(listCheckpoints.back());
+    Run(vector<Checkpoint>(), vector<ECSimIncrementalDecision>(), vector<ECSimTime>());
+    return numTicks;
+}
+
+ECSimTime ECSimIncrementalSimulator ::Edit(int index, const ECSimTaskSpec &spec)
+{
+    vector<ECSimTaskSpec> &listSpecs = workload.GetSpecs();
+    if (pTasks == NULL || index < 0 || index >= (int)listSpecs.size())
+    {
+        return 0;
+    }
+    ECSimWorkload workloadOld = workload;
+    listSpecs[index] = spec;
+    if (spec.fSubtask != workloadOld.GetSpecs()[index].fSubtask)
+    {
+        // the top-level tasks are not the same ones
+        ECSimWorkload workloadNew = workload;
+        return Simulate(workloadNew, duration);
+    }
+
+    // the top-level tasks the edit changes, and the first tick it can affect: for a new priority the first tick the
+    // task had to compete, else the first tick the old or the new task can be ready at
+    bool fPriority = !spec.fSubtask && IsSameButPriority(spec, workloadOld.GetSpecs()[index]);
+    size_t numTasks = GetTasks().size();
+    listEdited.assign(numTasks, false);
+    tmEdit = EC_TIME_MAX;
+    for (int s = 0, top = 0; s < (int)listSpecs.size(); ++s)
+    {
+        if (listSpecs[s].fSubtask)
+        {
+            continue;
+        }
+        if (IsPartOf(workloadOld, s, index) || IsPartOf(workload, s, index))
+        {
+            listEdited[top] = true;
+            tmEdit = min(tmEdit, fPriority ? listContested[top] : min(GetFirstTick(workloadOld, s), GetFirstTick(workload, s)));
+        }
+        ++top;
+    }
+
+    // resume from the last checkpoint before that tick (the end of the run if it comes first), and compare with the
+    // recorded run after it
+    listCheckpoints.push_back(checkpointEnd);
+    size_t posResume = 0;
+    while (posResume + 1 < listCheckpoints.size() && listCheckpoints[posResume + 1].scheduler.timeCurr < max((ECSimTime)1, tmEdit))
+    {
+        ++posResume;
+    }
+    vector<Checkpoint> listBase(listCheckpoints.begin() + posResume + 1, listCheckpoints.end());
+    listCheckpoints.resize(posResume + 1);
+    vector<ECSimIncrementalDecision> listBaseDecisions;
+    listBaseDecisions.swap(listDecisions);
+    vector<ECSimTime> listBaseContested = listContested;
+
+    if (!BuildRun())
+    {
+        DeleteRun();
+        return 0;
+    }
+    if (!fPriority)
+    {
+        // up to here the edited tasks were never ready: in the checkpoints kept, they are new tasks not started yet
+        Checkpoint initial;
+        Save(initial);
+        for (auto &checkpoint : listCheckpoints)
+        {
+            CopyStates(checkpoint, initial, listEdited);
+            for (size_t i = 0; i < numTasks; ++i)
+            {
+                if (listEdited[i])
+                {
+                    PlaceTask(checkpoint, (int)i, GetTasks()[i]->GetStartTime());
+                }
+            }
+        }
+    }
+    const Checkpoint &checkpointResume = listCheckpoints.back();
+    Restore(checkpointResume);
+    tmResume = checkpointResume.scheduler.timeCurr;
+    tmConverge = -1;
+    listDecisions.assign(listBaseDecisions.begin(), listBaseDecisions.begin() + checkpointResume.numDecisions);
+
+    // tasks not seen competing by now may do so earlier than before
+    listTrack.clear();
+    for (size_t i = 0; i < numTasks; ++i)
+    {
+        if (listContested[i] > tmResume)
+        {
+            listContested[i] = -1;
+            listLastWait[i] = GetTasks()[i]->GetTotWaitTime64();
+            listTrack.push_back((int)i);
+        }
+    }
+    Run(listBase, listBaseDecisions, listBaseContested);
+    return (tmConverge >= 0 ? tmConverge : numTicks) - tmResume;
+}
+
+// A new scheduler with the tasks of the workload
+bool ECSimIncrementalSimulator ::BuildRun()
+{
+    DeleteRun();
+    pScheduler = createScheduler();
+    pTasks = new ECSimWorkloadTasks;
+    if (!pTasks->Build(workload, pScheduler))
+    {
+        return false;
+    }
+    fWheel = pScheduler->IsTimingWheel();
+    const vector<ECSimTask *> &listTop = pTasks->GetTasks();
+    for (size_t i = 0; i < listTop.size(); ++i)
+    {
+        mapIndex[listTop[i]] = (int)i;
+    }
+    return true;
+}
+
+void ECSimIncrementalSimulator ::DeleteRun()
+{
+#ifdef ECSIM_PERF_COUNTERS
+    if (pScheduler != NULL)
+    {
+        perfDone.Add(pScheduler->GetPerfCounters());
+    }
+#endif
+    delete pScheduler;
+    delete pTasks;
+    pScheduler = NULL;
+    pTasks = NULL;
+    mapIndex.clear();
+}
+
+#ifdef ECSIM_PERF_COUNTERS
+void ECSimIncrementalSimulator ::AddPerfCounters(ECSimPerfCounters &perf) const
+{
+    perf.Add(perfDone);
+    if (pScheduler != NULL)
+    {
+        perf.Add(pScheduler->GetPerfCounters());
+    }
+}
+#endif
+
+int ECSimIncrementalSimulator ::GetIndex(const ECSimTask *pTask) const
+{
+    auto it = mapIndex.find(pTask);
+    return it != mapIndex.end() ? it->second : -1;
+}
+
+void ECSimIncrementalSimulator ::Save(Checkpoint &checkpoint) const
+{
+    ECSimSchedulerCheckpoint &sc = checkpoint.scheduler;
+    pScheduler->SaveCheckpoint(sc);
+    checkpoint.indexCurr = GetIndex(sc.pTaskCurr);
+    checkpoint.indexLoaded = GetIndex(sc.pTaskLoaded);
+    checkpoint.listActive.clear();
+    for (auto x : sc.listTasks)
+    {
+        checkpoint.listActive.push_back(GetIndex(x));
+    }
+    checkpoint.listWheel.clear();
+    for (const auto &item : sc.listWheel)
+    {
+        checkpoint.listWheel.push_back(make_pair(item.first, GetIndex(item.second)));
+    }
+    std::sort(checkpoint.listWheel.begin(), checkpoint.listWheel.end());
+    sc.pTaskCurr = NULL;
+    sc.pTaskLoaded = NULL;
+    sc.listTasks.clear();
+    sc.listWheel.clear();
+    sc.listState.clear();
+    // what the policy keeps of its own names the tasks by address: it is not kept (see the header)
+    sc.listPolicyTasks.clear();
+    sc.listPolicyState.clear();
+    checkpoint.listState.clear();
+    checkpoint.listStatePos.clear();
+    for (auto x : GetTasks())
+    {
+        checkpoint.listStatePos.push_back(checkpoint.listState.size());
+        x->SaveState(checkpoint.listState);
+    }
+    checkpoint.listStatePos.push_back(checkpoint.listState.size());
+    checkpoint.numDecisions = listDecisions.size();
+}
+
+void ECSimIncrementalSimulator ::Restore(const Checkpoint &checkpoint)
+{
+    const vector<ECSimTask *> &listTop = GetTasks();
+    for (size_t i = 0; i < listTop.size(); ++i)
+    {
+        size_t pos = checkpoint.listStatePos[i];
+        listTop[i]->RestoreState(checkpoint.listState, pos);
+    }
+    ECSimSchedulerCheckpoint sc = checkpoint.scheduler;
+    sc.pTaskCurr = checkpoint.indexCurr >= 0 ? listTop[checkpoint.indexCurr] : NULL;
+    sc.pTaskLoaded = checkpoint.indexLoaded >= 0 ? listTop[checkpoint.indexLoaded] : NULL;
+    for (int x : checkpoint.listActive)
+    {
+        sc.listTasks.push_back(listTop[x]);
+        listTop[x]->SaveState(sc.listState);
+    }
+    for (const auto &item : checkpoint.listWheel)
+    {
+        sc.listWheel.push_back(make_pair(item.first, listTop[item.second]));
+        listTop[item.second]->SaveState(sc.listState);
+    }
+    pScheduler->RestoreCheckpoint(sc);
+}
+
+// Take the state of the tasks in listCopy from another checkpoint
+void ECSimIncrementalSimulator ::CopyStates(Checkpoint &checkpoint, const Checkpoint &from, const std::vector<bool> &listCopy) const
+{
+    vector<long long> listState;
+    vector<size_t> listStatePos;
+    for (size_t i = 0; i + 1 < checkpoint.listStatePos.size(); ++i)
+    {
+        const Checkpoint &src = listCopy[i] ? from : checkpoint;
+        listStatePos.push_back(listState.size());
+        listState.insert(listState.end(), src.listState.begin() + src.listStatePos[i], src.listState.begin() + src.listStatePos[i + 1]);
+    }
+    listStatePos.push_back(listState.size());
+    checkpoint.listState.swap(listState);
+    checkpoint.listStatePos.swap(listStatePos);
+}
+
+// Put a task that hasn't started by the checkpoint's tick where the scheduler keeps such a task: in the timing wheel
+// until the tick before its start (AddTask at tick 0 keeps tasks starting at 1 active), else among the active tasks,
+// which stay in the order they were added
+void ECSimIncrementalSimulator ::PlaceTask(Checkpoint &checkpoint, int index, ECSimTime tmStart) const
+{
+    vector<int> &listActive = checkpoint.listActive;
+    vector<pair<ECSimTime, int> > &listWheel = checkpoint.listWheel;
+    listActive.erase(std::remove(listActive.begin(), listActive.end(), index), listActive.end());
+    listWheel.erase(std::remove_if(listWheel.begin(), listWheel.end(), [index](const pair<ECSimTime, int> &item)
+                                   { return item.second == index; }),
+                    listWheel.end());
+    if (fWheel && tmStart > max((ECSimTime)1, checkpoint.scheduler.timeCurr))
+    {
+        pair<ECSimTime, int> item(tmStart, index);
+        listWheel.insert(std::lower_bound(listWheel.begin(), listWheel.end(), item), item);
+    }
+    else
+    {
+        listActive.insert(std::lower_bound(listActive.begin(), listActive.end(), index), index);
+    }
+}
+
+// Simulate to the end, with a checkpoint every checkpointInterval ticks; once one of them is the same as the
+// recorded run's (listBase: its checkpoints after the current tick, then its end), take the rest from that run
+void ECSimIncrementalSimulator ::Run(const std::vector<Checkpoint> &listBase, const std::vector<ECSimIncrementalDecision> &listBaseDecisions,
+                                     const std::vector<ECSimTime> &listBaseContested)
+{
+    size_t posBase = 0;
+    while (pScheduler->GetTime64() < duration)
+    {
+        // steps never cross a checkpoint
+        ECSimTime tick = pScheduler->GetTime64();
+        ECSimTime tmCheckpoint = ECSimTimeAdd(tick - tick % checkpointInterval, checkpointInterval);
+        ECSimTime numStepTicks = pScheduler->Step(min(duration - tick, tmCheckpoint - tick));
+        if (numStepTicks == 0)
+        {
+            break;
+        }
+        ECSimIncrementalDecision decision;
+        decision.tick = pScheduler->GetTime64();
+        decision.numTicks = numStepTicks;
+        decision.index = GetIndex(pScheduler->GetCurrTask());
+        decision.numReady = pScheduler->GetNumReady();
+        listDecisions.push_back(decision);
+        if (!listTrack.empty())
+        {
+            TrackContested(decision.tick);
+        }
+        if (decision.tick % checkpointInterval == 0)
+        {
+            listCheckpoints.push_back(Checkpoint());
+            Save(listCheckpoints.back());
+            while (posBase < listBase.size() && listBase[posBase].scheduler.timeCurr < decision.tick)
+            {
+                ++posBase;
+            }
+            if (posBase < listBase.size() && listBase[posBase].scheduler.timeCurr == decision.tick && IsConverged(listCheckpoints.back(), listBase[posBase]))
+            {
+                tmConverge = decision.tick;
+                Splice(listBase, posBase, listBaseDecisions, listBaseContested);
+                return;
+            }
+        }
+    }
+    Save(checkpointEnd);
+    numTicks = checkpointEnd.scheduler.timeCurr;
+    for (int x : listTrack)
+    {
+        listContested[x] = EC_TIME_MAX;
+    }
+    listTrack.clear();
+}
+
+// A task competed at a tick if it waited, or ran while others were ready
+void ECSimIncrementalSimulator ::TrackContested(ECSimTime tick)
+{
+    const vector<ECSimTask *> &listTop = GetTasks();
+    ECSimTask *pRun = pScheduler->GetCurrTask();
+    bool fOthers = pScheduler->GetNumReady() > 1;
+    size_t numLeft = 0;
+    for (int x : listTrack)
+    {
+        ECSimTime tmWait = listTop[x]->GetTotWaitTime64();
+        if (tmWait != listLastWait[x] || (fOthers && listTop[x] == pRun))
+        {
+            listContested[x] = tick;
+            continue;
+        }
+        listTrack[numLeft++] = x;
+    }
+    listTrack.resize(numLeft);
+}
+
+// Does the run go on from here as the recorded one did? The edited tasks must be done, and the scheduler and every
+// task still to run where they were
+bool ECSimIncrementalSimulator ::IsConverged(const Checkpoint &checkpoint, const Checkpoint &base) const
+{
+    const ECSimSchedulerCheckpoint &sc = checkpoint.scheduler;
+    const ECSimSchedulerCheckpoint &scBase = base.scheduler;
+    if (sc.numReady != scBase.numReady || sc.numLoadedRunTicks != scBase.numLoadedRunTicks || sc.numSwitchTicksLeft != scBase.numSwitchTicksLeft ||
+        checkpoint.indexCurr != base.indexCurr || checkpoint.indexLoaded != base.indexLoaded || checkpoint.listActive != base.listActive ||
+        checkpoint.listWheel != base.listWheel)
+    {
+        return false;
+    }
+    auto isSame = [&](int x)
+    {
+        return !listEdited[x] && std::equal(checkpoint.listState.begin() + checkpoint.listStatePos[x], checkpoint.listState.begin() + checkpoint.listStatePos[x + 1],
+                                            base.listState.begin() + base.listStatePos[x], base.listState.begin() + base.listStatePos[x + 1]);
+    };
+    for (int x : checkpoint.listActive)
+    {
+        if (!isSame(x))
+        {
+            return false;
+        }
+    }
+    for (const auto &item : checkpoint.listWheel)
+    {
+        if (!isSame(item.second))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The rest of the run is the recorded one from listBase[posBase] on: tasks done by now keep what they have, the
+// others end as recorded, and the scheduler's totals differ by what they differ by now
+void ECSimIncrementalSimulator ::Splice(const std::vector<Checkpoint> &listBase, size_t posBase, const std::vector<ECSimIncrementalDecision> &listBaseDecisions,
+                                        const std::vector<ECSimTime> &listBaseContested)
+{
+    const Checkpoint checkpointNow = listCheckpoints.back();
+    const Checkpoint &base = listBase[posBase];
+    ECSimTime tick = checkpointNow.scheduler.timeCurr;
+    vector<bool> listDone(checkpointNow.listStatePos.size() - 1, true);
+    for (int x : checkpointNow.listActive)
+    {
+        listDone[x] = false;
+    }
+    for (const auto &item : checkpointNow.listWheel)
+    {
+        listDone[item.second] = false;
+    }
+    long long numWaitDiff = checkpointNow.scheduler.tmTotWait - base.scheduler.tmTotWait;
+    long long numRunDiff = checkpointNow.scheduler.tmTotRun - base.scheduler.tmTotRun;
+    long long numSwitchesDiff = checkpointNow.scheduler.numSwitches - base.scheduler.numSwitches;
+    long long numSwitchTicksDiff = checkpointNow.scheduler.numSwitchTicks - base.scheduler.numSwitchTicks;
+    size_t numDecisionsNow = listDecisions.size();
+    listDecisions.insert(listDecisions.end(), listBaseDecisions.begin() + base.numDecisions, listBaseDecisions.end());
+    for (size_t i = posBase + 1; i < listBase.size(); ++i)
+    {
+        Checkpoint checkpoint = listBase[i];
+        CopyStates(checkpoint, checkpointNow, listDone);
+        checkpoint.scheduler.tmTotWait += numWaitDiff;
+        checkpoint.scheduler.tmTotRun += numRunDiff;
+        checkpoint.scheduler.numSwitches += numSwitchesDiff;
+        checkpoint.scheduler.numSwitchTicks += numSwitchTicksDiff;
+        checkpoint.numDecisions = checkpoint.numDecisions - base.numDecisions + numDecisionsNow;
+        if (i + 1 < listBase.size())
+        {
+            listCheckpoints.push_back(checkpoint);
+        }
+        else
+        {
+            checkpointEnd = checkpoint;
+        }
+    }
+    Restore(checkpointEnd);
+    numTicks = checkpointEnd.scheduler.timeCurr;
+    // from here on the tasks compete as they did
+    for (int x : listTrack)
+    {
+        listContested[x] = listBaseContested[x] > tick ? listBaseContested[x] : tick + 1;
+    }
+    listTrack.clear();
+}
+
+} // namespace ecsim
@@ -0,0 +1,166 @@
+//
+//  ECSimIncrementalSimulator.h
+//
+//
+//  Incremental re-simulation for what-if analysis: simulate a scenario (a workload) once, recording a checkpoint
+//  every so many ticks and the decision of every step; then edit one task (its priority, its interval, ...) and
+//  bring the results up to date without simulating it all again. The edit can't change anything before the first
+//  tick it affects (the task's start, or for a new priority the first tick the task was ready together with
+//  another one), so the run resumes from the checkpoint before that tick, and stops as soon as the state is back
+//  on the recorded run: the edited task is done and every other one is where it was at the same tick.
+//
+//      ECSimIncrementalSimulator sim([] { return new ECSimFIFOTaskScheduler; });
+//      sim.Simulate(workload, 100000);
+//      spec.priority = 3;
+//      sim.Edit(7, spec);      // sim.GetTasks() / GetScheduler() now show the edited scenario, as simulated in full
+//
+//  Restoring a checkpoint puts back the scheduler and the tasks, not what a policy keeps to itself: the results are
+//  exact for policies that choose by the ready tasks and their counters alone (FIFO, LWTF, round robin, priority,
+//  minimum quantum, hysteresis), not for CFS or MLFQ
+//
+
+#ifndef ECSimIncrementalSimulator_h
+#define ECSimIncrementalSimulator_h
+
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "ECSimTaskScheduler.h"
+#include "ECSimWorkload.h"
+
+class ECSimWorkloadTasks;
+
+namespace ecsim
+{
+
+//***********************************************************
+// A step of a simulation: it ended at tick and took numTicks ticks (the ones before the last are idle); the task
+// that ran at its last tick (index in the top-level tasks of the workload, -1 if none) and how many were ready
+
+struct ECSimIncrementalDecision
+{
+    ECSimIncrementalDecision() : tick(0), numTicks(0), index(-1), numReady(0) {}
+
+    ECSimTime tick;
+    ECSimTime numTicks;
+    int index;
+    int numReady;
+};
+
+//***********************************************************
+// Simulation of a scenario that can be edited and simulated again from where the edit matters
+
+class ECSimIncrementalSimulator
+{
+public:
+    // createScheduler makes a scheduler with the policy and settings to use (e.g. the timing wheel); one is made for
+    // each run, and the simulator owns it
+    ECSimIncrementalSimulator(const std::function<ECSimTaskScheduler *()> &createSchedulerIn);
+    ~ECSimIncrementalSimulator();
+
+    // Save a checkpoint every this many ticks (default: 128): fewer ticks to simulate again after an edit, more memory
+    void SetCheckpointInterval(ECSimTime ticks) { checkpointInterval = ticks > 0 ? ticks : 1; }
+
+    // Simulate a scenario from scratch for duration ticks (< 0: until no task is left), as Simulate64 does.
+    // Return the ticks simulated; 0 if the workload can't be built (a composite lists a later subtask)
+    ECSimTime Simulate(const ECSimWorkload &workloadIn, ECSimTime duration);
+
+    // Replace the spec of a task (index in the workload) and bring the results up to date. Return the ticks simulated
+    // again. Edits that make a task a subtask or a top-level one are simulated from scratch
+    ECSimTime Edit(int index, const ECSimTaskSpec &spec);
+
+    // The scenario as edited, and its scheduler and top-level tasks (in workload order) as a full Simulate leaves them
+    const ECSimWorkload &GetWorkload() const { return workload; }
+    ECSimTaskScheduler &GetScheduler() { return *pScheduler; }
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of all the runs so far (those simulated again after edits included) to perf (to print
+    // once the run is over)
+    void AddPerfCounters(ECSimPerfCounters &perf) const;
+#endif
+    const std::vector<ECSimTask *> &GetTasks() const;
+
+    // Ticks of the whole simulation, as Simulate64 returns, and its steps (idle stretches are cut at the checkpoints)
+    ECSimTime GetNumTicks() const { return numTicks; }
+    const std::vector<ECSimIncrementalDecision> &GetDecisions() const { return listDecisions; }
+
+    // The last edit: the first tick it could affect, the tick simulation resumed from, and the tick it converged back
+    // onto the recorded run (-1: it ran to the end)
+    ECSimTime GetEditTime() const { return tmEdit; }
+    ECSimTime GetResumeTime() const { return tmResume; }
+    ECSimTime GetConvergeTime() const { return tmConverge; }
+
+private:
+    ECSimIncrementalSimulator(const ECSimIncrementalSimulator &);
+    ECSimIncrementalSimulator &operator=(const ECSimIncrementalSimulator &);
+
+    // State of a run after a tick, with the tasks as indices of the top-level tasks
+    struct Checkpoint
+    {
+        // clock and counters (its task lists are empty)
+        ECSimSchedulerCheckpoint scheduler;
+        int indexCurr;
+        int indexLoaded;
+        // tasks not finished: active ones in order, and those in the timing wheel (sorted)
+        std::vector<int> listActive;
+        std::vector<std::pair<ECSimTime, int> > listWheel;
+        // SaveState of every top-level task: task i is at [listStatePos[i], listStatePos[i + 1])
+        std::vector<long long> listState;
+        std::vector<size_t> listStatePos;
+        // decisions up to the tick
+        size_t numDecisions;
+    };
+
+    bool BuildRun();
+    void DeleteRun();
+    int GetIndex(const ECSimTask *pTask) const;
+    void Save(Checkpoint &checkpoint) const;
+    void Restore(const Checkpoint &checkpoint);
+    void CopyStates(Checkpoint &checkpoint, const Checkpoint &from, const std::vector<bool> &listCopy) const;
+    void PlaceTask(Checkpoint &checkpoint, int index, ECSimTime tmStart) const;
+    void Run(const std::vector<Checkpoint> &listBase, const std::vector<ECSimIncrementalDecision> &listBaseDecisions,
+             const std::vector<ECSimTime> &listBaseContested);
+    void TrackContested(ECSimTime tick);
+    bool IsConverged(const Checkpoint &checkpoint, const Checkpoint &base) const;
+    void Splice(const std::vector<Checkpoint> &listBase, size_t posBase, const std::vector<ECSimIncrementalDecision> &listBaseDecisions,
+                const std::vector<ECSimTime> &listBaseContested);
+
+    std::function<ECSimTaskScheduler *()> createScheduler;
+    ECSimTime checkpointInterval;
+    ECSimTime duration;
+    ECSimWorkload workload;
+
+    // the current run: its scheduler and tasks, and the index of each top-level task
+    ECSimTaskScheduler *pScheduler;
+    ECSimWorkloadTasks *pTasks;
+    std::unordered_map<const ECSimTask *, int> mapIndex;
+    bool fWheel;
+#ifdef ECSIM_PERF_COUNTERS
+    // phase counters of the runs deleted so far
+    ECSimPerfCounters perfDone;
+#endif
+
+    // the recorded run: checkpoints by tick (from tick 0), the state at its end, and its steps
+    std::vector<Checkpoint> listCheckpoints;
+    Checkpoint checkpointEnd;
+    std::vector<ECSimIncrementalDecision> listDecisions;
+    ECSimTime numTicks;
+
+    // per top-level task, a tick before which it was never ready together with another task (-1: still looking)
+    std::vector<ECSimTime> listContested;
+    std::vector<ECSimTime> listLastWait;
+    std::vector<int> listTrack;
+
+    // top-level tasks changed by the edit being simulated
+    std::vector<bool> listEdited;
+    ECSimTime tmEdit;
+    ECSimTime tmResume;
+    ECSimTime tmConverge;
+};
+
+} // namespace ecsim
+
+using ecsim::ECSimIncrementalDecision;
+using ecsim::ECSimIncrementalSimulator;
+
+#endif /* ECSimIncrementalSimulator_h */
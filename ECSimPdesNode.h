@@ -0,0 +1,326 @@
+//
+//  ECSimPdesNode.h
+//
+//
+//  Conservative parallel discrete-event simulation across processes. Machines
+//  (one scheduler each) are partitioned over nodes; every node simulates its
+//  own machines tick by tick. Machines interact only through task arrivals:
+//  the tick hook of a machine may send a task to any machine, arriving at least
+//  lookahead ticks later. A node only simulates tick T once every peer has
+//  promised by a null message that no more arrivals at or before T will
+//  come, so the result is the same as with all machines in one process,
+//  whatever the partition.
+//
+
+#ifndef ECSimPdesNode_h
+#define ECSimPdesNode_h
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include "ECSimWorkload.h"
+#include "ECSimTransport.h"
+#include "ECSimShardedSimulator.h"
+#include "ECSimPerfCounters.h"
+
+template <class TScheduler, class TTask>
+class ECSimPdesNode
+{
+public:
+    // nodeOfMachine: the node that owns each machine. pTransport: connection to the other nodes (NULL: this is the
+    // only node). lookahead (>= 1): minimum delay of a task arrival. createScheduler / createTask make the schedulers of
+    // local machines and the tasks that arrive at them (the node owns both)
+    ECSimPdesNode(const std::vector<int> &nodeOfMachineIn, ECSimTransport *pTransportIn, int lookaheadIn,
+                  const std::function<TScheduler *()> &createScheduler, const std::function<TTask *(const ECSimTaskSpec &)> &createTaskIn)
+        : nodeOfMachine(nodeOfMachineIn), pTransport(pTransportIn), lookahead(std::max(1, lookaheadIn)), createTask(createTaskIn),
+          rank(pTransportIn != NULL ? pTransportIn->GetRank() : 0), machineCurr(-1), tickCurr(0), numTaskMessages(0), numNullMessages(0)
+    {
+        listMachines.resize(nodeOfMachine.size());
+        for (int m = 0; m < (int)nodeOfMachine.size(); ++m)
+        {
+            if (IsLocal(m))
+            {
+                listMachines[m].pScheduler = createScheduler();
+            }
+        }
+    }
+
+    ~ECSimPdesNode()
+    {
+        for (auto &machine : listMachines)
+        {
+            delete machine.pScheduler;
+            for (auto x : machine.listArrived)
+            {
+                delete x;
+            }
+        }
+    }
+
+    int GetNumMachines() const { return (int)nodeOfMachine.size(); }
+    bool IsLocal(int machine) const { return pTransport == NULL || nodeOfMachine[machine] == rank; }
+
+    // Initial task of a local machine
+    void AddTask(int machine, TTask *pTask)
+    {
+        listMachines[machine].pScheduler->AddTask(pTask);
+        listMachines[machine].listTasks.push_back(pTask);
+    }
+
+    // Scheduler of a local machine, and all its tasks (initial ones, then arrived ones in arrival order)
+    TScheduler &GetScheduler(int machine) { return *listMachines[machine].pScheduler; }
+    const std::vector<TTask *> &GetTasks(int machine) const { return listMachines[machine].listTasks; }
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of the local machines' schedulers to perf (to print once the run is over)
+    void AddPerfCounters(ECSimPerfCounters &perf) const
+    {
+        for (const auto &machine : listMachines)
+        {
+            if (machine.pScheduler != NULL)
+            {
+                perf.Add(machine.pScheduler->GetPerfCounters());
+            }
+        }
+    }
+#endif
+
+    // Called after each local machine simulated a tick (machines in increasing order); it may call SendTask
+    void SetTickHook(const std::function<void(ECSimPdesNode &, int machine, int tick)> &hook) { tickHook = hook; }
+
+    // From the tick hook: a task (no subtasks or decorators) arrives at machineDest at tickArrive, which must be at
+    // least lookahead ticks after the current tick. Return false if it is too early, the id doesn't fit in a message
+    // (31 characters at most) or the transport failed
+    bool SendTask(int machineDest, int tickArrive, const ECSimTaskSpec &spec)
+    {
+        if (machineCurr < 0 || tickArrive < tickCurr + lookahead || spec.id.size() >= sizeof(ECSimMessage::id))
+        {
+            return false;
+        }
+        ECSimMessage msg;
+        msg.type = EC_MSG_TASK;
+        msg.node = rank;
+        msg.tick = tickArrive;
+        msg.machineSrc = machineCurr;
+        msg.seq = listMachines[machineCurr].numSent++;
+        msg.machine = machineDest;
+        msg.kind = spec.kind;
+        msg.priority = spec.priority;
+        msg.tmStart = spec.tmStart;
+        msg.tmEnd = spec.tmEnd;
+        msg.runLen = spec.runLen;
+        msg.sleepLen = spec.sleepLen;
+        memcpy(msg.id, spec.id.c_str(), spec.id.size() + 1);
+        ++numTaskMessages;
+        if (IsLocal(machineDest))
+        {
+            queueArrivals.push(msg);
+            return true;
+        }
+        return pTransport->Send(nodeOfMachine[machineDest], msg);
+    }
+
+    // Simulate all local machines for duration (>= 0) ticks. Return false if the transport failed
+    bool Simulate(int duration)
+    {
+        int numNodes = pTransport != NULL ? pTransport->GetNumNodes() : 1;
+        // latest promise of each peer: it sends nothing more arriving at or before this tick
+        listPromised.assign(numNodes, lookahead);
+        listPromised[rank] = INT_MAX;
+        int now = 0;
+        while (now < duration)
+        {
+            int safe = *std::min_element(listPromised.begin(), listPromised.end());
+            if (safe <= now)
+            {
+                // blocked: wait for a peer to move on
+                if (!ReceiveOne())
+                {
+                    return false;
+                }
+                continue;
+            }
+            int tickEnd = std::min(safe, duration);
+            while (now < tickEnd)
+            {
+                SimulateTick(now + 1);
+                ++now;
+            }
+            // everything this node sends from now on arrives after now + lookahead
+            if (!SendNull(now + lookahead))
+            {
+                return false;
+            }
+        }
+        // stay until every peer is done too, so no channel is left with unread messages
+        while (*std::min_element(listPromised.begin(), listPromised.end()) < duration + lookahead)
+        {
+            if (!ReceiveOne())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int GetNumTaskMessages() const { return numTaskMessages; }
+    int GetNumNullMessages() const { return numNullMessages; }
+
+    // Merged metrics of the local machines
+    ECSimShardedStats GetStats() const
+    {
+        ECSimShardedStats st;
+        for (const auto &machine : listMachines)
+        {
+            if (machine.pScheduler == NULL)
+            {
+                continue;
+            }
+            ++st.numShards;
+            st.numTasks += (int)machine.listTasks.size();
+            st.numTicks = std::max(st.numTicks, machine.pScheduler->GetTime());
+            st.numShardTicks += machine.pScheduler->GetTime();
+            for (auto x : machine.listTasks)
+            {
+                st.tmTotRun += x->GetTotRunTime();
+                st.tmTotWait += x->GetTotWaitTime();
+            }
+        }
+        return st;
+    }
+
+private:
+    ECSimPdesNode(const ECSimPdesNode &);
+    ECSimPdesNode &operator=(const ECSimPdesNode &);
+
+    struct Machine
+    {
+        Machine() : pScheduler(NULL), numSent(0) {}
+
+        TScheduler *pScheduler;
+        std::vector<TTask *> listTasks;
+        std::vector<TTask *> listArrived;
+        int numSent;
+    };
+
+    // arrivals in (tick, sending machine, sequence) order: the same in any partition
+    struct LaterArrival
+    {
+        bool operator()(const ECSimMessage &m1, const ECSimMessage &m2) const
+        {
+            if (m1.tick != m2.tick)
+            {
+                return m1.tick > m2.tick;
+            }
+            if (m1.machineSrc != m2.machineSrc)
+            {
+                return m1.machineSrc > m2.machineSrc;
+            }
+            return m1.seq > m2.seq;
+        }
+    };
+
+    void SimulateTick(int tick)
+    {
+        // tasks arriving at this tick join before it is simulated
+        while (!queueArrivals.empty() && queueArrivals.top().tick <= tick)
+        {
+            const ECSimMessage &msg = queueArrivals.top();
+            ECSimTaskSpec spec;
+            spec.kind = msg.kind;
+            spec.id = msg.id;
+            spec.priority = msg.priority;
+            spec.tmStart = msg.tmStart;
+            spec.tmEnd = msg.tmEnd;
+            spec.runLen = msg.runLen;
+            spec.sleepLen = msg.sleepLen;
+            Machine &machine = listMachines[msg.machine];
+            TTask *pTask = createTask(spec);
+            machine.listArrived.push_back(pTask);
+            machine.listTasks.push_back(pTask);
+            machine.pScheduler->AddTask(pTask);
+            queueArrivals.pop();
+        }
+        for (int m = 0; m < (int)listMachines.size(); ++m)
+        {
+            TScheduler *pScheduler = listMachines[m].pScheduler;
+            if (pScheduler == NULL)
+            {
+                continue;
+            }
+            // an idle machine still follows the clock
+            if (pScheduler->GetTime() < tick && pScheduler->Step(1) == 0)
+            {
+                pScheduler->AdvanceTime(tick);
+            }
+            if (tickHook)
+            {
+                machineCurr = m;
+                tickCurr = tick;
+                tickHook(*this, m, tick);
+                machineCurr = -1;
+            }
+        }
+    }
+
+    bool SendNull(int tick)
+    {
+        if (pTransport == NULL)
+        {
+            return true;
+        }
+        ECSimMessage msg;
+        msg.type = EC_MSG_NULL;
+        msg.node = rank;
+        msg.tick = tick;
+        for (int node = 0; node < pTransport->GetNumNodes(); ++node)
+        {
+            if (node != rank)
+            {
+                if (!pTransport->Send(node, msg))
+                {
+                    return false;
+                }
+                ++numNullMessages;
+            }
+        }
+        return true;
+    }
+
+    bool ReceiveOne()
+    {
+        ECSimMessage msg;
+        if (pTransport == NULL || !pTransport->Receive(msg))
+        {
+            return false;
+        }
+        if (msg.type == EC_MSG_TASK)
+        {
+            queueArrivals.push(msg);
+        }
+        else
+        {
+            listPromised[msg.node] = std::max(listPromised[msg.node], msg.tick);
+        }
+        return true;
+    }
+
+    std::vector<int> nodeOfMachine;
+    ECSimTransport *pTransport;
+    int lookahead;
+    std::function<TTask *(const ECSimTaskSpec &)> createTask;
+    std::function<void(ECSimPdesNode &, int, int)> tickHook;
+    int rank;
+    std::vector<Machine> listMachines;
+    std::priority_queue<ECSimMessage, std::vector<ECSimMessage>, LaterArrival> queueArrivals;
+    std::vector<int> listPromised;
+    int machineCurr;
+    int tickCurr;
+    int numTaskMessages;
+    int numNullMessages;
+};
+
+#endif /* ECSimPdesNode_h */
@@ -0,0 +1,206 @@
+//
+//  ECSimPerfCounters.cpp
+//
+//
+//
+
+#include "ECSimPerfCounters.h"
+#include <cstring>
+#include <cstdint>
+#include <iomanip>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+using namespace std;
+
+namespace ecsim
+{
+
+//***********************************************************
+// Per-phase counters
+
+ECSimPerfCounters ::ECSimPerfCounters() : fdLeader(-1), numOpen(0), fOpen(false)
+{
+    for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+    {
+        listFds[i] = -1;
+        listIndex[i] = -1;
+        listBegin[i] = 0;
+        listCounted[i] = false;
+    }
+}
+
+ECSimPerfCounters ::~ECSimPerfCounters()
+{
+    CloseAll();
+}
+
+void ECSimPerfCounters ::Open()
+{
+    CloseAll();
+    fOpen = true;
+    idThread = std::this_thread::get_id();
+#ifdef __linux__
+    const unsigned long long listConfigs[EC_PERF_NUM_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+    {
+        // this thread, any cpu, user mode only; an event the machine doesn't have is left out
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = listConfigs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.disabled = fdLeader < 0 ? 1 : 0;
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, fdLeader, 0);
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (fdLeader < 0)
+        {
+            fdLeader = fd;
+        }
+        listFds[i] = fd;
+        listIndex[i] = numOpen++;
+        listCounted[i] = true;
+    }
+    if (fdLeader >= 0)
+    {
+        ioctl(fdLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fdLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+void ECSimPerfCounters ::CloseAll()
+{
+    for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+    {
+#ifdef __linux__
+        if (listFds[i] >= 0)
+        {
+            close(listFds[i]);
+        }
+#endif
+        listFds[i] = -1;
+        listIndex[i] = -1;
+    }
+    fdLeader = -1;
+    numOpen = 0;
+    fOpen = false;
+}
+
+void ECSimPerfCounters ::Read(unsigned long long listVals[]) const
+{
+    // group layout: number of events, then their values in the order they were opened
+    uint64_t buf[1 + EC_PERF_NUM_EVENTS] = {0};
+#ifdef __linux__
+    if (fdLeader >= 0 && read(fdLeader, buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t))
+    {
+        buf[0] = 0;
+    }
+#endif
+    for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+    {
+        listVals[i] = listIndex[i] >= 0 && (uint64_t)listIndex[i] < buf[0] ? buf[1 + listIndex[i]] : 0;
+    }
+}
+
+void ECSimPerfCounters ::Reset()
+{
+    for (int i = 0; i < EC_PERF_NUM_PHASES; ++i)
+    {
+        listTotals[i] = ECSimPerfTotals();
+    }
+    for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+    {
+        listCounted[i] = IsAvailable(i);
+    }
+}
+
+void ECSimPerfCounters ::Add(const ECSimPerfCounters &other)
+{
+    for (int p = 0; p < EC_PERF_NUM_PHASES; ++p)
+    {
+        ECSimPerfTotals &tot = listTotals[p];
+        const ECSimPerfTotals &totOther = other.listTotals[p];
+        tot.numCalls += totOther.numCalls;
+        tot.ns += totOther.ns;
+        for (int e = 0; e < EC_PERF_NUM_EVENTS; ++e)
+        {
+            tot.listCounts[e] += totOther.listCounts[e];
+        }
+    }
+    for (int e = 0; e < EC_PERF_NUM_EVENTS; ++e)
+    {
+        listCounted[e] = listCounted[e] || other.listCounted[e];
+    }
+}
+
+void ECSimPerfCounters ::PrintSummary(std::ostream &os) const
+{
+    const char *listPhaseNames[EC_PERF_NUM_PHASES] = {"retire", "ready", "choose", "dispatch"};
+    const char *listEventNames[EC_PERF_NUM_EVENTS] = {"cycles", "instructions", "cache-misses", "branch-misses"};
+    ios::fmtflags flags = os.flags();
+    os << left << setw(10) << "phase" << right << setw(12) << "calls" << setw(14) << "ns";
+    for (int e = 0; e < EC_PERF_NUM_EVENTS; ++e)
+    {
+        os << setw(16) << listEventNames[e];
+    }
+    os << setw(10) << "IPC" << "\n";
+    for (int p = 0; p < EC_PERF_NUM_PHASES; ++p)
+    {
+        const ECSimPerfTotals &tot = listTotals[p];
+        os << left << setw(10) << listPhaseNames[p] << right << setw(12) << tot.numCalls << setw(14) << tot.ns;
+        for (int e = 0; e < EC_PERF_NUM_EVENTS; ++e)
+        {
+            if (listCounted[e])
+            {
+                os << setw(16) << tot.listCounts[e];
+            }
+            else
+            {
+                os << setw(16) << "n/a";
+            }
+        }
+        long long numCycles = tot.listCounts[EC_PERF_CYCLES];
+        if (listCounted[EC_PERF_CYCLES] && listCounted[EC_PERF_INSTRUCTIONS] && numCycles > 0)
+        {
+            os << setw(10) << fixed << setprecision(2) << (double)tot.listCounts[EC_PERF_INSTRUCTIONS] / numCycles;
+        }
+        else
+        {
+            os << setw(10) << "n/a";
+        }
+        os << "\n";
+    }
+    // the same, per call
+    os << "per call:\n";
+    for (int p = 0; p < EC_PERF_NUM_PHASES; ++p)
+    {
+        const ECSimPerfTotals &tot = listTotals[p];
+        double numCalls = tot.numCalls > 0 ? (double)tot.numCalls : 1.0;
+        os << left << setw(10) << listPhaseNames[p] << right << setw(12) << "" << setw(14) << fixed << setprecision(1) << tot.ns / numCalls;
+        for (int e = 0; e < EC_PERF_NUM_EVENTS; ++e)
+        {
+            if (listCounted[e])
+            {
+                os << setw(16) << fixed << setprecision(1) << tot.listCounts[e] / numCalls;
+            }
+            else
+            {
+                os << setw(16) << "n/a";
+            }
+        }
+        os << "\n";
+    }
+    os.flags(flags);
+}
+
+} // namespace ecsim
@@ -0,0 +1,135 @@
+//
+//  ECSimPerfCounters.h
+//
+//
+//  Hardware performance counters for the phases of a simulated tick (Linux perf_event_open, user mode only,
+//  so no root is needed). The scheduler uses them only when built with ECSIM_PERF_COUNTERS (cmake -DECSIM_PERF=ON);
+//  otherwise the instrumentation is compiled out. Where the counters can't be opened, only the time is recorded.
+//  The kernel counts the thread that opened a counter, so they are opened by the first Begin, and again when Begin
+//  is called from another thread (e.g. a scheduler built on one thread and simulated on a worker)
+//
+
+#ifndef ECSimPerfCounters_h
+#define ECSimPerfCounters_h
+
+#include <chrono>
+#include <ostream>
+#include <thread>
+
+namespace ecsim
+{
+
+// Phases of a simulated tick
+enum ECSimPerfPhase
+{
+    EC_PERF_RETIRE = 0, // drop finished tasks (and activate started ones)
+    EC_PERF_READY,      // find the ready tasks
+    EC_PERF_CHOOSE,     // ChooseTaskToSchedule
+    EC_PERF_DISPATCH,   // Run / Wait the ready tasks
+    EC_PERF_NUM_PHASES
+};
+
+// Counted events
+enum ECSimPerfEvent
+{
+    EC_PERF_CYCLES = 0,
+    EC_PERF_INSTRUCTIONS,
+    EC_PERF_CACHE_MISSES,
+    EC_PERF_BRANCH_MISSES,
+    EC_PERF_NUM_EVENTS
+};
+
+// Totals of one phase
+struct ECSimPerfTotals
+{
+    ECSimPerfTotals() : numCalls(0), ns(0)
+    {
+        for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+        {
+            listCounts[i] = 0;
+        }
+    }
+
+    long long numCalls;
+    long long ns;
+    long long listCounts[EC_PERF_NUM_EVENTS];
+};
+
+//***********************************************************
+// Per-phase counters: Begin() before a phase, End(phase) after it
+
+class ECSimPerfCounters
+{
+public:
+    ECSimPerfCounters();
+    ~ECSimPerfCounters();
+
+    // Could this event be counted (on the thread of the last Begin; nothing is counted before the first one)?
+    bool IsAvailable(int event) const { return listIndex[event] >= 0; }
+
+    // Start a phase
+    void Begin()
+    {
+        if (!fOpen || idThread != std::this_thread::get_id())
+        {
+            Open();
+        }
+        Read(listBegin);
+        tmBegin = std::chrono::steady_clock::now();
+    }
+
+    // End a phase, adding to its totals
+    void End(int phase)
+    {
+        std::chrono::steady_clock::time_point tmEnd = std::chrono::steady_clock::now();
+        unsigned long long listEnd[EC_PERF_NUM_EVENTS];
+        Read(listEnd);
+        ECSimPerfTotals &tot = listTotals[phase];
+        ++tot.numCalls;
+        tot.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(tmEnd - tmBegin).count();
+        for (int i = 0; i < EC_PERF_NUM_EVENTS; ++i)
+        {
+            tot.listCounts[i] += (long long)(listEnd[i] - listBegin[i]);
+        }
+    }
+
+    // Totals so far, and clearing them
+    const ECSimPerfTotals &GetTotals(int phase) const { return listTotals[phase]; }
+    void Reset();
+
+    // Add the totals of other counters (e.g. those of each scheduler of a run), and the events they counted
+    void Add(const ECSimPerfCounters &other);
+
+    // Table of the totals and per-call averages of each phase (n/a for events that were never counted)
+    void PrintSummary(std::ostream &os) const;
+
+private:
+    ECSimPerfCounters(const ECSimPerfCounters &);
+    ECSimPerfCounters &operator=(const ECSimPerfCounters &);
+
+    // open the counters for the calling thread (closing those of another one), and close them
+    void Open();
+    void CloseAll();
+    // current counts (0 for events not counted)
+    void Read(unsigned long long listVals[]) const;
+
+    // the events are one group, read at once; listIndex: position of each event in the group (-1: not counted)
+    int fdLeader;
+    int listFds[EC_PERF_NUM_EVENTS];
+    int listIndex[EC_PERF_NUM_EVENTS];
+    int numOpen;
+    bool fOpen;
+    std::thread::id idThread;
+    // events counted into the totals, here or in the counters added
+    bool listCounted[EC_PERF_NUM_EVENTS];
+
+    unsigned long long listBegin[EC_PERF_NUM_EVENTS];
+    std::chrono::steady_clock::time_point tmBegin;
+    ECSimPerfTotals listTotals[EC_PERF_NUM_PHASES];
+};
+
+} // namespace ecsim
+
+using ecsim::ECSimPerfCounters;
+
+#endif /* ECSimPerfCounters_h */
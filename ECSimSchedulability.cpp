@@ -0,0 +1,406 @@
+//
+//  ECSimSchedulability.cpp
+//
+//
+//
+
+#include "ECSimSchedulability.h"
+#include <cmath>
+#include <climits>
+#include <algorithm>
+using namespace std;
+
+//***********************************************************
+// Helpers over a task set
+
+static bool IsFeasibleAlone(const ECSimTimingModel &model)
+{
+    return model.wcet <= model.deadline && (model.period == 0 || model.wcet <= model.period);
+}
+
+static bool AreFeasibleAlone(const vector<ECSimTimingModel> &listTasks)
+{
+    for (const auto &model : listTasks)
+    {
+        if (!IsFeasibleAlone(model))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// rate-monotonic bounds only cover periodic tasks with deadline == period
+static bool HasImplicitDeadlines(const vector<ECSimTimingModel> &listTasks)
+{
+    for (const auto &model : listTasks)
+    {
+        if (model.period == 0 || model.deadline != model.period)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static long long FloorDiv(long long a, long long b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+static long long Gcd(long long a, long long b)
+{
+    while (b != 0)
+    {
+        long long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// demand of the releases (all at 0, then every period) with deadlines at or before t
+static long long GetDemand(const vector<ECSimTimingModel> &listTasks, long long t)
+{
+    long long demand = 0;
+    for (const auto &model : listTasks)
+    {
+        if (t >= model.deadline)
+        {
+            demand += (model.period > 0 ? (t - model.deadline) / model.period + 1 : 1) * model.wcet;
+        }
+    }
+    return demand;
+}
+
+// latest absolute deadline before t (-1 if none)
+static long long GetDeadlineBefore(const vector<ECSimTimingModel> &listTasks, long long t)
+{
+    long long tBefore = -1;
+    for (const auto &model : listTasks)
+    {
+        if (model.deadline < t)
+        {
+            long long d = model.deadline;
+            if (model.period > 0)
+            {
+                d += (t - model.deadline - 1) / model.period * model.period;
+            }
+            tBefore = max(tBefore, d);
+        }
+    }
+    return tBefore;
+}
+
+static bool IsWindow(const ECSimTimingModel &model)
+{
+    return model.wcet == model.deadline && IsFeasibleAlone(model);
+}
+
+// do the windows [release, release + wcet) of two window tasks ever overlap?
+static bool DoWindowsOverlap(const ECSimTimingModel &m1, const ECSimTimingModel &m2)
+{
+    if (m1.wcet == 0 || m2.wcet == 0)
+    {
+        return false;
+    }
+    if (m1.period > 0 && m2.period > 0)
+    {
+        // the distance between two releases takes every value of offset2 - offset1 + k * gcd
+        long long g = Gcd(m1.period, m2.period);
+        long long r = ((long long)m2.offset - m1.offset) % g;
+        r = r < 0 ? r + g : r;
+        return r < m1.wcet || r > g - m2.wcet;
+    }
+    if (m1.period == 0 && m2.period == 0)
+    {
+        return m1.offset < (long long)m2.offset + m2.wcet && m2.offset < (long long)m1.offset + m1.wcet;
+    }
+    const ECSimTimingModel &periodic = m1.period > 0 ? m1 : m2;
+    const ECSimTimingModel &once = m1.period > 0 ? m2 : m1;
+    // first periodic window ending after the one-shot window starts
+    long long k = max(0LL, FloorDiv((long long)once.offset - periodic.wcet - periodic.offset, periodic.period) + 1);
+    return periodic.offset + k * periodic.period < (long long)once.offset + once.wcet;
+}
+
+static double GetUtilization(const vector<ECSimTimingModel> &listTasks)
+{
+    double u = 0.0;
+    for (const auto &model : listTasks)
+    {
+        if (model.period > 0)
+        {
+            u += (double)model.wcet / model.period;
+        }
+    }
+    return u;
+}
+
+static double GetDensity(const vector<ECSimTimingModel> &listTasks)
+{
+    double density = 0.0;
+    for (const auto &model : listTasks)
+    {
+        int window = model.period > 0 ? min(model.deadline, model.period) : model.deadline;
+        if (model.wcet > 0)
+        {
+            density += window > 0 ? (double)model.wcet / window : INFINITY;
+        }
+    }
+    return density;
+}
+
+static bool IsLiuLaylandSchedulable(const vector<ECSimTimingModel> &listTasks)
+{
+    if (!HasImplicitDeadlines(listTasks) || !AreFeasibleAlone(listTasks))
+    {
+        return false;
+    }
+    int n = (int)listTasks.size();
+    return n == 0 || GetUtilization(listTasks) <= n * (pow(2.0, 1.0 / n) - 1) + 1e-12;
+}
+
+static bool IsHyperbolicSchedulable(const vector<ECSimTimingModel> &listTasks)
+{
+    if (!HasImplicitDeadlines(listTasks) || !AreFeasibleAlone(listTasks))
+    {
+        return false;
+    }
+    double product = 1.0;
+    for (const auto &model : listTasks)
+    {
+        product *= (double)model.wcet / model.period + 1.0;
+    }
+    return product <= 2.0 + 1e-12;
+}
+
+static bool ComputeResponseTimes(const vector<ECSimTimingModel> &listTasks, vector<int> &listResponse)
+{
+    listResponse.assign(listTasks.size(), 0);
+    bool fAll = true;
+    for (int i = 0; i < (int)listTasks.size(); ++i)
+    {
+        const ECSimTimingModel &task = listTasks[i];
+        long long deadline = task.period > 0 ? min(task.deadline, task.period) : task.deadline;
+        // R = wcet + interference of the releases of higher (or equal) priority tasks within R
+        long long response = task.wcet;
+        while (response <= deadline)
+        {
+            long long next = task.wcet;
+            for (int j = 0; j < (int)listTasks.size(); ++j)
+            {
+                const ECSimTimingModel &other = listTasks[j];
+                if (j != i && other.priority <= task.priority)
+                {
+                    next += (other.period > 0 ? (response + other.period - 1) / other.period : 1) * other.wcet;
+                }
+            }
+            if (next == response)
+            {
+                break;
+            }
+            response = next;
+        }
+        listResponse[i] = (int)min(response, (long long)INT_MAX);
+        fAll = fAll && response <= deadline;
+    }
+    return fAll;
+}
+
+// Quick processor-demand analysis (Zhang and Burns): from the end of the interval that needs checking, jump down
+// to the demand (or to the previous deadline) until the demand either exceeds the time or falls below all deadlines
+static bool IsDemandBoundSchedulable(const vector<ECSimTimingModel> &listTasks)
+{
+    if (!AreFeasibleAlone(listTasks))
+    {
+        return false;
+    }
+    double u = GetUtilization(listTasks);
+    if (u > 1.0 + 1e-12)
+    {
+        return false;
+    }
+    long long deadlineMin = LLONG_MAX;
+    long long sumWcet = 0;
+    for (const auto &model : listTasks)
+    {
+        if (model.wcet > 0)
+        {
+            deadlineMin = min(deadlineMin, (long long)model.deadline);
+            sumWcet += model.wcet;
+        }
+    }
+    if (sumWcet == 0)
+    {
+        return true;
+    }
+    // length of the synchronous busy period: no deadline missed after it if none is missed in it
+    long long lenCheck = LLONG_MAX;
+    if (u < 1.0 - 1e-12)
+    {
+        double lenBound = 0.0;
+        double slack = 0.0;
+        for (const auto &model : listTasks)
+        {
+            if (model.period > 0)
+            {
+                lenBound = max(lenBound, (double)model.deadline - model.period);
+                slack += (double)(model.period - model.deadline) * model.wcet / model.period;
+            }
+            else
+            {
+                lenBound = max(lenBound, (double)model.deadline);
+                slack += model.wcet;
+            }
+        }
+        lenBound = max(lenBound, slack / (1.0 - u));
+        lenCheck = (long long)ceil(lenBound);
+    }
+    long long busy = sumWcet;
+    while (busy < lenCheck)
+    {
+        long long next = 0;
+        for (const auto &model : listTasks)
+        {
+            next += (model.period > 0 ? (busy + model.period - 1) / model.period : 1) * model.wcet;
+        }
+        if (next == busy)
+        {
+            break;
+        }
+        busy = next;
+    }
+    lenCheck = min(lenCheck, busy);
+
+    long long t = GetDeadlineBefore(listTasks, lenCheck + 1);
+    if (t < 0)
+    {
+        return true;
+    }
+    long long demand = GetDemand(listTasks, t);
+    while (demand <= t && demand > deadlineMin)
+    {
+        t = demand < t ? demand : GetDeadlineBefore(listTasks, t);
+        demand = GetDemand(listTasks, t);
+    }
+    return demand <= deadlineMin;
+}
+
+static bool HasDisjointWindows(const vector<ECSimTimingModel> &listTasks)
+{
+    for (int i = 0; i < (int)listTasks.size(); ++i)
+    {
+        if (!IsWindow(listTasks[i]))
+        {
+            return false;
+        }
+        for (int j = 0; j < i; ++j)
+        {
+            if (DoWindowsOverlap(listTasks[i], listTasks[j]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool IsSchedulable(const vector<ECSimTimingModel> &listTasks, ECSimSchedulabilityTest test)
+{
+    vector<int> listResponse;
+    switch (test)
+    {
+    case EC_SCHED_TEST_LIU_LAYLAND:
+        return IsLiuLaylandSchedulable(listTasks);
+    case EC_SCHED_TEST_HYPERBOLIC:
+        return IsHyperbolicSchedulable(listTasks);
+    case EC_SCHED_TEST_DENSITY:
+        return AreFeasibleAlone(listTasks) && GetDensity(listTasks) <= 1.0 + 1e-12;
+    case EC_SCHED_TEST_RESPONSE_TIME:
+        return ComputeResponseTimes(listTasks, listResponse);
+    case EC_SCHED_TEST_DEMAND_BOUND:
+        return IsDemandBoundSchedulable(listTasks);
+    case EC_SCHED_TEST_WINDOWS:
+        return HasDisjointWindows(listTasks);
+    default:
+        return true;
+    }
+}
+
+//***********************************************************
+// Analysis of a task set
+
+ECSimSchedulabilityAnalysis ::ECSimSchedulabilityAnalysis(ECSimSchedulabilityTest testAdmissionIn) : testAdmission(testAdmissionIn)
+{
+}
+
+bool ECSimSchedulabilityAnalysis ::AddTask(const ECSimTimingModel &model)
+{
+    bool fAdmit;
+    if (testAdmission == EC_SCHED_TEST_WINDOWS)
+    {
+        // the set in is already disjoint: only the new task's windows need checking
+        fAdmit = IsWindow(model);
+        for (int i = 0; fAdmit && i < (int)listTasks.size(); ++i)
+        {
+            fAdmit = !DoWindowsOverlap(listTasks[i], model);
+        }
+        if (fAdmit)
+        {
+            listTasks.push_back(model);
+        }
+        return fAdmit;
+    }
+    listTasks.push_back(model);
+    fAdmit = ::IsSchedulable(listTasks, testAdmission);
+    if (!fAdmit)
+    {
+        listTasks.pop_back();
+    }
+    return fAdmit;
+}
+
+double ECSimSchedulabilityAnalysis ::GetUtilization() const
+{
+    return ::GetUtilization(listTasks);
+}
+
+double ECSimSchedulabilityAnalysis ::GetDensity() const
+{
+    return ::GetDensity(listTasks);
+}
+
+bool ECSimSchedulabilityAnalysis ::IsLiuLaylandSchedulable() const
+{
+    return ::IsLiuLaylandSchedulable(listTasks);
+}
+
+bool ECSimSchedulabilityAnalysis ::IsHyperbolicSchedulable() const
+{
+    return ::IsHyperbolicSchedulable(listTasks);
+}
+
+bool ECSimSchedulabilityAnalysis ::IsDensitySchedulable() const
+{
+    return ::IsSchedulable(listTasks, EC_SCHED_TEST_DENSITY);
+}
+
+bool ECSimSchedulabilityAnalysis ::ComputeResponseTimes(vector<int> &listResponse) const
+{
+    return ::ComputeResponseTimes(listTasks, listResponse);
+}
+
+bool ECSimSchedulabilityAnalysis ::IsDemandBoundSchedulable() const
+{
+    return ::IsDemandBoundSchedulable(listTasks);
+}
+
+bool ECSimSchedulabilityAnalysis ::HasDisjointWindows() const
+{
+    return ::HasDisjointWindows(listTasks);
+}
+
+bool ECSimSchedulabilityAnalysis ::IsSchedulable(ECSimSchedulabilityTest test) const
+{
+    return ::IsSchedulable(listTasks, test);
+}
@@ -0,0 +1,130 @@
+//
+//  ECSimSchedulability.h
+//
+//
+//  Schedulability analysis without simulation. Each task is described by a
+//  timing model: released at offset and then every period ticks (or once),
+//  each release needs wcet ticks of run time within deadline ticks. Tasks of
+//  both generations report their model with GetTimingModel (periodic and
+//  interval tasks: they only run in their window, so wcet == deadline).
+//  The tests:
+//  (i) utilization bounds: Liu-Layland and hyperbolic (rate monotonic), density (EDF);
+//  (ii) response-time analysis for fixed priorities (lower number wins, as in ECSimPriorityScheduler);
+//  (iii) processor demand (EDF), checked at the deadlines QPA visits only;
+//  (iv) window overlap: exact, with offsets, for tasks that must run in every tick of their window.
+//  (i)-(iii) assume all tasks are released together at 0, which is the worst case for any offsets.
+//  ECSimAdmissionControl runs one of them at AddTask and keeps out the tasks that would break it.
+//
+
+#ifndef ECSimSchedulability_h
+#define ECSimSchedulability_h
+
+#include <string>
+#include <vector>
+
+//***********************************************************
+// Timing model of a task
+
+struct ECSimTimingModel
+{
+    ECSimTimingModel() : offset(0), wcet(0), period(0), deadline(0), priority(0) {}
+
+    std::string id;
+    // first release
+    int offset;
+    // run time each release needs
+    int wcet;
+    // ticks between releases (0: released once)
+    int period;
+    // relative deadline: the release must get its wcet within [release, release + deadline)
+    int deadline;
+    // fixed priority (response-time analysis only)
+    int priority;
+};
+
+enum ECSimSchedulabilityTest
+{
+    EC_SCHED_TEST_NONE = 0,
+    EC_SCHED_TEST_LIU_LAYLAND,
+    EC_SCHED_TEST_HYPERBOLIC,
+    EC_SCHED_TEST_DENSITY,
+    EC_SCHED_TEST_RESPONSE_TIME,
+    EC_SCHED_TEST_DEMAND_BOUND,
+    EC_SCHED_TEST_WINDOWS
+};
+
+//***********************************************************
+// Analysis of a task set
+
+class ECSimSchedulabilityAnalysis
+{
+public:
+    // testAdmission: the test AddTask runs (none: every task gets in)
+    ECSimSchedulabilityAnalysis(ECSimSchedulabilityTest testAdmission = EC_SCHED_TEST_NONE);
+
+    void SetAdmissionTest(ECSimSchedulabilityTest test) { testAdmission = test; }
+
+    // Add a task if the set still passes the admission test with it; return false (and leave the set alone) if not
+    bool AddTask(const ECSimTimingModel &model);
+
+    int GetNumTasks() const { return (int)listTasks.size(); }
+    const ECSimTimingModel &GetTask(int index) const { return listTasks[index]; }
+
+    // Sum of wcet / period over the periodic tasks, and of wcet / min(deadline, period) over all (one-shot tasks: wcet / deadline)
+    double GetUtilization() const;
+    double GetDensity() const;
+
+    // Sufficient tests for rate-monotonic priorities; false if some deadline differs from the period
+    bool IsLiuLaylandSchedulable() const;
+    bool IsHyperbolicSchedulable() const;
+    // Sufficient test for EDF: density at most 1
+    bool IsDensitySchedulable() const;
+
+    // Worst-case response time of each task (in order of AddTask) under fixed priorities, tasks of the same
+    // priority delaying each other and a deadline past the period counting as the period; a response time
+    // stops growing once past the deadline. True if all meet theirs
+    bool ComputeResponseTimes(std::vector<int> &listResponse) const;
+
+    // Exact test for EDF with synchronous releases: the demand up to each deadline fits in it
+    bool IsDemandBoundSchedulable() const;
+
+    // Exact test for tasks that need every tick of their window (wcet == deadline): no two windows ever overlap.
+    // False if some task has wcet < deadline
+    bool HasDisjointWindows() const;
+
+    bool IsSchedulable(ECSimSchedulabilityTest test) const;
+
+private:
+    ECSimSchedulabilityTest testAdmission;
+    std::vector<ECSimTimingModel> listTasks;
+};
+
+//***********************************************************
+// Admission control in front of a scheduler of either generation
+
+template <class TScheduler, class TTask>
+class ECSimAdmissionControl
+{
+public:
+    ECSimAdmissionControl(TScheduler &schedulerIn, ECSimSchedulabilityTest test) : scheduler(schedulerIn), analysis(test) {}
+
+    // Add the task to the scheduler unless it breaks the test; tasks without a timing model always get in
+    bool AddTask(TTask *pTask)
+    {
+        ECSimTimingModel model;
+        if (pTask->GetTimingModel(model) && !analysis.AddTask(model))
+        {
+            return false;
+        }
+        scheduler.AddTask(pTask);
+        return true;
+    }
+
+    const ECSimSchedulabilityAnalysis &GetAnalysis() const { return analysis; }
+
+private:
+    TScheduler &scheduler;
+    ECSimSchedulabilityAnalysis analysis;
+};
+
+#endif /* ECSimSchedulability_h */
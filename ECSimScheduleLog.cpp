@@ -0,0 +1,425 @@
+//
+//  ECSimScheduleLog.cpp
+//
+//
+//
+
+#include "ECSimScheduleLog.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+static const char logMagic[4] = {'E', 'C', 'S', 'L'};
+static const uint32_t logVersion = 2;
+// spells per block of the index
+static const int spellsPerBlock = 4096;
+
+// spell record: handle << 1 | run, start, end (ticks are 64-bit, as the simulation clock)
+struct ECSimSpellRecord
+{
+    uint64_t handleRun;
+    int64_t tmStart;
+    int64_t tmEnd;
+};
+
+template <class T>
+static void WriteValue(ostream &out, const T &val)
+{
+    out.write(reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+template <class T>
+static bool ReadValue(istream &in, T &val)
+{
+    return (bool)in.read(reinterpret_cast<char *>(&val), sizeof(T));
+}
+
+//***********************************************************
+// Writer
+
+ECSimScheduleLogWriter ::ECSimScheduleLogWriter() : numSpells(0)
+{
+}
+
+ECSimScheduleLogWriter ::~ECSimScheduleLogWriter()
+{
+    Close();
+}
+
+bool ECSimScheduleLogWriter ::Open(const string &path)
+{
+    Close();
+    out.open(path.c_str(), ios::binary | ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+    out.write(logMagic, sizeof(logMagic));
+    WriteValue(out, logVersion);
+    return (bool)out;
+}
+
+bool ECSimScheduleLogWriter ::Close()
+{
+    if (!out.is_open())
+    {
+        return true;
+    }
+    for (auto handle : listOpenHandles)
+    {
+        Finish(handle);
+    }
+    listOpenHandles.clear();
+    if (!listBlock.empty())
+    {
+        WriteBlock();
+    }
+    // footer: task ids, block index, blocks of each task
+    long long offsetFooter = (long long)out.tellp();
+    WriteValue(out, (uint32_t)listIds.size());
+    for (const auto &id : listIds)
+    {
+        WriteValue(out, (uint32_t)id.size());
+        out.write(id.data(), id.size());
+    }
+    WriteValue(out, (uint32_t)listBlockInfo.size());
+    for (const auto &info : listBlockInfo)
+    {
+        WriteValue(out, (int64_t)info.offset);
+        WriteValue(out, (int32_t)info.numSpells);
+        WriteValue(out, (int64_t)info.tmMinStart);
+        WriteValue(out, (int64_t)info.tmMaxEnd);
+    }
+    for (const auto &listBlocks : listTaskBlocks)
+    {
+        WriteValue(out, (uint32_t)listBlocks.size());
+        for (int block : listBlocks)
+        {
+            WriteValue(out, (int32_t)block);
+        }
+    }
+    WriteValue(out, (int64_t)offsetFooter);
+    out.write(logMagic, sizeof(logMagic));
+    bool fOk = (bool)out;
+    out.close();
+
+    mapHandles.clear();
+    listIds.clear();
+    listOpen.clear();
+    listRunning.clear();
+    listStart.clear();
+    listEnd.clear();
+    listBlockInfo.clear();
+    listTaskBlocks.clear();
+    return fOk;
+}
+
+int ECSimScheduleLogWriter ::AddTask(const void *key, const string &id)
+{
+    int handle = (int)listIds.size();
+    mapHandles[key] = handle;
+    listIds.push_back(id);
+    listOpen.push_back(0);
+    listRunning.push_back(0);
+    listStart.push_back(0);
+    listEnd.push_back(0);
+    listTaskBlocks.push_back(vector<int>());
+    return handle;
+}
+
+// Extend the task's spell if it continues from the previous tick in the same state, otherwise start a new one
+void ECSimScheduleLogWriter ::Record(ECSimTime tick, int handle, bool fRun)
+{
+    if (!out.is_open())
+    {
+        return;
+    }
+    if (listOpen[handle])
+    {
+        if ((bool)listRunning[handle] == fRun && listEnd[handle] == tick - 1)
+        {
+            listEnd[handle] = tick;
+            return;
+        }
+        // changed state (or the clock skipped ticks): the task stays in the open list with a new spell
+        Finish(handle);
+    }
+    else
+    {
+        listOpenHandles.push_back(handle);
+    }
+    listOpen[handle] = 1;
+    listRunning[handle] = fRun;
+    listStart[handle] = listEnd[handle] = tick;
+}
+
+// Spells not continued at this tick are complete
+void ECSimScheduleLogWriter ::EndTick(ECSimTime tick)
+{
+    size_t numKeep = 0;
+    for (size_t i = 0; i < listOpenHandles.size(); ++i)
+    {
+        int handle = listOpenHandles[i];
+        if (listEnd[handle] == tick)
+        {
+            listOpenHandles[numKeep++] = handle;
+        }
+        else
+        {
+            Finish(handle);
+        }
+    }
+    listOpenHandles.resize(numKeep);
+}
+
+void ECSimScheduleLogWriter ::Finish(int handle)
+{
+    if (!listOpen[handle])
+    {
+        return;
+    }
+    ECSimScheduleSpell spell;
+    spell.handle = handle;
+    spell.fRun = listRunning[handle];
+    spell.tmStart = listStart[handle];
+    spell.tmEnd = listEnd[handle];
+    listBlock.push_back(spell);
+    listOpen[handle] = 0;
+    ++numSpells;
+    int block = (int)listBlockInfo.size();
+    if (listTaskBlocks[handle].empty() || listTaskBlocks[handle].back() != block)
+    {
+        listTaskBlocks[handle].push_back(block);
+    }
+    if ((int)listBlock.size() >= spellsPerBlock)
+    {
+        WriteBlock();
+    }
+}
+
+void ECSimScheduleLogWriter ::WriteBlock()
+{
+    BlockInfo info;
+    info.offset = (long long)out.tellp();
+    info.numSpells = (int)listBlock.size();
+    info.tmMinStart = EC_TIME_MAX;
+    info.tmMaxEnd = EC_TIME_MIN;
+    for (const auto &spell : listBlock)
+    {
+        ECSimSpellRecord rec;
+        rec.handleRun = ((uint64_t)spell.handle << 1) | (spell.fRun ? 1 : 0);
+        rec.tmStart = spell.tmStart;
+        rec.tmEnd = spell.tmEnd;
+        WriteValue(out, rec);
+        info.tmMinStart = min(info.tmMinStart, spell.tmStart);
+        info.tmMaxEnd = max(info.tmMaxEnd, spell.tmEnd);
+    }
+    listBlockInfo.push_back(info);
+    listBlock.clear();
+}
+
+//***********************************************************
+// Reader
+
+bool ECSimScheduleLog ::Open(const string &path)
+{
+    listIds.clear();
+    listBlockInfo.clear();
+    listTaskBlocks.clear();
+    in.close();
+    in.clear();
+    in.open(path.c_str(), ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, logMagic, sizeof(magic)) != 0 || !ReadValue(in, version) || version != logVersion)
+    {
+        return false;
+    }
+    int64_t offsetFooter = 0;
+    in.seekg(-(int)(sizeof(int64_t) + sizeof(magic)), ios::end);
+    if (!ReadValue(in, offsetFooter) || !in.read(magic, sizeof(magic)) || memcmp(magic, logMagic, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    in.seekg(offsetFooter);
+    uint32_t num = 0;
+    if (!ReadValue(in, num))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        uint32_t len = 0;
+        if (!ReadValue(in, len))
+        {
+            return false;
+        }
+        string id(len, '\0');
+        if (len > 0 && !in.read(&id[0], len))
+        {
+            return false;
+        }
+        listIds.push_back(id);
+    }
+    if (!ReadValue(in, num))
+    {
+        return false;
+    }
+    tmFirst = EC_TIME_MAX;
+    tmLast = EC_TIME_MIN;
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        int64_t offset = 0;
+        int32_t numSpells = 0;
+        int64_t tmMinStart = 0, tmMaxEnd = 0;
+        if (!ReadValue(in, offset) || !ReadValue(in, numSpells) || !ReadValue(in, tmMinStart) || !ReadValue(in, tmMaxEnd))
+        {
+            return false;
+        }
+        BlockInfo info;
+        info.offset = offset;
+        info.numSpells = numSpells;
+        info.tmMinStart = tmMinStart;
+        info.tmMaxEnd = tmMaxEnd;
+        listBlockInfo.push_back(info);
+        tmFirst = min(tmFirst, (ECSimTime)tmMinStart);
+        tmLast = max(tmLast, (ECSimTime)tmMaxEnd);
+    }
+    if (listBlockInfo.empty())
+    {
+        tmFirst = tmLast = 0;
+    }
+    for (size_t i = 0; i < listIds.size(); ++i)
+    {
+        if (!ReadValue(in, num))
+        {
+            return false;
+        }
+        vector<int> listBlocks(num);
+        for (uint32_t k = 0; k < num; ++k)
+        {
+            int32_t block = 0;
+            if (!ReadValue(in, block))
+            {
+                return false;
+            }
+            listBlocks[k] = block;
+        }
+        listTaskBlocks.push_back(listBlocks);
+    }
+    return true;
+}
+
+int ECSimScheduleLog ::FindTask(const string &id) const
+{
+    auto it = std::find(listIds.begin(), listIds.end(), id);
+    return it == listIds.end() ? -1 : (int)(it - listIds.begin());
+}
+
+void ECSimScheduleLog ::ReadBlock(int block, vector<ECSimScheduleSpell> &listSpells) const
+{
+    const BlockInfo &info = listBlockInfo[block];
+    vector<ECSimSpellRecord> listRecs(info.numSpells);
+    in.clear();
+    in.seekg(info.offset);
+    in.read(reinterpret_cast<char *>(listRecs.data()), listRecs.size() * sizeof(ECSimSpellRecord));
+    listSpells.resize(listRecs.size());
+    for (size_t i = 0; i < listRecs.size(); ++i)
+    {
+        listSpells[i].handle = (int)(listRecs[i].handleRun >> 1);
+        listSpells[i].fRun = (listRecs[i].handleRun & 1) != 0;
+        listSpells[i].tmStart = listRecs[i].tmStart;
+        listSpells[i].tmEnd = listRecs[i].tmEnd;
+    }
+}
+
+static bool ByStart(const ECSimScheduleSpell &s1, const ECSimScheduleSpell &s2)
+{
+    return s1.tmStart < s2.tmStart || (s1.tmStart == s2.tmStart && s1.handle < s2.handle);
+}
+
+void ECSimScheduleLog ::GetSpells(ECSimTime tmFrom, ECSimTime tmTo, bool fRun, vector<ECSimScheduleSpell> &listSpells) const
+{
+    listSpells.clear();
+    vector<ECSimScheduleSpell> listBlock;
+    for (int block = 0; block < (int)listBlockInfo.size(); ++block)
+    {
+        // blocks are written in order of spell end; skip those that can't overlap
+        const BlockInfo &info = listBlockInfo[block];
+        if (info.tmMaxEnd < tmFrom || info.tmMinStart > tmTo)
+        {
+            continue;
+        }
+        ReadBlock(block, listBlock);
+        for (auto spell : listBlock)
+        {
+            if (spell.fRun == fRun && spell.tmEnd >= tmFrom && spell.tmStart <= tmTo)
+            {
+                spell.tmStart = max(spell.tmStart, tmFrom);
+                spell.tmEnd = min(spell.tmEnd, tmTo);
+                listSpells.push_back(spell);
+            }
+        }
+    }
+    std::sort(listSpells.begin(), listSpells.end(), ByStart);
+}
+
+void ECSimScheduleLog ::GetTaskSpells(int handle, bool fRun, vector<ECSimScheduleSpell> &listSpells) const
+{
+    listSpells.clear();
+    if (handle < 0 || handle >= (int)listTaskBlocks.size())
+    {
+        return;
+    }
+    vector<ECSimScheduleSpell> listBlock;
+    for (int block : listTaskBlocks[handle])
+    {
+        ReadBlock(block, listBlock);
+        for (const auto &spell : listBlock)
+        {
+            if (spell.handle == handle && spell.fRun == fRun)
+            {
+                listSpells.push_back(spell);
+            }
+        }
+    }
+    std::sort(listSpells.begin(), listSpells.end(), ByStart);
+}
+
+void ECSimScheduleLog ::GetUtilization(ECSimTime tmFrom, ECSimTime tmTo, ECSimTime window, vector<double> &listUtil) const
+{
+    listUtil.clear();
+    if (window <= 0 || tmTo < tmFrom)
+    {
+        return;
+    }
+    long long numWindows = (tmTo - tmFrom) / window + 1;
+    vector<long long> listBusy(numWindows, 0);
+    vector<ECSimScheduleSpell> listSpells;
+    GetSpells(tmFrom, tmTo, true, listSpells);
+    // one task runs per tick, so run spells never overlap
+    for (const auto &spell : listSpells)
+    {
+        ECSimTime tm = spell.tmStart;
+        while (tm <= spell.tmEnd)
+        {
+            long long w = (tm - tmFrom) / window;
+            ECSimTime tmWindowEnd = ECSimTimeAdd(tmFrom + w * window, window - 1);
+            ECSimTime tmUpTo = min(spell.tmEnd, tmWindowEnd);
+            listBusy[w] += tmUpTo - tm + 1;
+            if (tmUpTo == EC_TIME_MAX)
+            {
+                break;
+            }
+            tm = tmUpTo + 1;
+        }
+    }
+    for (long long w = 0; w < numWindows; ++w)
+    {
+        ECSimTime tmWindowStart = tmFrom + w * window;
+        ECSimTime tmWindowEnd = min(tmTo, ECSimTimeAdd(tmWindowStart, window - 1));
+        listUtil.push_back((double)listBusy[w] / (tmWindowEnd - tmWindowStart + 1));
+    }
+}
@@ -0,0 +1,153 @@
+//
+//  ECSimScheduleLog.h
+//
+//
+//  Binary schedule log: which task ran and which waited at every tick, stored
+//  as run-length-encoded spells (task handle, run/wait, [start, end]).
+//  The writer is fed by the Simulate loop; the reader answers queries from the
+//  file's index (by time block and by task) without replaying the simulation.
+//
+//  File layout: header ("ECSL", version), blocks of fixed-size spell records
+//  (a block holds the spells that ended in a run of ticks), then a footer with
+//  the task ids, the block index and each task's blocks, and finally the
+//  footer offset and "ECSL" again.
+//
+
+#ifndef ECSimScheduleLog_h
+#define ECSimScheduleLog_h
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include "ECSimTime.h"
+
+//***********************************************************
+// A maximal run of ticks in which a task kept running, or kept waiting
+
+struct ECSimScheduleSpell
+{
+    ECSimScheduleSpell() : handle(-1), fRun(false), tmStart(0), tmEnd(0) {}
+
+    int handle;
+    bool fRun;
+    ECSimTime tmStart;
+    ECSimTime tmEnd;
+};
+
+//***********************************************************
+// Writer
+
+class ECSimScheduleLogWriter
+{
+public:
+    ECSimScheduleLogWriter();
+    ~ECSimScheduleLogWriter();
+
+    // Start a new log file; return false if it can't be created
+    bool Open(const std::string &path);
+
+    // Finish the open spells and write the index; return false on I/O errors
+    bool Close();
+
+    // One simulated tick: pRun ran (may be NULL), the other ready tasks waited.
+    // Tasks are identified by address: a task must not be freed and another one created at its address during the log
+    template <class TTask>
+    void RecordTick(ECSimTime tick, const TTask *pRun, const std::vector<TTask *> &listReady)
+    {
+        for (auto x : listReady)
+        {
+            auto it = mapHandles.find(x);
+            int handle = it != mapHandles.end() ? it->second : AddTask(x, x->GetId());
+            Record(tick, handle, x == pRun);
+        }
+        EndTick(tick);
+    }
+
+    // Spells written so far
+    long long GetNumSpells() const { return numSpells; }
+
+private:
+    ECSimScheduleLogWriter(const ECSimScheduleLogWriter &);
+    ECSimScheduleLogWriter &operator=(const ECSimScheduleLogWriter &);
+
+    int AddTask(const void *key, const std::string &id);
+    void Record(ECSimTime tick, int handle, bool fRun);
+    void EndTick(ECSimTime tick);
+    void Finish(int handle);
+    void WriteBlock();
+
+    struct BlockInfo
+    {
+        long long offset;
+        int numSpells;
+        ECSimTime tmMinStart;
+        ECSimTime tmMaxEnd;
+    };
+
+    std::ofstream out;
+    std::unordered_map<const void *, int> mapHandles;
+    std::vector<std::string> listIds;
+    // open spell of each task
+    std::vector<char> listOpen;
+    std::vector<char> listRunning;
+    std::vector<ECSimTime> listStart;
+    std::vector<ECSimTime> listEnd;
+    std::vector<int> listOpenHandles;
+    // spells of the block being filled
+    std::vector<ECSimScheduleSpell> listBlock;
+    std::vector<BlockInfo> listBlockInfo;
+    // blocks in which each task has spells
+    std::vector<std::vector<int> > listTaskBlocks;
+    long long numSpells;
+};
+
+//***********************************************************
+// Reader
+
+class ECSimScheduleLog
+{
+public:
+    ECSimScheduleLog() : tmFirst(0), tmLast(0) {}
+
+    // Load the index of a log file; return false if it is not a complete schedule log
+    bool Open(const std::string &path);
+
+    int GetNumTasks() const { return (int)listIds.size(); }
+    const std::string &GetTaskId(int handle) const { return listIds[handle]; }
+    // Handle of a task by id; -1 if it never ran or waited
+    int FindTask(const std::string &id) const;
+
+    // First and last tick with a spell
+    ECSimTime GetFirstTick() const { return tmFirst; }
+    ECSimTime GetLastTick() const { return tmLast; }
+
+    // Run (or wait) spells of all tasks that overlap [tmFrom, tmTo], clipped to it, ordered by start
+    void GetSpells(ECSimTime tmFrom, ECSimTime tmTo, bool fRun, std::vector<ECSimScheduleSpell> &listSpells) const;
+
+    // All run (or wait) spells of one task, ordered by start
+    void GetTaskSpells(int handle, bool fRun, std::vector<ECSimScheduleSpell> &listSpells) const;
+
+    // Fraction of ticks in which some task ran, for each window of the given size starting at tmFrom
+    void GetUtilization(ECSimTime tmFrom, ECSimTime tmTo, ECSimTime window, std::vector<double> &listUtil) const;
+
+private:
+    struct BlockInfo
+    {
+        long long offset;
+        int numSpells;
+        ECSimTime tmMinStart;
+        ECSimTime tmMaxEnd;
+    };
+
+    void ReadBlock(int block, std::vector<ECSimScheduleSpell> &listSpells) const;
+
+    mutable std::ifstream in;
+    std::vector<std::string> listIds;
+    std::vector<BlockInfo> listBlockInfo;
+    std::vector<std::vector<int> > listTaskBlocks;
+    ECSimTime tmFirst;
+    ECSimTime tmLast;
+};
+
+#endif /* ECSimScheduleLog_h */
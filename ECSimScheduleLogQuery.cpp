@@ -0,0 +1,83 @@
+// Query a binary schedule log written by ECSimTaskScheduler::SetScheduleLog
+// Build: cmake -S . -B build && cmake --build build --target ecsim_schedlog (see CMakeLists.txt)
+// Usage: schedlog FILE info                   tasks and tick range
+//        schedlog FILE ran A B                who ran in [A,B]
+//        schedlog FILE runs|waits TASK        run / wait spells of a task
+//        schedlog FILE util A B WINDOW        utilization per window in [A,B]
+
+#include "ECSimScheduleLog.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+using namespace std;
+
+static void Usage()
+{
+    cerr << "usage: schedlog FILE info\n"
+            "       schedlog FILE ran A B\n"
+            "       schedlog FILE runs|waits TASK\n"
+            "       schedlog FILE util A B WINDOW\n";
+}
+
+static void PrintSpells(const ECSimScheduleLog &log, const vector<ECSimScheduleSpell> &listSpells)
+{
+    for (const auto &spell : listSpells)
+    {
+        cout << "[" << spell.tmStart << "," << spell.tmEnd << "] " << log.GetTaskId(spell.handle) << endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        Usage();
+        return 1;
+    }
+    ECSimScheduleLog log;
+    if (!log.Open(argv[1]))
+    {
+        cerr << "not a schedule log: " << argv[1] << endl;
+        return 1;
+    }
+    string cmd = argv[2];
+    vector<ECSimScheduleSpell> listSpells;
+    if (cmd == "info" && argc == 3)
+    {
+        cout << "tasks: " << log.GetNumTasks() << ", ticks: [" << log.GetFirstTick() << "," << log.GetLastTick() << "]" << endl;
+    }
+    else if (cmd == "ran" && argc == 5)
+    {
+        log.GetSpells(atoll(argv[3]), atoll(argv[4]), true, listSpells);
+        PrintSpells(log, listSpells);
+    }
+    else if ((cmd == "runs" || cmd == "waits") && argc == 4)
+    {
+        int handle = log.FindTask(argv[3]);
+        if (handle < 0)
+        {
+            cerr << "no such task: " << argv[3] << endl;
+            return 1;
+        }
+        log.GetTaskSpells(handle, cmd == "runs", listSpells);
+        PrintSpells(log, listSpells);
+    }
+    else if (cmd == "util" && argc == 6)
+    {
+        ECSimTime tmFrom = atoll(argv[3]);
+        ECSimTime window = atoll(argv[5]);
+        vector<double> listUtil;
+        log.GetUtilization(tmFrom, atoll(argv[4]), window, listUtil);
+        for (size_t w = 0; w < listUtil.size(); ++w)
+        {
+            cout << tmFrom + (ECSimTime)w * window << " " << listUtil[w] << endl;
+        }
+    }
+    else
+    {
+        Usage();
+        return 1;
+    }
+    return 0;
+}
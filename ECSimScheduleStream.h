@@ -0,0 +1,115 @@
+//
+//  ECSimScheduleStream.h
+//
+//
+//  Pull-based view of a simulation: each step of the scheduler is produced on
+//  demand as a (tick, running task, ready count) decision, so a consumer can
+//  inspect decisions one at a time, pause, or stop early. Nothing is buffered;
+//  the scheduler only moves when the next decision is asked for.
+//
+//      ECSimScheduleStream<ECSimTaskScheduler, ECSimTask> stream(scheduler, 100);
+//      for (const auto &d : stream) { ... if (done) break; }
+//
+
+#ifndef ECSimScheduleStream_h
+#define ECSimScheduleStream_h
+
+#include <cstddef>
+#include <iterator>
+#include "ECSimTime.h"
+
+//***********************************************************
+// One scheduling decision
+
+template <class TTask>
+struct ECSimScheduleDecision
+{
+    ECSimScheduleDecision() : tick(0), pTask(0), numReady(0), numTicks(0) {}
+
+    // last tick covered by the decision
+    ECSimTime tick;
+    // task that ran (NULL if none)
+    TTask *pTask;
+    // tasks that were ready
+    int numReady;
+    // ticks covered: 1, or more for a stretch of idle ticks skipped by the timing wheel
+    ECSimTime numTicks;
+};
+
+//***********************************************************
+// Stream over a scheduler (anything with Step, GetTime64, GetCurrTask and GetNumReady)
+
+template <class TScheduler, class TTask>
+class ECSimScheduleStream
+{
+public:
+    typedef ECSimScheduleDecision<TTask> Decision;
+
+    // duration: at most this many ticks (< 0: until no task is left), like Simulate
+    ECSimScheduleStream(TScheduler &schedulerIn, ECSimTime duration = -1) : scheduler(schedulerIn), numTicksLeft(duration < 0 ? EC_TIME_MAX : duration) {}
+
+    // Simulate the next step; return false when the simulation is over
+    bool Next(Decision &decision)
+    {
+        if (numTicksLeft <= 0)
+        {
+            return false;
+        }
+        ECSimTime numTicks = scheduler.Step(numTicksLeft);
+        if (numTicks == 0)
+        {
+            numTicksLeft = 0;
+            return false;
+        }
+        numTicksLeft -= numTicks;
+        decision.tick = scheduler.GetTime64();
+        decision.pTask = scheduler.GetCurrTask();
+        decision.numReady = scheduler.GetNumReady();
+        decision.numTicks = numTicks;
+        return true;
+    }
+
+    // Input iterator: each increment simulates one more step
+    class iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef Decision value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Decision *pointer;
+        typedef const Decision &reference;
+
+        iterator() : pStream(0) {}
+        explicit iterator(ECSimScheduleStream *pStreamIn) : pStream(pStreamIn) { ++*this; }
+
+        reference operator*() const { return decision; }
+        pointer operator->() const { return &decision; }
+        iterator &operator++()
+        {
+            if (pStream != 0 && !pStream->Next(decision))
+            {
+                pStream = 0;
+            }
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const { return pStream == rhs.pStream; }
+        bool operator!=(const iterator &rhs) const { return pStream != rhs.pStream; }
+
+    private:
+        ECSimScheduleStream *pStream;
+        Decision decision;
+    };
+
+    // Starting a new pass continues from where the previous one stopped
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    ECSimScheduleStream(const ECSimScheduleStream &);
+    ECSimScheduleStream &operator=(const ECSimScheduleStream &);
+
+    TScheduler &scheduler;
+    ECSimTime numTicksLeft;
+};
+
+#endif /* ECSimScheduleStream_h */
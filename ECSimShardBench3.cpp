@@ -0,0 +1,98 @@
+// Benchmark: sharded simulation throughput by number of threads
+// Build: cmake -S . -B build && cmake --build build --target ecsim_shardbench3 (see CMakeLists.txt)
+// Usage: shardbench [numMachines] [tasksPerMachine] [numTicks] [syncInterval]
+
+#include "ECSimTask3.h"
+#include "ECSimTaskScheduler3.h"
+#include "ECSimWorkload.h"
+#include "ECSimWorkloadTasks3.h"
+#include "ECSimShardedSimulator.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+using namespace std;
+
+#ifdef ECSIM_PERF_COUNTERS
+// phase counters of all the runs, printed once at the end
+static ECSimPerfCounters perfTotal;
+#endif
+
+// Simulate all machines with numThreads threads; return the time taken
+static double RunOnce(const vector<ECSimWorkload> &listWorkloads, int numThreads, int numTicks, bool fSynchronized, int syncInterval, long long &numShardTicks)
+{
+    vector<ECSimWorkloadTasks> listTasks(listWorkloads.size());
+    ECSimShardedSimulator<ECSimTaskScheduler, ECSimTask> sim([]()
+                                                           { return new ECSimFIFOTaskScheduler; },
+                                                           numThreads);
+    sim.SetSyncInterval(syncInterval);
+    for (size_t m = 0; m < listWorkloads.size(); ++m)
+    {
+        listTasks[m].Build(listWorkloads[m], NULL);
+        for (auto x : listTasks[m].GetTasks())
+        {
+            sim.AddTask("m" + to_string(m), x);
+        }
+    }
+    auto tmBegin = chrono::steady_clock::now();
+    sim.Simulate(numTicks, fSynchronized);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - tmBegin).count();
+    numShardTicks = sim.GetStats().numShardTicks;
+#ifdef ECSIM_PERF_COUNTERS
+    sim.AddPerfCounters(perfTotal);
+#endif
+    return secs;
+}
+
+int main(int argc, char **argv)
+{
+    int numMachines = argc > 1 ? atoi(argv[1]) : 32;
+    int tasksPerMachine = argc > 2 ? atoi(argv[2]) : 500;
+    int numTicks = argc > 3 ? atoi(argv[3]) : 20000;
+    int syncInterval = argc > 4 ? atoi(argv[4]) : 1000;
+
+    vector<ECSimWorkload> listWorkloads(numMachines);
+    ECSimWorkloadConfig config;
+    config.numTasks = tasksPerMachine;
+    config.tmHorizon = numTicks;
+    for (int m = 0; m < numMachines; ++m)
+    {
+        config.seed = 1 + m;
+        ECSimWorkloadGenerator(config).Generate(listWorkloads[m]);
+    }
+
+    int numCores = max(1, (int)thread::hardware_concurrency());
+    vector<int> listThreads;
+    for (int n = 1; n < numCores; n *= 2)
+    {
+        listThreads.push_back(n);
+    }
+    listThreads.push_back(numCores);
+    vector<string> listLines;
+    double secsBase[2] = {0, 0};
+    for (int n : listThreads)
+    {
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            long long numShardTicks = 0;
+            double secs = RunOnce(listWorkloads, n, numTicks, mode == 1, syncInterval, numShardTicks);
+            if (n == 1)
+            {
+                secsBase[mode] = secs;
+            }
+            listLines.push_back(string(mode == 1 ? "synchronized" : "decoupled   ") + " threads " + to_string(n) + ": " + to_string(secs) + " s, " +
+                                to_string((long long)(numShardTicks / secs)) + " shard-ticks/s, speedup " + to_string(secsBase[mode] / secs));
+        }
+    }
+    cout << numMachines << " machines, " << tasksPerMachine << " tasks each, " << numTicks << " ticks, " << numCores << " cores" << endl;
+    for (const auto &line : listLines)
+    {
+        cout << line << endl;
+    }
+#ifdef ECSIM_PERF_COUNTERS
+    perfTotal.PrintSummary(cerr);
+#endif
+    return 0;
+}
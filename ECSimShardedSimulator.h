@@ -0,0 +1,277 @@
+//
+//  ECSimShardedSimulator.h
+//
+//
+//  Sharded simulation: tasks are partitioned by a machine key into independent
+//  schedulers (one simulated CPU each), which are advanced in parallel by a
+//  pool of threads. Shards either run fully decoupled, each to its own end, or
+//  in tick-synchronized epochs: no shard starts epoch k+1 before all of them
+//  finished epoch k, and an optional hook sees every shard at the same tick.
+//  Metrics of all shards are merged at the end.
+//
+
+#ifndef ECSimShardedSimulator_h
+#define ECSimShardedSimulator_h
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include "ECSimPerfCounters.h"
+
+//***********************************************************
+// Merged metrics
+
+struct ECSimShardedStats
+{
+    ECSimShardedStats() : numShards(0), numTasks(0), numTicks(0), numShardTicks(0), tmTotRun(0), tmTotWait(0) {}
+
+    int numShards;
+    int numTasks;
+    // ticks simulated by the longest-running shard
+    int numTicks;
+    // ticks simulated by all shards together
+    long long numShardTicks;
+    // run / wait time of all tasks
+    long long tmTotRun;
+    long long tmTotWait;
+};
+
+//***********************************************************
+
+template <class TScheduler, class TTask>
+class ECSimShardedSimulator
+{
+public:
+    // createScheduler makes the scheduler of a new shard (the simulator owns it); numThreads <= 0: one per core
+    ECSimShardedSimulator(const std::function<TScheduler *()> &createSchedulerIn, int numThreadsIn = 0)
+        : createScheduler(createSchedulerIn), numThreads(numThreadsIn), syncInterval(1)
+    {
+        if (numThreads <= 0)
+        {
+            numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+    }
+
+    ~ECSimShardedSimulator()
+    {
+        for (auto &shard : listShards)
+        {
+            delete shard.pScheduler;
+        }
+    }
+
+    // Add a task to the shard of a machine (created on first use); a task must belong to one shard only
+    void AddTask(const std::string &key, TTask *pTask)
+    {
+        auto it = mapShards.find(key);
+        int index;
+        if (it == mapShards.end())
+        {
+            index = (int)listShards.size();
+            mapShards[key] = index;
+            Shard shard;
+            shard.key = key;
+            shard.pScheduler = createScheduler();
+            listShards.push_back(shard);
+        }
+        else
+        {
+            index = it->second;
+        }
+        listShards[index].pScheduler->AddTask(pTask);
+        listShards[index].listTasks.push_back(pTask);
+    }
+
+    int GetNumShards() const { return (int)listShards.size(); }
+    const std::string &GetShardKey(int shard) const { return listShards[shard].key; }
+    TScheduler &GetShardScheduler(int shard) { return *listShards[shard].pScheduler; }
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of every shard's scheduler to perf (to print once the run is over)
+    void AddPerfCounters(ECSimPerfCounters &perf) const
+    {
+        for (const auto &shard : listShards)
+        {
+            perf.Add(shard.pScheduler->GetPerfCounters());
+        }
+    }
+#endif
+    // Ticks the shard simulated in the last Simulate
+    int GetShardTicks(int shard) const { return listShards[shard].numTicks; }
+
+    // Tick-synchronized mode: length of an epoch in ticks (1: lockstep)
+    void SetSyncInterval(int ticks) { syncInterval = std::max(1, ticks); }
+
+    // Tick-synchronized mode: called by one thread at the end of each epoch, while all shards are stopped at tick (or finished earlier)
+    void SetEpochHook(const std::function<void(int tick)> &hook) { epochHook = hook; }
+
+    // Simulate every shard for duration ticks (< 0: until its tasks are done), decoupled or tick-synchronized.
+    // Return the ticks simulated by the longest-running shard
+    int Simulate(int duration, bool fSynchronized)
+    {
+        int durationUse = duration < 0 ? INT_MAX : duration;
+        for (auto &shard : listShards)
+        {
+            shard.numTicks = 0;
+            shard.fDone = false;
+        }
+        if (fSynchronized)
+        {
+            SimulateSynchronized(durationUse);
+        }
+        else
+        {
+            // each shard runs to its end; threads take the next shard that is left
+            std::atomic<int> next(0);
+            RunWorkers([&]()
+                       {
+                int index;
+                while ((index = next.fetch_add(1)) < (int)listShards.size())
+                {
+                    listShards[index].numTicks = listShards[index].pScheduler->Simulate(duration);
+                } });
+        }
+        int numTicks = 0;
+        for (const auto &shard : listShards)
+        {
+            numTicks = std::max(numTicks, shard.numTicks);
+        }
+        return numTicks;
+    }
+
+    // Merge the metrics of all shards
+    ECSimShardedStats GetStats() const
+    {
+        ECSimShardedStats st;
+        st.numShards = (int)listShards.size();
+        for (const auto &shard : listShards)
+        {
+            st.numTasks += (int)shard.listTasks.size();
+            st.numTicks = std::max(st.numTicks, shard.numTicks);
+            st.numShardTicks += shard.numTicks;
+            for (auto x : shard.listTasks)
+            {
+                st.tmTotRun += x->GetTotRunTime();
+                st.tmTotWait += x->GetTotWaitTime();
+            }
+        }
+        return st;
+    }
+
+private:
+    ECSimShardedSimulator(const ECSimShardedSimulator &);
+    ECSimShardedSimulator &operator=(const ECSimShardedSimulator &);
+
+    struct Shard
+    {
+        Shard() : pScheduler(NULL), numTicks(0), fDone(false) {}
+
+        std::string key;
+        TScheduler *pScheduler;
+        std::vector<TTask *> listTasks;
+        int numTicks;
+        bool fDone;
+    };
+
+    // Run the work on min(numThreads, shards) threads, the calling thread being one of them
+    void RunWorkers(const std::function<void()> &work)
+    {
+        int num = std::min(numThreads, (int)listShards.size());
+        std::vector<std::thread> listThreads;
+        for (int i = 1; i < num; ++i)
+        {
+            listThreads.push_back(std::thread(work));
+        }
+        work();
+        for (auto &t : listThreads)
+        {
+            t.join();
+        }
+    }
+
+    void SimulateSynchronized(int durationUse)
+    {
+        if (listShards.empty())
+        {
+            return;
+        }
+        int numWorkers = std::min(numThreads, (int)listShards.size());
+        // epoch state, changed only by the last thread to arrive at the barrier
+        int tickEnd = (int)std::min((long long)durationUse, (long long)syncInterval);
+        bool fStop = false;
+        std::atomic<int> next(0);
+        std::atomic<int> numActive(0);
+        std::mutex mtx;
+        std::condition_variable cv;
+        int numArrived = 0;
+        unsigned generation = 0;
+
+        RunWorkers([&]()
+                   {
+            while (true)
+            {
+                int tickEndCur = tickEnd;
+                int index;
+                while ((index = next.fetch_add(1)) < (int)listShards.size())
+                {
+                    Shard &shard = listShards[index];
+                    // Step never goes past the end of the epoch
+                    while (!shard.fDone && shard.numTicks < tickEndCur)
+                    {
+                        int numTicks = (int)shard.pScheduler->Step(tickEndCur - shard.numTicks);
+                        if (numTicks == 0)
+                        {
+                            shard.fDone = true;
+                        }
+                        shard.numTicks += numTicks;
+                    }
+                    if (!shard.fDone)
+                    {
+                        ++numActive;
+                    }
+                }
+                std::unique_lock<std::mutex> lock(mtx);
+                unsigned gen = generation;
+                if (++numArrived == numWorkers)
+                {
+                    // last one in: finish the epoch and set up the next
+                    if (epochHook)
+                    {
+                        epochHook(tickEndCur);
+                    }
+                    fStop = numActive.load() == 0 || tickEndCur >= durationUse;
+                    tickEnd = (int)std::min((long long)durationUse, (long long)tickEndCur + syncInterval);
+                    next = 0;
+                    numActive = 0;
+                    numArrived = 0;
+                    ++generation;
+                    cv.notify_all();
+                }
+                else
+                {
+                    cv.wait(lock, [&]()
+                            { return generation != gen; });
+                }
+                if (fStop)
+                {
+                    return;
+                }
+            } });
+    }
+
+    std::function<TScheduler *()> createScheduler;
+    int numThreads;
+    int syncInterval;
+    std::function<void(int)> epochHook;
+    std::vector<Shard> listShards;
+    std::unordered_map<std::string, int> mapShards;
+};
+
+#endif /* ECSimShardedSimulator_h */
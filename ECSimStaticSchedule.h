@@ -0,0 +1,270 @@
+//
+//  ECSimStaticSchedule.h
+//
+//
+//  Compile-time schedules for fixed task sets: the ECSimTask / ECSimTask2 interval and periodic kinds as literal
+//  types, and FIFO / priority policies that run a whole simulation in a constant expression. The result is a
+//  table of which task runs at each tick, e.g.
+//
+//      constexpr std::array<ECSimStaticTask, 2> listTasks = {{ECSimStaticTask::SoftInterval(3, 5), ECSimStaticTask::HardInterval(4, 6)}};
+//      constexpr auto schedule = ECSimStaticSimulate<ECSimStaticFIFOScheduler, 10>(listTasks);
+//      static_assert(schedule.numTicks == 6, "");
+//      constexpr std::array<int, 10> table = schedule.GetTable();
+//
+//  A table entry is the index of the task run at that tick (entry i is tick i + 1), -1 if none. The decisions and
+//  counters are those ECSimFIFOTaskScheduler / ECSimPriorityScheduler make on the same tasks (needs C++14); the task
+//  and policy rules are those of the flat task model (ECSimFlatTask.h)
+//
+
+#ifndef ECSimStaticSchedule_h
+#define ECSimStaticSchedule_h
+
+#include <array>
+#include <cstddef>
+#include <climits>
+#include <utility>
+#include "ECSimFlatTask.h"
+
+namespace ecsim
+{
+
+//***********************************************************
+// Task of a compile-time schedule: what it is (the same kinds and rules as ECSimTask.h / ECSimTask2.h)
+
+struct ECSimStaticTask
+{
+    enum
+    {
+        MAX_INTERVALS = 8
+    };
+
+    constexpr ECSimStaticTask() : kind(EC_FLAT_SOFT_INTERVAL), priority(0), numIntervals(0), listStarts{}, listEnds{}, runLen(0), sleepLen(0) {}
+
+    static constexpr ECSimStaticTask SoftInterval(int tmStart, int tmEnd, int priority = 0) { return Make(EC_FLAT_SOFT_INTERVAL, tmStart, tmEnd, priority); }
+    static constexpr ECSimStaticTask HardInterval(int tmStart, int tmEnd, int priority = 0) { return Make(EC_FLAT_HARD_INTERVAL, tmStart, tmEnd, priority); }
+    static constexpr ECSimStaticTask ConsecutiveInterval(int tmStart, int tmEnd, int priority = 0) { return Make(EC_FLAT_CONSECUTIVE_INTERVAL, tmStart, tmEnd, priority); }
+
+    // Runs runLen ticks from tmStart, sleeps sleepLen, and so on
+    static constexpr ECSimStaticTask Periodic(int tmStart, int runLen, int sleepLen, int priority = 0)
+    {
+        ECSimStaticTask task = Make(EC_FLAT_PERIODIC, tmStart, tmStart, priority);
+        task.runLen = runLen;
+        task.sleepLen = sleepLen;
+        return task;
+    }
+
+    // No interval yet: add them with AddInterval (at most MAX_INTERVALS)
+    static constexpr ECSimStaticTask MultiIntervals(int priority = 0)
+    {
+        ECSimStaticTask task;
+        task.kind = EC_FLAT_MULTI_INTERVALS;
+        task.priority = priority;
+        return task;
+    }
+    constexpr ECSimStaticTask AddInterval(int a, int b) const
+    {
+        ECSimStaticTask task = *this;
+        task.listStarts[task.numIntervals] = a;
+        task.listEnds[task.numIntervals] = b;
+        ++task.numIntervals;
+        return task;
+    }
+
+    ECSimFlatTaskKind kind;
+    int priority;
+    int numIntervals;
+    int listStarts[MAX_INTERVALS];
+    int listEnds[MAX_INTERVALS];
+    int runLen;
+    int sleepLen;
+
+private:
+    static constexpr ECSimStaticTask Make(ECSimFlatTaskKind kind, int tmStart, int tmEnd, int priority)
+    {
+        ECSimStaticTask task;
+        task.kind = kind;
+        task.priority = priority;
+        task = task.AddInterval(tmStart, tmEnd);
+        return task;
+    }
+};
+
+//***********************************************************
+// Changing state of a task in a compile-time schedule, and the task rules on it
+
+struct ECSimStaticTaskState
+{
+    constexpr ECSimStaticTaskState() : tmTotWait(0), tmTotRun(0), fStarted(false), fInterrupted(false), fHard(false) {}
+
+    constexpr bool IsReadyToRun(const ECSimStaticTask &task, int tick) const
+    {
+        return !(task.kind == EC_FLAT_CONSECUTIVE_INTERVAL && fInterrupted) &&
+               ECSimFlatIsTimeReady(task.kind, tick, task.listStarts, task.listEnds, task.numIntervals, task.runLen, task.runLen + task.sleepLen);
+    }
+
+    constexpr bool IsFinished(const ECSimStaticTask &task, int tick) const
+    {
+        return (task.kind == EC_FLAT_HARD_INTERVAL && fHard) || (task.kind == EC_FLAT_CONSECUTIVE_INTERVAL && fInterrupted) ||
+               tick >= ECSimFlatFinishTick(task.kind, task.listEnds, task.numIntervals, INT_MAX);
+    }
+
+    constexpr void Run(const ECSimStaticTask &task, int tick)
+    {
+        if (task.kind == EC_FLAT_CONSECUTIVE_INTERVAL)
+        {
+            // as ECConsecutiveIntervalTask: the started flag flips with each tick run
+            if (!fInterrupted)
+            {
+                ++tmTotRun;
+                fStarted = !fStarted;
+            }
+        }
+        else if (task.kind != EC_FLAT_PERIODIC || IsReadyToRun(task, tick))
+        {
+            ++tmTotRun;
+        }
+    }
+
+    constexpr void Wait(const ECSimStaticTask &task, int /*tick*/)
+    {
+        if (task.kind == EC_FLAT_CONSECUTIVE_INTERVAL && fStarted)
+        {
+            fInterrupted = true;
+        }
+        if (task.kind == EC_FLAT_HARD_INTERVAL)
+        {
+            fHard = true;
+        }
+        ++tmTotWait;
+    }
+
+    int tmTotWait;
+    int tmTotRun;
+    bool fStarted;
+    bool fInterrupted;
+    bool fHard;
+};
+
+//***********************************************************
+// Policies: pick among the ready tasks (indices in the order the tasks were given)
+
+// First ready task, as ECSimFIFOTaskScheduler
+struct ECSimStaticFIFOScheduler
+{
+    template <size_t NumTasks>
+    static constexpr int Choose(const std::array<ECSimStaticTask, NumTasks> &/*listTasks*/, const int *listReady, int numReady)
+    {
+        return numReady > 0 ? listReady[0] : -1;
+    }
+};
+
+// Smallest priority value, the first of equal ones, as ECSimPriorityScheduler
+struct ECSimStaticPriorityScheduler
+{
+    template <size_t NumTasks>
+    static constexpr int Choose(const std::array<ECSimStaticTask, NumTasks> &listTasks, const int *listReady, int numReady)
+    {
+        int next = -1;
+        for (int i = 0; i < numReady; ++i)
+        {
+            if (next < 0 || ECSimFlatPrefers(EC_POLICY_PRIORITY, 0, 0, listTasks[listReady[i]].priority, 0, 0, listTasks[next].priority))
+            {
+                next = listReady[i];
+            }
+        }
+        return next;
+    }
+};
+
+//***********************************************************
+// A compile-time schedule of NumTicks ticks
+
+template <size_t NumTicks, size_t NumTasks>
+struct ECSimStaticSchedule
+{
+    constexpr ECSimStaticSchedule() : numTicks(0), listRun{}, listStates{} {}
+
+    // The per-tick table
+    constexpr std::array<int, NumTicks> GetTable() const { return GetTable(std::make_index_sequence<NumTicks>()); }
+
+    // Task run at a tick (1 to NumTicks), -1 if none
+    constexpr int GetTask(int tick) const { return listRun[tick - 1]; }
+
+    // Ticks simulated, as Simulate returns: fewer than NumTicks if all tasks finished before
+    int numTicks;
+    int listRun[NumTicks];
+    // counters of each task at the end
+    ECSimStaticTaskState listStates[NumTasks];
+
+private:
+    template <size_t... Ticks>
+    constexpr std::array<int, NumTicks> GetTable(std::index_sequence<Ticks...>) const { return {{listRun[Ticks]...}}; }
+};
+
+// Simulate NumTicks ticks (or until no task is left) of the tasks with the policy TScheduler, as Simulate(NumTicks)
+// of the runtime scheduler would
+template <class TScheduler, size_t NumTicks, size_t NumTasks>
+constexpr ECSimStaticSchedule<NumTicks, NumTasks> ECSimStaticSimulate(const std::array<ECSimStaticTask, NumTasks> &listTasks)
+{
+    ECSimStaticSchedule<NumTicks, NumTasks> schedule;
+    bool listActive[NumTasks + 1] = {};
+    for (size_t i = 0; i < NumTasks; ++i)
+    {
+        listActive[i] = true;
+    }
+    for (size_t i = 0; i < NumTicks; ++i)
+    {
+        schedule.listRun[i] = -1;
+    }
+    int listReady[NumTasks + 1] = {};
+    for (int tick = 1; tick <= (int)NumTicks; ++tick)
+    {
+        // tasks finished by this tick leave for good; stop when none is left
+        int numActive = 0;
+        for (size_t i = 0; i < NumTasks; ++i)
+        {
+            if (listActive[i] && schedule.listStates[i].IsFinished(listTasks[i], tick))
+            {
+                listActive[i] = false;
+            }
+            numActive += listActive[i] ? 1 : 0;
+        }
+        if (numActive == 0)
+        {
+            break;
+        }
+        int numReady = 0;
+        for (size_t i = 0; i < NumTasks; ++i)
+        {
+            if (listActive[i] && schedule.listStates[i].IsReadyToRun(listTasks[i], tick))
+            {
+                listReady[numReady++] = (int)i;
+            }
+        }
+        int next = TScheduler::Choose(listTasks, listReady, numReady);
+        for (int i = 0; i < numReady; ++i)
+        {
+            if (listReady[i] == next)
+            {
+                schedule.listStates[next].Run(listTasks[next], tick);
+            }
+            else
+            {
+                schedule.listStates[listReady[i]].Wait(listTasks[listReady[i]], tick);
+            }
+        }
+        schedule.listRun[tick - 1] = next;
+        schedule.numTicks = tick;
+    }
+    return schedule;
+}
+
+} // namespace ecsim
+
+using ecsim::ECSimStaticTask;
+using ecsim::ECSimStaticSchedule;
+using ecsim::ECSimStaticFIFOScheduler;
+using ecsim::ECSimStaticPriorityScheduler;
+using ecsim::ECSimStaticSimulate;
+
+#endif /* ECSimStaticSchedule_h */
@@ -0,0 +1,105 @@
+//
+//  ECSimStatsSnapshot.h
+//
+//
+//  Read-only statistics of a running simulation. The Simulate loop publishes
+//  them through a sequence lock, so a monitoring thread can poll while the
+//  simulation runs without taking a lock and without blocking the writer.
+//
+
+#ifndef ECSimStatsSnapshot_h
+#define ECSimStatsSnapshot_h
+
+#include <atomic>
+#include "ECSimTime.h"
+
+//***********************************************************
+// One consistent view of the simulation state
+
+template <class TTask>
+struct ECSimStats
+{
+    ECSimStats() : tick(0), numTasks(0), numReady(0), pTaskCurr(0), tmTotWait(0), tmTotRun(0) {}
+
+    // simulation clock when the snapshot was taken (64-bit, as GetTime64)
+    ECSimTime tick;
+    // tasks still in the scheduler (not finished or aborted)
+    int numTasks;
+    // tasks that were ready at this tick
+    int numReady;
+    // task scheduled at this tick (NULL if none); only the pointer is published, don't modify the task through it
+    const TTask *pTaskCurr;
+    // aggregate wait / run time of all tasks since the scheduler was created
+    long long tmTotWait;
+    long long tmTotRun;
+};
+
+//***********************************************************
+// Single writer (the Simulate loop), any number of readers
+
+template <class TTask>
+class ECSimStatsPublisher
+{
+public:
+    ECSimStatsPublisher() : seq(0), tick(0), numTasks(0), numReady(0), pTaskCurr(0), tmTotWait(0), tmTotRun(0) {}
+
+    // Writer side: publish a new snapshot
+    void Publish(const ECSimStats<TTask> &st)
+    {
+        unsigned s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        tick.store(st.tick, std::memory_order_relaxed);
+        numTasks.store(st.numTasks, std::memory_order_relaxed);
+        numReady.store(st.numReady, std::memory_order_relaxed);
+        pTaskCurr.store(st.pTaskCurr, std::memory_order_relaxed);
+        tmTotWait.store(st.tmTotWait, std::memory_order_relaxed);
+        tmTotRun.store(st.tmTotRun, std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // Reader side: try once; return false if the writer was in the middle of an update
+    bool TryRead(ECSimStats<TTask> &st) const
+    {
+        unsigned s1 = seq.load(std::memory_order_acquire);
+        if (s1 & 1)
+        {
+            return false;
+        }
+        st.tick = tick.load(std::memory_order_relaxed);
+        st.numTasks = numTasks.load(std::memory_order_relaxed);
+        st.numReady = numReady.load(std::memory_order_relaxed);
+        st.pTaskCurr = pTaskCurr.load(std::memory_order_relaxed);
+        st.tmTotWait = tmTotWait.load(std::memory_order_relaxed);
+        st.tmTotRun = tmTotRun.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return seq.load(std::memory_order_relaxed) == s1;
+    }
+
+    // Reader side: retry until a consistent snapshot is obtained
+    ECSimStats<TTask> Read() const
+    {
+        ECSimStats<TTask> st;
+        while (!TryRead(st))
+        {
+        }
+        return st;
+    }
+
+    // Number of snapshots published so far
+    unsigned GetVersion() const { return seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    ECSimStatsPublisher(const ECSimStatsPublisher &);
+    ECSimStatsPublisher &operator=(const ECSimStatsPublisher &);
+
+    std::atomic<unsigned> seq;
+    std::atomic<long long> tick;
+    std::atomic<int> numTasks;
+    std::atomic<int> numReady;
+    std::atomic<const TTask *> pTaskCurr;
+    std::atomic<long long> tmTotWait;
+    std::atomic<long long> tmTotRun;
+};
+
+#endif /* ECSimStatsSnapshot_h */
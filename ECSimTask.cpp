@@ -2,35 +2,50 @@
 //  ECSimTask.cpp
 //
 //
-//  DON'T CHANGE THIS FILE!!
 //
 
 #include "ECSimTask.h"
-
-//***********************************************************
-// Generic simulation task
-
-// Each task has a name
-ECSimTask ::ECSimTask(const std ::string &tidIn) : tid(tidIn), tmTotWait(0), tmTotRun(0), pri(0)
-{
-}
+#include "ECSimSchedulability.h"
+#include <algorithm>
 
 //***********************************************************
 // One-shot task: a task spans a single interval [a,b] of time; this task has soft deadline: it can only run within [a,b] but differently from hard interval: it can run partially as long as the time is within [a,b]
 
-ECSoftIntervalTask ::ECSoftIntervalTask(const std::string &tid, int tmStartIn, int tmEndIn) : ECSimTask(tid), tmStart(tmStartIn), tmEnd(tmEndIn)
+ECSoftIntervalTask ::ECSoftIntervalTask(const std::string &tid, ECSimTime tmStartIn, ECSimTime tmEndIn) : ECSimTask(tid), tmStart(tmStartIn), tmEnd(tmEndIn)
 {
 }
 
 // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-bool ECSoftIntervalTask ::IsReadyToRun(int tick) const
+bool ECSoftIntervalTask ::IsReadyToRun(ECSimTime tick) const
 {
     // as long as tick is within the specified interval, it is ready
     return tick >= tmStart && tick <= tmEnd;
 }
 
 // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-bool ECSoftIntervalTask ::IsFinished(int tick) const
+bool ECSoftIntervalTask ::IsFinished(ECSimTime tick) const
 {
     return tick > tmEnd;
 }
+
+// Earliest tick at which the task may be ready to run or finished
+ECSimTime ECSoftIntervalTask ::GetStartTime() const
+{
+    return tmStart <= tmEnd ? tmStart : ECSimTimeAdd(tmEnd, 1);
+}
+
+ECSimTime ECSoftIntervalTask ::GetNextEventTime(ECSimTime tick) const
+{
+    return std::max(tick, GetStartTime());
+}
+
+bool ECSoftIntervalTask ::GetTimingModel(ECSimTimingModel &model) const
+{
+    model = ECSimTimingModel();
+    model.id = GetId();
+    model.offset = ECSimTimeToInt(tmStart);
+    model.wcet = tmEnd >= tmStart ? ECSimTimeToInt(ECSimTimeAdd(tmEnd - tmStart, 1)) : 0;
+    model.deadline = model.wcet;
+    model.priority = GetPriority();
+    return true;
+}
@@ -3,75 +3,45 @@
 //
 //
 //  Simulation task: different types
-//  DON'T CHANGE THIS FILE!!
 //
 
 #ifndef ECSimTask_h
 #define ECSimTask_h
 
 #include <string>
+#include <climits>
+#include "ECSimTaskBase.h"
+
+using ecsim::ECSimTask;
 
 //***********************************************************
-// Generic simulation task
+// One-shot task: a task spans a single interval [a,b] (inclusive of both ends) of time; this task has soft deadline: it can only run within [a,b] but differently from hard interval: it can run partially as long as the time is within [a,b]
 
-class ECSimTask
+class ECSoftIntervalTask : public ECSimTask
 {
 public:
-    // Each task has a name
-    ECSimTask(const std ::string &tid);
-
-    std::string GetId() const { return tid; }
+    ECSoftIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd);
 
     // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-    virtual bool IsReadyToRun(int tick) const = 0;
+    virtual bool IsReadyToRun(ECSimTime tick) const;
 
     // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-    virtual bool IsFinished(int tick) const = 0;
-
-    // Run the task for some duration (usually 1, but can be more) starting from time tick
-    virtual void Run(int tick, int duration) { tmTotRun += duration; }
-
-    // Wait for some duration (usually 1, but can be more), starting from time tick
-    virtual void Wait(int tick, int duration) { tmTotWait += duration; }
-
-    // How much total time does the task has to wait to get its turn so far?
-    virtual int GetTotWaitTime() const { return tmTotWait; }
-
-    // Set total run-time (so far)
-    virtual int GetTotRunTime() const { return tmTotRun; }
-
-    // virtual void SetTotWaitTime(int time) { tmTotWait += time; }
-    // // Set total run-time (so far)
-    // virtual void SetTotRunTime(int time) { tmTotRun += time; }
-
-    // priority
-    void SetPriority(int p) { pri = p; }
-    int GetPriority() const { return pri; }
+    virtual bool IsFinished(ECSimTime tick) const;
 
-private:
-    std::string tid;
-    int tmTotWait;
-    int tmTotRun;
-    int pri;
-};
-
-//***********************************************************
-// One-shot task: a task spans a single interval [a,b] (inclusive of both ends) of time; this task has soft deadline: it can only run within [a,b] but differently from hard interval: it can run partially as long as the time is within [a,b]
+    // Earliest tick at which the task may be ready to run or finished
+    virtual ECSimTime GetStartTime() const;
 
-class ECSoftIntervalTask : public ECSimTask
-{
-public:
-    ECSoftIntervalTask(const std::string &tid, int tmStart, int tmEnd);
+    // Every tick from the start on is ready or finished
+    virtual ECSimTime GetNextEventTime(ECSimTime tick) const;
 
-    // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-    virtual bool IsReadyToRun(int tick) const;
+    // Released once at tmStart, it needs the whole interval
+    virtual bool GetTimingModel(ECSimTimingModel &model) const;
 
-    // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-    virtual bool IsFinished(int tick) const;
+    virtual size_t GetMemoryUsage() const { return sizeof(*this); }
 
 private:
-    int tmStart;
-    int tmEnd;
+    ECSimTime tmStart;
+    ECSimTime tmEnd;
 };
 
 #endif /* ECSimTask_h */
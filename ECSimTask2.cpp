@@ -6,7 +6,9 @@
 //
 
 #include "ECSimTask2.h"
+#include "ECSimSchedulability.h"
 #include <iostream>
+#include <algorithm>
 
 //***********************************************************
 // One-shot task: a task spans a single interval [a,b] of time; this task has soft deadline: it can only run within [a,b] but differently from hard interval: it can run partially as long as the time is within [a,b]
@@ -16,14 +18,14 @@ ECMultiIntervalsTask ::ECMultiIntervalsTask(const std::string &tid) : ECSimTask(
 }
 
 // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-void ECMultiIntervalsTask ::AddInterval(int a, int b)
+void ECMultiIntervalsTask ::AddInterval(ECSimTime a, ECSimTime b)
 {
 
     intervals.push_back(std::make_pair(a, b));
     // std::cout << intervals.size() << std::endl;
 }
 
-bool ECMultiIntervalsTask ::IsReadyToRun(int tick) const
+bool ECMultiIntervalsTask ::IsReadyToRun(ECSimTime tick) const
 {
     for (const auto &interval : intervals)
     {
@@ -38,13 +40,37 @@ bool ECMultiIntervalsTask ::IsReadyToRun(int tick) const
     return false;
 }
 
-bool ECMultiIntervalsTask ::IsFinished(int tick) const
+bool ECMultiIntervalsTask ::IsFinished(ECSimTime tick) const
 {
     // beyond last interval, finish
     return tick > intervals.back().second;
 }
 
-void ECMultiIntervalsTask ::Wait(int tick, int duration)
+ECSimTime ECMultiIntervalsTask ::GetStartTime() const
+{
+    // the earliest interval (they may be added in any order), or the end of the last one
+    ECSimTime tmStart = ECSimTimeAdd(intervals.back().second, 1);
+    for (const auto &interval : intervals)
+    {
+        tmStart = std::min(tmStart, interval.first);
+    }
+    return tmStart;
+}
+
+ECSimTime ECMultiIntervalsTask ::GetNextEventTime(ECSimTime tick) const
+{
+    ECSimTime tmNext = std::max(tick, ECSimTimeAdd(intervals.back().second, 1));
+    for (const auto &interval : intervals)
+    {
+        if (tick <= interval.second)
+        {
+            tmNext = std::min(tmNext, std::max(tick, interval.first));
+        }
+    }
+    return tmNext;
+}
+
+void ECMultiIntervalsTask ::Wait(ECSimTime tick, ECSimTime duration)
 {
     // std::cout << "Wait" << std::endl;
     int totalWait = totalWait;
@@ -55,87 +81,107 @@ void ECMultiIntervalsTask ::Wait(int tick, int duration)
 
 //***********************************************************
 
-ECHardIntervalTask ::ECHardIntervalTask(const std::string &tid, int tmStart, int tmEnd)
+ECHardIntervalTask ::ECHardIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd)
 
     : ECSimTask(tid), tmStart(tmStart), tmEnd(tmEnd)
 {
 }
 
-bool ECHardIntervalTask ::IsReadyToRun(int tick) const
+bool ECHardIntervalTask ::IsReadyToRun(ECSimTime tick) const
 {
     // needs to start at exact value of tmStart
     return (tick == tmStart);
 }
 
-bool ECHardIntervalTask ::IsFinished(int tick) const
+bool ECHardIntervalTask ::IsFinished(ECSimTime tick) const
 {
     // needs to end at exact value of tmEnd or cant be ended
-    return IsHard || tick >= tmEnd;
+    return GetFlag(FLAG_HARD) || tick >= tmEnd;
+}
+
+ECSimTime ECHardIntervalTask ::GetStartTime() const
+{
+    return std::min(tmStart, tmEnd);
 }
 
-void ECHardIntervalTask::Wait(int tick, int duration)
+ECSimTime ECHardIntervalTask ::GetNextEventTime(ECSimTime tick) const
+{
+    if (GetFlag(FLAG_HARD))
+    {
+        return tick;
+    }
+    ECSimTime tmNext = std::max(tick, tmEnd);
+    return tick <= tmStart ? std::min(tmStart, tmNext) : tmNext;
+}
+
+void ECHardIntervalTask::Wait(ECSimTime tick, ECSimTime duration)
 {
     // std::cout << GetId() << "Wait: " << GetTotWaitTime() << std::endl;
     ECSimTask::Wait(tick, duration);
-    IsHard = true;
+    SetFlag(FLAG_HARD, true);
 }
 
 //***********************************************************
 
-ECConsecutiveIntervalTask::ECConsecutiveIntervalTask(const std::string &tid, int tmStart, int tmEnd)
+ECConsecutiveIntervalTask::ECConsecutiveIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd)
 
-    : ECSimTask(tid), tmStart(tmStart), tmEnd(tmEnd), interrupted(false), start(false)
+    : ECSimTask(tid), tmStart(tmStart), tmEnd(tmEnd)
 {
 }
 
 // interrupted is a flag stored in class, start ensures we start and don't get kicked out right away
-bool ECConsecutiveIntervalTask::IsReadyToRun(int tick) const
+bool ECConsecutiveIntervalTask::IsReadyToRun(ECSimTime tick) const
+{
+    return !GetFlag(FLAG_INTERRUPTED) && (tick >= tmStart) && (tick <= tmEnd);
+}
+
+bool ECConsecutiveIntervalTask::IsFinished(ECSimTime tick) const
 {
-    return !interrupted && (tick >= tmStart) && (tick <= tmEnd);
+    return GetFlag(FLAG_INTERRUPTED) || tick > tmEnd;
 }
 
-bool ECConsecutiveIntervalTask::IsFinished(int tick) const
+ECSimTime ECConsecutiveIntervalTask::GetStartTime() const
 {
-    return interrupted || tick > tmEnd;
+    return std::min(tmStart, ECSimTimeAdd(tmEnd, 1));
 }
 
-void ECConsecutiveIntervalTask::Run(int tick, int duration)
+void ECConsecutiveIntervalTask::Run(ECSimTime tick, ECSimTime duration)
 {
-    if (!interrupted)
+    if (!GetFlag(FLAG_INTERRUPTED))
     {
 
         // holy
         ECSimTask::Run(tick, duration);
-        start = !start;
+        SetFlag(FLAG_STARTED, !GetFlag(FLAG_STARTED));
     }
 }
 
-void ECConsecutiveIntervalTask::Wait(int tick, int duration)
+void ECConsecutiveIntervalTask::Wait(ECSimTime tick, ECSimTime duration)
 {
 
-    if (start)
+    if (GetFlag(FLAG_STARTED))
     {
 
-        interrupted = true;
+        SetFlag(FLAG_INTERRUPTED, true);
     }
     ECSimTask::Wait(tick, duration);
 }
 
 //***********************************************************
 
-ECPeriodicTask::ECPeriodicTask(const std::string &tid, int tmStart, int runLen, int sleepLen)
+ECPeriodicTask::ECPeriodicTask(const std::string &tid, ECSimTime tmStart, ECSimTime runLen, ECSimTime sleepLen)
 
     : ECSimTask(tid), tmStart(tmStart), runLen(runLen), sleepLen(sleepLen)
 {
 }
 
-bool ECPeriodicTask::IsFinished(int tick) const
+bool ECPeriodicTask::IsFinished(ECSimTime tick) const
 {
     // tick <= tmStart;
     return false;
 }
 
-void ECPeriodicTask ::Run(int tick, int duration)
+void ECPeriodicTask ::Run(ECSimTime tick, ECSimTime duration)
 {
 
     if (IsReadyToRun(tick))
@@ -144,7 +190,7 @@ void ECPeriodicTask ::Run(int tick, int duration)
     }
 }
 
-bool ECPeriodicTask::IsReadyToRun(int tick) const
+bool ECPeriodicTask::IsReadyToRun(ECSimTime tick) const
 {
     // return tick <= tmStart;
     // funny
@@ -152,3 +198,25 @@ bool ECPeriodicTask::IsReadyToRun(int tick) const
     bool 鸡蛋 = ((tick - tmStart) >= 0);
     return 西瓜 && 鸡蛋;
 }
+
+ECSimTime ECPeriodicTask::GetNextEventTime(ECSimTime tick) const
+{
+    if (tick < tmStart)
+    {
+        return tmStart;
+    }
+    ECSimTime phase = (tick - tmStart) % (runLen + sleepLen);
+    return phase < runLen ? tick : ECSimTimeAdd(tick, runLen + sleepLen - phase);
+}
+
+bool ECPeriodicTask::GetTimingModel(ECSimTimingModel &model) const
+{
+    model = ECSimTimingModel();
+    model.id = GetId();
+    model.offset = ECSimTimeToInt(tmStart);
+    model.wcet = ECSimTimeToInt(runLen);
+    model.period = ECSimTimeToInt(runLen + sleepLen);
+    model.deadline = ECSimTimeToInt(runLen);
+    model.priority = GetPriority();
+    return true;
+}
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <vector>
+#include <algorithm>
 #include "ECSimTask.h"
 
 // Now your need to define the following different kinds of classes...
@@ -21,13 +22,17 @@ class ECMultiIntervalsTask : public ECSimTask
 {
 public:
     ECMultiIntervalsTask(const std::string &tid);
-    void AddInterval(int a, int b);
-    bool IsReadyToRun(int tick) const;
-    bool IsFinished(int tick) const;
-    void Wait(int tick, int duration);
+    void AddInterval(ECSimTime a, ECSimTime b);
+    bool IsReadyToRun(ECSimTime tick) const;
+    bool IsFinished(ECSimTime tick) const;
+    ECSimTime GetStartTime() const;
+    // Start of the interval the tick is in or the next one, or the end of the last
+    ECSimTime GetNextEventTime(ECSimTime tick) const;
+    void Wait(ECSimTime tick, ECSimTime duration);
+    size_t GetMemoryUsage() const { return sizeof(*this) + intervals.capacity() * sizeof(intervals[0]); }
 
 private:
-    std::vector<std::pair<int, int>> intervals;
+    std::vector<std::pair<ECSimTime, ECSimTime>> intervals;
 };
 
 //***********************************************************
@@ -36,16 +41,20 @@ private:
 class ECHardIntervalTask : public ECSimTask
 {
 public:
-    ECHardIntervalTask(const std::string &tid, int tmStart, int tmEnd);
+    ECHardIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd);
 
-    void Wait(int tick, int duration);
-    bool IsReadyToRun(int tick) const;
-    bool IsFinished(int tick) const;
+    void Wait(ECSimTime tick, ECSimTime duration);
+    bool IsReadyToRun(ECSimTime tick) const;
+    bool IsFinished(ECSimTime tick) const;
+    ECSimTime GetStartTime() const;
+    // Ready at the start only, then idle until the end
+    ECSimTime GetNextEventTime(ECSimTime tick) const;
+    size_t GetMemoryUsage() const { return sizeof(*this); }
 
 private:
-    int tmStart;
-    int tmEnd;
-    bool IsHard = false;
+    // FLAG_HARD: it had to wait, so it can't run
+    ECSimTime tmStart;
+    ECSimTime tmEnd;
 };
 
 //***********************************************************
@@ -54,17 +63,19 @@ private:
 class ECConsecutiveIntervalTask : public ECSimTask
 {
 public:
-    ECConsecutiveIntervalTask(const std::string &tid, int tmStart, int tmEnd);
-    void virtual Run(int tick, int duration);
-    void virtual Wait(int tick, int duration);
-    bool IsReadyToRun(int tick) const;
-    bool IsFinished(int tick) const;
+    ECConsecutiveIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd);
+    void virtual Run(ECSimTime tick, ECSimTime duration);
+    void virtual Wait(ECSimTime tick, ECSimTime duration);
+    bool IsReadyToRun(ECSimTime tick) const;
+    bool IsFinished(ECSimTime tick) const;
+    ECSimTime GetStartTime() const;
+    ECSimTime GetNextEventTime(ECSimTime tick) const { return std::max(tick, GetStartTime()); }
+    size_t GetMemoryUsage() const { return sizeof(*this); }
 
 private:
-    int tmStart;
-    int tmEnd;
-    bool interrupted;
-    bool start;
+    // FLAG_INTERRUPTED, FLAG_STARTED as in ECSimConsecutiveTask
+    ECSimTime tmStart;
+    ECSimTime tmEnd;
 };
 
 //***********************************************************
@@ -74,18 +85,24 @@ class ECPeriodicTask : public ECSimTask
 {
 public:
     // tickStart: when to start this periodic task; runLen: how long to run this task each time; sleepLen: after it finishes one run, hong long it will sleep
-    ECPeriodicTask(const std::string &tid, int tmStart, int runLen, int sleepLen);
-    virtual void Run(int tick, int duration);
-
-    bool IsReadyToRun(int tick) const;
-
-    bool IsFinished(int tick) const;
+    ECPeriodicTask(const std::string &tid, ECSimTime tmStart, ECSimTime runLen, ECSimTime sleepLen);
+    virtual void Run(ECSimTime tick, ECSimTime duration);
+
+    bool IsReadyToRun(ECSimTime tick) const;
+
+    bool IsFinished(ECSimTime tick) const;
+    ECSimTime GetStartTime() const { return tmStart; }
+    // Start of the next run, skipping the sleep
+    ECSimTime GetNextEventTime(ECSimTime tick) const;
+    // Released every runLen + sleepLen ticks from tmStart, it needs all runLen ticks
+    bool GetTimingModel(ECSimTimingModel &model) const;
+    size_t GetMemoryUsage() const { return sizeof(*this); }
     // your code here..
 
 private:
-    int runLen;
-    int tmStart;
-    int sleepLen;
+    ECSimTime runLen;
+    ECSimTime tmStart;
+    ECSimTime sleepLen;
 };
 
 #endif /* ECSimTask2_h */
@@ -4,7 +4,10 @@
 //
 
 #include "ECSimTask3.h"
+#include "ECSimTaskScheduler3.h"
+#include "ECSimSchedulability.h"
 #include <iostream>
+#include <algorithm>
 using namespace std;
 
 //***********************************************************
@@ -15,78 +18,107 @@ using namespace std;
 // Interval task: a single interval.
 // YW: you shouldn't need to change this class!
 
-ECSimIntervalTask ::ECSimIntervalTask(const std::string &tidIn, int tmStartIn, int tmEndIn) : tid(tidIn), tmStart(tmStartIn), tmEnd(tmEndIn), tmTotWait(0), tmTotRun(0)
+ECSimIntervalTask ::ECSimIntervalTask(const std::string &tidIn, ECSimTime tmStartIn, ECSimTime tmEndIn) : ECSimTask(tidIn), tmStart(tmStartIn), tmEnd(tmEndIn)
 {
 }
 
 // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-bool ECSimIntervalTask ::IsReadyToRun(int tick) const
+bool ECSimIntervalTask ::IsReadyToRun(ECSimTime tick) const
 {
     return tick >= tmStart && tick <= tmEnd;
 }
 
 // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-bool ECSimIntervalTask ::IsFinished(int tick) const
+bool ECSimIntervalTask ::IsFinished(ECSimTime tick) const
 {
     return tick > tmEnd;
 }
 
+bool ECSimIntervalTask ::GetTimingModel(ECSimTimingModel &model) const
+{
+    model = ECSimTimingModel();
+    model.id = GetId();
+    model.offset = ECSimTimeToInt(tmStart);
+    model.wcet = ECSimTimeToInt(max((ECSimTime)0, ECSimTimeAdd(tmEnd - tmStart, 1)));
+    model.deadline = model.wcet;
+    return true;
+}
+
 //***********************************************************
 // Consecutive task: a task that can early abort
 
-ECSimConsecutiveTask::ECSimConsecutiveTask(ECSimTask *pTask) : pTask(pTask), start(false), interrupted(false)
+ECSimConsecutiveTask::ECSimConsecutiveTask(ECSimSubtaskHandle task) : pTask(std::move(task))
 {
 }
 
-bool ECSimConsecutiveTask ::IsFinished(int tick) const
+bool ECSimConsecutiveTask ::IsFinished(ECSimTime tick) const
 {
     // std::cout << "IsFinished" << std::endl;
-    return pTask->IsFinished(tick) || interrupted;
+    return pTask->IsFinished(tick) || GetFlag(FLAG_INTERRUPTED);
 }
 
-bool ECSimConsecutiveTask::IsReadyToRun(int tick) const
+bool ECSimConsecutiveTask::IsReadyToRun(ECSimTime tick) const
 {
     // std::cout << "IsReady" << std::endl;
-    return pTask->IsReadyToRun(tick) && !interrupted;
+    return pTask->IsReadyToRun(tick) && !GetFlag(FLAG_INTERRUPTED);
 }
 
-void ECSimConsecutiveTask::Wait(int tick, int duration)
+void ECSimConsecutiveTask::Wait(ECSimTime tick, ECSimTime duration)
 {
     // std::cout << "Wait" << std::endl;
     //  use flag?
-    if (start)
+    if (GetFlag(FLAG_STARTED))
     {
         // use is aborted here instead??
-        interrupted = true;
+        SetFlag(FLAG_INTERRUPTED, true);
     }
     // call original wait
     pTask->Wait(tick, duration);
 }
 
-void ECSimConsecutiveTask::Run(int tick, int duration)
+void ECSimConsecutiveTask::Run(ECSimTime tick, ECSimTime duration)
 {
     // std::cout << "Run" << std::endl;
-    if (!interrupted)
+    if (!GetFlag(FLAG_INTERRUPTED))
     {
         // Execute the task for the given duration
-        start = true;
+        SetFlag(FLAG_STARTED, true);
         // call original run
         pTask->Run(tick, duration);
     }
 }
+
+void ECSimConsecutiveTask ::SaveState(std::vector<long long> &state) const
+{
+    state.push_back(GetFlag(FLAG_STARTED));
+    state.push_back(GetFlag(FLAG_INTERRUPTED));
+    pTask->SaveState(state);
+}
+
+void ECSimConsecutiveTask ::RestoreState(const std::vector<long long> &state, size_t &pos)
+{
+    SetFlag(FLAG_STARTED, state[pos++] != 0);
+    SetFlag(FLAG_INTERRUPTED, state[pos++] != 0);
+    pTask->RestoreState(state, pos);
+}
+
+bool ECSimConsecutiveTask ::GetTimingModel(ECSimTimingModel &model) const
+{
+    return pTask->GetTimingModel(model);
+}
 //***********************************************************
 // Periodic task: a task that can early abort
 
-ECSimPeriodicTask::ECSimPeriodicTask(ECSimTask *pTask, int lenSleep) : pTask(pTask), lenSleep(lenSleep), tmStart(-1), tmEnd(-1), runLen(-1)
+ECSimPeriodicTask::ECSimPeriodicTask(ECSimSubtaskHandle task, ECSimTime lenSleep) : pTask(std::move(task)), lenSleep(lenSleep), tmStart(-1), tmEnd(-1)
 {
 }
 
-int ECSimPeriodicTask::calculateRunLength(int tick)
+ECSimTime ECSimPeriodicTask::calculateRunLength(ECSimTime tick)
 {
     return ((tick - tmStart) % (lenSleep + tmEnd - tmStart) + tmStart);
 }
 
-bool ECSimPeriodicTask::IsReadyToRun(int tick) const
+bool ECSimPeriodicTask::IsReadyToRun(ECSimTime tick) const
 {
 
     if (tmStart == -1 && pTask->IsReadyToRun(tick))
@@ -105,21 +137,84 @@ bool ECSimPeriodicTask::IsReadyToRun(int tick) const
     return pTask->IsReadyToRun((tick - tmStart) % (lenSleep + tmEnd - tmStart) + tmStart);
 }
 
-void ECSimPeriodicTask::Wait(int tick, int duration)
+ECSimTime ECSimPeriodicTask::GetNextEventTime(ECSimTime tick) const
+{
+    if (tmEnd < 0 || tmStart < 0 || tick < tmStart)
+    {
+        return tick;
+    }
+    // where the tick falls in the first period; past the wrapped task's window, nothing until the next period
+    ECSimTime period = lenSleep + tmEnd - tmStart;
+    ECSimTime phase = (tick - tmStart) % period;
+    ECSimTime tmNext = pTask->GetNextEventTime(tmStart + phase);
+    if (tmNext < tmEnd)
+    {
+        return ECSimTimeAdd(tick, tmNext - tmStart - phase);
+    }
+    return ECSimTimeAdd(tick, period - phase);
+}
+
+void ECSimPeriodicTask::Wait(ECSimTime tick, ECSimTime duration)
 {
     // call original wait
     // std::cout << "ECSimPeriodicTask::Wait" << std::endl;
     pTask->Wait(tick, duration);
 }
 
-void ECSimPeriodicTask::Run(int tick, int duration)
+void ECSimPeriodicTask::Run(ECSimTime tick, ECSimTime duration)
 {
     // std::cout << "ECSimPeriodicTask::Run" << std::endl;
     pTask->Run(tick, duration);
 }
 
-ECSimStartDeadlineTask ::ECSimStartDeadlineTask(ECSimTask *pTask, int tmStartDeadlineIn) : pTask(pTask), tmStartDeadline(tmStartDeadlineIn)
+void ECSimPeriodicTask ::SaveState(std::vector<long long> &state) const
+{
+    // the first period, found out along the way
+    state.push_back(tmStart);
+    state.push_back(tmEnd);
+    pTask->SaveState(state);
+}
+
+void ECSimPeriodicTask ::RestoreState(const std::vector<long long> &state, size_t &pos)
+{
+    tmStart = state[pos++];
+    tmEnd = state[pos++];
+    pTask->RestoreState(state, pos);
+}
+
+bool ECSimPeriodicTask ::GetTimingModel(ECSimTimingModel &model) const
+{
+    // the first window repeats after lenSleep ticks of sleep
+    if (!pTask->GetTimingModel(model) || model.period != 0)
+    {
+        return false;
+    }
+    model.period = model.deadline + lenSleep;
+    return true;
+}
+
+ECSimStartDeadlineTask ::ECSimStartDeadlineTask(ECSimSubtaskHandle task, ECSimTime tmStartDeadlineIn) : pTask(std::move(task)), tmStartDeadline(tmStartDeadlineIn)
+{
+}
+
+ECSimTime ECSimStartDeadlineTask ::GetNextEventTime(ECSimTime tick) const
+{
+    ECSimTime tmNext = pTask->GetNextEventTime(tick);
+    if (pTask->GetTotRunTime64() == 0)
+    {
+        tmNext = min(tmNext, max(tick, ECSimTimeAdd(tmStartDeadline, 1)));
+    }
+    return tmNext;
+}
+
+void ECSimStartDeadlineTask ::SaveState(std::vector<long long> &state) const
+{
+    pTask->SaveState(state);
+}
+
+void ECSimStartDeadlineTask ::RestoreState(const std::vector<long long> &state, size_t &pos)
 {
+    pTask->RestoreState(state, pos);
 }
 
 // your code here
@@ -127,103 +222,303 @@ ECSimStartDeadlineTask ::ECSimStartDeadlineTask(ECSimTask *pTask, int tmStartDea
 //***********************************************************
 // Task must end by some fixed time click: this is useful e.g. when a task is periodic
 
-ECSimEndDeadlineTask ::ECSimEndDeadlineTask(ECSimTask *pTask, int tmEndDeadlineIn) : pTask(pTask), tmEndDeadline(tmEndDeadlineIn)
+ECSimEndDeadlineTask ::ECSimEndDeadlineTask(ECSimSubtaskHandle task, ECSimTime tmEndDeadlineIn) : pTask(std::move(task)), tmEndDeadline(tmEndDeadlineIn)
 {
 }
 
+ECSimTime ECSimEndDeadlineTask ::GetNextEventTime(ECSimTime tick) const
+{
+    return min(pTask->GetNextEventTime(tick), max(tick, ECSimTimeAdd(tmEndDeadline, 1)));
+}
+
+void ECSimEndDeadlineTask ::SaveState(std::vector<long long> &state) const
+{
+    pTask->SaveState(state);
+}
+
+void ECSimEndDeadlineTask ::RestoreState(const std::vector<long long> &state, size_t &pos)
+{
+    pTask->RestoreState(state, pos);
+}
+
+bool ECSimEndDeadlineTask ::GetTimingModel(ECSimTimingModel &model) const
+{
+    if (!pTask->GetTimingModel(model))
+    {
+        return false;
+    }
+    if (model.period == 0)
+    {
+        model.deadline = max(0, min(model.deadline, ECSimTimeToInt(ECSimTimeAdd(tmEndDeadline - model.offset, 1))));
+        model.wcet = min(model.wcet, model.deadline);
+    }
+    return true;
+}
+
 //***********************************************************
 // Composite task: contain multiple sub-tasks
 
-ECSimCompositeTask ::ECSimCompositeTask(const std::string &tidIn) : tidIn(tidIn), tmTotRun(0), tmTotWait(0)
+ECSimCompositeTask ::ECSimCompositeTask(const std::string &tidIn) : ECSimTask(tidIn), pScheduler(NULL), fDirty(true), tickSync(EC_TIME_MIN), posPending(0), numFinished(0), fAborted(false), tickAborted(EC_TIME_MAX), fReadyValid(false), tickReady(0)
 {
 }
 
-std::string ECSimCompositeTask::GetId() const { return tidIn; }
-void ECSimCompositeTask::AddSubtask(ECSimTask *pt)
+bool ECSimCompositeTask::SetScheduler(const ECSimTaskScheduler *pSchedulerIn)
+{
+    if (pSchedulerIn != NULL && !pSchedulerIn->IsStateless())
+    {
+        return false;
+    }
+    pScheduler = pSchedulerIn;
+    return true;
+}
+
+void ECSimCompositeTask::AddSubtask(ECSimSubtaskHandle task)
 {
-    tasklist.push_back(pt);
+    tasklist.push_back(std::move(task));
+    fDirty = true;
 }
 
-bool ECSimCompositeTask::IsReadyToRun(int tick) const
+void ECSimCompositeTask::Sync(ECSimTime tick) const
 {
-    for (const auto &i : tasklist)
+    if (fDirty)
     {
-        if (i->IsReadyToRun(tick))
+        // start over: all subtasks pending, ordered by start time
+        listPending.clear();
+        for (int i = 0; i < (int)tasklist.size(); ++i)
         {
-            return true;
+            listPending.push_back(i);
         }
+        std::stable_sort(listPending.begin(), listPending.end(), [this](int x, int y)
+                         { return tasklist[x]->GetStartTime() < tasklist[y]->GetStartTime(); });
+        posPending = 0;
+        listActive.clear();
+        numFinished = 0;
+        fAborted = false;
+        tickAborted = EC_TIME_MAX;
+        fReadyValid = false;
+        fDirty = false;
+    }
+    tickSync = tick;
+    // subtasks that have started join the active set, which stays in the order they were added
+    size_t numOld = listActive.size();
+    while (posPending < listPending.size() && tasklist[listPending[posPending]]->GetStartTime() <= tick)
+    {
+        listActive.push_back(listPending[posPending++]);
+    }
+    if (listActive.size() > numOld)
+    {
+        std::sort(listActive.begin() + numOld, listActive.end());
+        std::inplace_merge(listActive.begin(), listActive.begin() + numOld, listActive.end());
+        fReadyValid = false;
     }
-    return false;
 }
 
-bool ECSimCompositeTask::IsFinished(int tick) const
+void ECSimCompositeTask::RetireFinished(ECSimTime tick) const
 {
-    for (const auto &i : tasklist)
+    // finished subtasks leave the active set for good; ones that haven't started can't be finished
+    auto it = std::remove_if(listActive.begin(), listActive.end(), [this, tick](int i)
+                             { return tasklist[i]->IsFinished(tick); });
+    if (it != listActive.end())
     {
-        if (!i->IsFinished(tick))
+        numFinished += (int)(listActive.end() - it);
+        listActive.erase(it, listActive.end());
+        fReadyValid = false;
+    }
+}
+
+const std::vector<ECSimTask *> &ECSimCompositeTask::GetReadySubtasks(ECSimTime tick) const
+{
+    if (fReadyValid && tickReady == tick && !fDirty)
+    {
+        return listReady;
+    }
+    listReady.clear();
+    if (!fDirty && tick < tickSync)
+    {
+        for (const auto &i : tasklist)
         {
-            return false;
+            if (!i->IsFinished(tick) && i->IsReadyToRun(tick))
+            {
+                listReady.push_back(i.Get());
+            }
         }
     }
-    return true;
+    else
+    {
+        Sync(tick);
+        RetireFinished(tick);
+        for (int i : listActive)
+        {
+            if (tasklist[i]->IsReadyToRun(tick))
+            {
+                listReady.push_back(tasklist[i].Get());
+            }
+        }
+    }
+    fReadyValid = true;
+    tickReady = tick;
+    return listReady;
+}
+
+bool ECSimCompositeTask::IsReadyToRun(ECSimTime tick) const
+{
+    return !GetReadySubtasks(tick).empty();
+}
+
+bool ECSimCompositeTask::IsFinished(ECSimTime tick) const
+{
+    if (!fDirty && tick < tickSync)
+    {
+        for (const auto &i : tasklist)
+        {
+            if (!i->IsFinished(tick))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    Sync(tick);
+    RetireFinished(tick);
+    return numFinished == (int)tasklist.size();
 }
 
 // Is task early abort? There can be various reasons for abort: e.g., missed deadline
 
 // Run the task for some duration (usually 1, but can be more) starting from time tick
-void ECSimCompositeTask::Run(int tick, int duration)
+void ECSimCompositeTask::Run(ECSimTime tick, ECSimTime duration)
+{
+    ECSimTask::Run(tick, duration);
+    const std::vector<ECSimTask *> &listReadyNow = GetReadySubtasks(tick);
+    if (listReadyNow.empty())
+    {
+        return;
+    }
+    fReadyValid = false;
+    if (pScheduler == NULL)
+    {
+        listReadyNow[0]->Run(tick, duration);
+        return;
+    }
+    // inner scheduling: one subtask runs, the other ready ones wait
+    ECSimTask *pNext = pScheduler->ChooseTask(listReadyNow);
+    if (pNext != NULL)
+    {
+        pNext->Run(tick, duration);
+    }
+    for (auto &i : listReadyNow)
+    {
+        if (i != pNext)
+        {
+            i->Wait(tick, duration);
+        }
+    }
+}
+
+void ECSimCompositeTask::Wait(ECSimTime tick, ECSimTime duration)
 {
-    tmTotRun += duration;
+    ECSimTask::Wait(tick, duration);
+    const std::vector<ECSimTask *> &listReadyNow = GetReadySubtasks(tick);
+    fReadyValid = false;
+    for (auto &i : listReadyNow)
+    {
+        i->Wait(tick, duration);
+    }
+}
+
+bool ECSimCompositeTask::IsAborted(ECSimTime tick) const
+{
+    if (fAborted && tick >= tickAborted && !fDirty)
+    {
+        return true;
+    }
+    if (!fDirty && tick < tickSync)
+    {
+        for (auto &i : tasklist)
+        {
+            if (i->IsAborted(tick))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    // only started subtasks can abort
+    Sync(tick);
+    for (int i : listActive)
+    {
+        if (tasklist[i]->IsAborted(tick))
+        {
+            fAborted = true;
+            tickAborted = tick;
+            return true;
+        }
+    }
+    return false;
+}
+
+ECSimTime ECSimCompositeTask::GetStartTime() const
+{
+    // no subtask: finished right away
+    if (tasklist.empty())
+    {
+        return EC_TIME_MIN;
+    }
+    ECSimTime tmStart = EC_TIME_MAX;
     for (auto &i : tasklist)
     {
-        if (i->IsReadyToRun(tick))
+        if (i->GetStartTime() < tmStart)
         {
-            i->Run(tick, duration);
-            return;
+            tmStart = i->GetStartTime();
         }
     }
+    return tmStart;
 }
 
-void ECSimCompositeTask::Wait(int tick, int duration)
+ECSimTime ECSimCompositeTask::GetNextEventTime(ECSimTime tick) const
 {
-    tmTotWait += duration;
+    ECSimTime tmNext = EC_TIME_MAX;
     for (auto &i : tasklist)
     {
-        if (i->IsReadyToRun(tick))
+        if (!i->IsFinished(tick))
         {
-            i->Wait(tick, duration);
+            tmNext = min(tmNext, i->GetNextEventTime(tick));
         }
     }
+    // all finished: so is the composite
+    return tmNext == EC_TIME_MAX ? tick : tmNext;
 }
 
-// How much total time does the task has to wait to get its turn so far?
-// int ECSimCompositeTask::GetTotWaitTime() const
-// {
-//     for (auto &i : tasklist)
-//     {
-//         i->GetTotWaitTime();
-//     }
-// }
+void ECSimCompositeTask ::SaveState(std::vector<long long> &state) const
+{
+    ECSimTask::SaveState(state);
+    for (auto &i : tasklist)
+    {
+        i->SaveState(state);
+    }
+}
 
-// // Get total run-time (so far)
-// int ECSimCompositeTask::GetTotRunTime() const
-// {
-//     for (auto &i : tasklist)
-//     {
-//         i->GetTotRunTime();
-//     }
-// }
+void ECSimCompositeTask ::RestoreState(const std::vector<long long> &state, size_t &pos)
+{
+    ECSimTask::RestoreState(state, pos);
+    for (auto &i : tasklist)
+    {
+        i->RestoreState(state, pos);
+    }
+    // the incremental bookkeeping is rebuilt from the restored subtasks
+    fDirty = true;
+    fReadyValid = false;
+}
 
-bool ECSimCompositeTask::IsAborted(int tick) const
+size_t ECSimCompositeTask::GetMemoryUsage() const
 {
+    size_t numBytes = sizeof(*this) + tasklist.capacity() * sizeof(ECSimSubtaskHandle);
     for (auto &i : tasklist)
     {
-        if (i->IsAborted(tick))
-        {
-            return true;
-        }
+        numBytes += i.GetMemoryUsage();
     }
-    return false;
+    numBytes += (listPending.capacity() + listActive.capacity()) * sizeof(int) + listReady.capacity() * sizeof(ECSimTask *);
+    return numBytes;
 }
 
 // your code here
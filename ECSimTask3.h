@@ -10,46 +10,25 @@
 //  (iv) deadline to finish (must end by some time)
 //  (v) periodic: this task runs restarts after it finishes its current iteration
 //  (vi) can contain sub-tasks: if any subtask aborts, this task is finished; otherwise it finishes when all subtasks finishes.
+//  Decorators and composites take the tasks they wrap as handles (see ECSimTaskHandle.h): pass a pointer to
+//  wrap a task owned elsewhere, or the task itself to have it kept inside, e.g.
+//  ECSimConsecutiveTask(ECSimIntervalTask("a", 1, 5)).
 
 #ifndef ECSimTask3_h
 #define ECSimTask3_h
 
 #include <vector>
 #include <string>
+#include <climits>
+#include "ECSimTaskBase.h"
+#include "ECSimTaskHandle.h"
 
-//***********************************************************
-// Generic simulation task
-//***********************************************************
-
-class ECSimTask
+namespace ecsim
 {
-public:
-  virtual ~ECSimTask() {}
-
-  // Get the task id
-  virtual std::string GetId() const = 0;
-
-  // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const = 0;
-
-  // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const = 0;
-
-  // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const = 0;
-
-  // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration) = 0;
-
-  // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration) = 0;
-
-  // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const = 0;
-
-  // Get total run-time (so far)
-  virtual int GetTotRunTime() const = 0;
-};
+class ECSimTaskScheduler;
+}
+using ecsim::ECSimTask;
+using ecsim::ECSimTaskScheduler;
 
 //***********************************************************
 // Basic task: you shouldn't need to change this class!
@@ -61,38 +40,29 @@ public:
 class ECSimIntervalTask : public ECSimTask
 {
 public:
-  ECSimIntervalTask(const std::string &tid, int tmStart, int tmEnd);
-
-  // Get the task id
-  virtual std::string GetId() const { return this->tid; }
+  ECSimIntervalTask(const std::string &tid, ECSimTime tmStart, ECSimTime tmEnd);
 
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const;
+  virtual bool IsReadyToRun(ECSimTime tick) const;
 
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const;
+  virtual bool IsFinished(ECSimTime tick) const;
 
-  // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const { return false; }
-
-  // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration) { tmTotRun += duration; }
+  // Earliest tick at which the task may be ready to run or finished
+  virtual ECSimTime GetStartTime() const { return tmStart <= tmEnd ? tmStart : ECSimTimeAdd(tmEnd, 1); }
 
-  // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration) { tmTotWait += duration; }
+  // Every tick from the start on is ready or finished
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const { return tick > GetStartTime() ? tick : GetStartTime(); }
 
-  // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return tmTotWait; }
+  // Released once at tmStart, it needs the whole interval
+  virtual bool GetTimingModel(ECSimTimingModel &model) const;
 
-  // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return tmTotRun; }
+  // 48 bytes: the id, counters and priority are in ECSimTask
+  virtual size_t GetMemoryUsage() const { return sizeof(*this); }
 
 private:
-  std::string tid;
-  int tmStart;
-  int tmEnd;
-  int tmTotWait;
-  int tmTotRun;
+  ECSimTime tmStart;
+  ECSimTime tmEnd;
 };
 
 //***********************************************************
@@ -102,35 +72,49 @@ private:
 class ECSimConsecutiveTask : public ECSimTask
 {
 public:
-  ECSimConsecutiveTask(ECSimTask *pTask);
+  ECSimConsecutiveTask(ECSimSubtaskHandle task);
 
   virtual std::string GetId() const { return pTask->GetId(); }
 
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const;
+  virtual bool IsReadyToRun(ECSimTime tick) const;
 
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const;
+  virtual bool IsFinished(ECSimTime tick) const;
 
   // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const { return pTask->IsAborted(tick); }
+  virtual bool IsAborted(ECSimTime tick) const { return pTask->IsAborted(tick); }
+
+  // Earliest tick at which the task may be ready to run or finished
+  virtual ECSimTime GetStartTime() const { return pTask->GetStartTime(); }
+
+  // Those of the task it wraps, until interrupted (finished then)
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const { return GetFlag(FLAG_INTERRUPTED) ? tick : pTask->GetNextEventTime(tick); }
 
   // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration);
+  virtual void Run(ECSimTime tick, ECSimTime duration);
 
   // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration);
+  virtual void Wait(ECSimTime tick, ECSimTime duration);
 
   // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return pTask->GetTotWaitTime(); }
+  virtual ECSimTime GetTotWaitTime64() const { return pTask->GetTotWaitTime64(); }
 
   // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return pTask->GetTotRunTime(); }
+  virtual ECSimTime GetTotRunTime64() const { return pTask->GetTotRunTime64(); }
+
+  // Save / restore the changing state
+  virtual void SaveState(std::vector<long long> &state) const;
+  virtual void RestoreState(const std::vector<long long> &state, size_t &pos);
+
+  // Same as the task it wraps
+  virtual bool GetTimingModel(ECSimTimingModel &model) const;
+
+  virtual size_t GetMemoryUsage() const { return sizeof(*this) + pTask.GetMemoryUsage(); }
 
 private:
-  ECSimTask *pTask;
-  bool start;
-  bool interrupted;
+  // FLAG_STARTED: it has run; FLAG_INTERRUPTED: it had to wait after that, so it's done
+  ECSimSubtaskHandle pTask;
 };
 
 //***********************************************************
@@ -140,41 +124,55 @@ private:
 class ECSimPeriodicTask : public ECSimTask
 {
 public:
-  ECSimPeriodicTask(ECSimTask *pTask, int lenSleep);
+  ECSimPeriodicTask(ECSimSubtaskHandle task, ECSimTime lenSleep);
 
   // your code here
   virtual std::string GetId() const { return pTask->GetId(); }
 
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const;
+  virtual bool IsReadyToRun(ECSimTime tick) const;
 
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const { return false; };
+  virtual bool IsFinished(ECSimTime /*tick*/) const { return false; };
 
   // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const { return pTask->IsAborted(tick); }
+  virtual bool IsAborted(ECSimTime tick) const { return pTask->IsAborted(tick); }
+
+  // Earliest tick at which the task may be ready to run: its first period starts with the original task
+  virtual ECSimTime GetStartTime() const { return pTask->GetStartTime(); }
+
+  // Once the first period is known: the wrapped task's next event within the period, or the start of the next
+  // period. During the first one, every tick (the period is found out by looking at them)
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const;
 
   // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration);
+  virtual void Run(ECSimTime tick, ECSimTime duration);
 
   // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration);
+  virtual void Wait(ECSimTime tick, ECSimTime duration);
 
   // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return pTask->GetTotWaitTime(); }
+  virtual ECSimTime GetTotWaitTime64() const { return pTask->GetTotWaitTime64(); }
 
   // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return pTask->GetTotRunTime(); }
+  virtual ECSimTime GetTotRunTime64() const { return pTask->GetTotRunTime64(); }
 
-  virtual int calculateRunLength(int tick);
+  virtual ECSimTime calculateRunLength(ECSimTime tick);
+
+  // Save / restore the changing state
+  virtual void SaveState(std::vector<long long> &state) const;
+  virtual void RestoreState(const std::vector<long long> &state, size_t &pos);
+
+  // The wrapped task's window, released again every window + lenSleep ticks
+  virtual bool GetTimingModel(ECSimTimingModel &model) const;
+
+  virtual size_t GetMemoryUsage() const { return sizeof(*this) + pTask.GetMemoryUsage(); }
 
 private:
-  ECSimTask *pTask;
-  int lenSleep;
-  int runLen;
-  int mutable tmStart;
-  int mutable tmEnd;
-  bool isAborted;
+  ECSimSubtaskHandle pTask;
+  ECSimTime lenSleep;
+  ECSimTime mutable tmStart;
+  ECSimTime mutable tmEnd;
 };
 
 //***********************************************************
@@ -184,25 +182,31 @@ private:
 class ECSimStartDeadlineTask : public ECSimTask
 {
 public:
-  ECSimStartDeadlineTask(ECSimTask *pTask, int tmStartDeadline);
+  ECSimStartDeadlineTask(ECSimSubtaskHandle task, ECSimTime tmStartDeadline);
 
   // your code here
   virtual std::string GetId() const { return pTask->GetId(); }
 
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const { return pTask->IsReadyToRun(tick); }
+  virtual bool IsReadyToRun(ECSimTime tick) const { return pTask->IsReadyToRun(tick); }
 
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const { return pTask->IsFinished(tick) || (tick > tmStartDeadline && pTask->GetTotRunTime() == 0); }
+  virtual bool IsFinished(ECSimTime tick) const { return pTask->IsFinished(tick) || (tick > tmStartDeadline && pTask->GetTotRunTime64() == 0); }
 
   // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const { return pTask->IsAborted(tick); }
+  virtual bool IsAborted(ECSimTime tick) const { return pTask->IsAborted(tick); }
+
+  // Earliest tick at which the task may be ready to run or finished (by missing the start deadline)
+  virtual ECSimTime GetStartTime() const { return tmStartDeadline < pTask->GetStartTime() ? ECSimTimeAdd(tmStartDeadline, 1) : pTask->GetStartTime(); }
+
+  // Those of the task it wraps, and missing the start deadline
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const;
 
   // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration) { return pTask->Run(tick, duration); }
+  virtual void Run(ECSimTime tick, ECSimTime duration) { return pTask->Run(tick, duration); }
 
   // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration)
+  virtual void Wait(ECSimTime tick, ECSimTime duration)
   {
     // if (tick == tmStartDeadline)
     //   start = true;
@@ -210,15 +214,20 @@ public:
   }
 
   // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return pTask->GetTotWaitTime(); }
+  virtual ECSimTime GetTotWaitTime64() const { return pTask->GetTotWaitTime64(); }
 
   // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return pTask->GetTotRunTime(); }
+  virtual ECSimTime GetTotRunTime64() const { return pTask->GetTotRunTime64(); }
+
+  // Save / restore the changing state
+  virtual void SaveState(std::vector<long long> &state) const;
+  virtual void RestoreState(const std::vector<long long> &state, size_t &pos);
+
+  virtual size_t GetMemoryUsage() const { return sizeof(*this) + pTask.GetMemoryUsage(); }
 
 private:
-  ECSimTask *pTask;
-  int tmStartDeadline;
-  bool start = false;
+  ECSimSubtaskHandle pTask;
+  ECSimTime tmStartDeadline;
 };
 
 //***********************************************************
@@ -228,72 +237,122 @@ private:
 class ECSimEndDeadlineTask : public ECSimTask
 {
 public:
-  ECSimEndDeadlineTask(ECSimTask *pTask, int tmEndDeadline);
+  ECSimEndDeadlineTask(ECSimSubtaskHandle task, ECSimTime tmEndDeadline);
 
   // your code here
   virtual std::string GetId() const { return pTask->GetId(); }
 
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const { return (pTask->IsReadyToRun(tick) && (tmEndDeadline >= tick)); }
+  virtual bool IsReadyToRun(ECSimTime tick) const { return (pTask->IsReadyToRun(tick) && (tmEndDeadline >= tick)); }
 
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const { return (tick > tmEndDeadline || pTask->IsFinished(tick)); }
+  virtual bool IsFinished(ECSimTime tick) const { return (tick > tmEndDeadline || pTask->IsFinished(tick)); }
 
   // Is task early abort? There can be various reasons for abort: e.g., missed deadline
-  virtual bool IsAborted(int tick) const { return pTask->IsAborted(tick); }
+  virtual bool IsAborted(ECSimTime tick) const { return pTask->IsAborted(tick); }
+
+  // Earliest tick at which the task may be ready to run or finished (by passing the end deadline)
+  virtual ECSimTime GetStartTime() const { return tmEndDeadline < pTask->GetStartTime() ? ECSimTimeAdd(tmEndDeadline, 1) : pTask->GetStartTime(); }
+
+  // Those of the task it wraps, and passing the end deadline
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const;
 
   // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration) { return pTask->Run(tick, duration); }
+  virtual void Run(ECSimTime tick, ECSimTime duration) { return pTask->Run(tick, duration); }
 
   // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration) { return pTask->Wait(tick, duration); }
+  virtual void Wait(ECSimTime tick, ECSimTime duration) { return pTask->Wait(tick, duration); }
 
   // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return pTask->GetTotWaitTime(); }
+  virtual ECSimTime GetTotWaitTime64() const { return pTask->GetTotWaitTime64(); }
 
   // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return pTask->GetTotRunTime(); }
+  virtual ECSimTime GetTotRunTime64() const { return pTask->GetTotRunTime64(); }
+
+  // Save / restore the changing state
+  virtual void SaveState(std::vector<long long> &state) const;
+  virtual void RestoreState(const std::vector<long long> &state, size_t &pos);
+
+  // The wrapped task's model; a one-shot window is cut at the deadline (periodic ones are kept whole, overstating the demand)
+  virtual bool GetTimingModel(ECSimTimingModel &model) const;
+
+  virtual size_t GetMemoryUsage() const { return sizeof(*this) + pTask.GetMemoryUsage(); }
 
 private:
-  ECSimTask *pTask;
-  int tmEndDeadline;
+  ECSimSubtaskHandle pTask;
+  ECSimTime tmEndDeadline;
 };
 
 //***********************************************************
 // Composite task: contain multiple sub-tasks
+// Subtasks are tracked incrementally as the clock moves forward: a subtask joins the active set
+// at its start time and leaves it for good once finished, so each tick only looks at the active ones
+// By default the first ready subtask gets the time; a scheduler can be set to pick among the ready subtasks instead
 
 class ECSimCompositeTask : public ECSimTask
 {
 public:
   ECSimCompositeTask(const std::string &tidIn);
 
-  virtual std::string GetId() const;
-
   // Add subtask
-  void AddSubtask(ECSimTask *pt);
+  void AddSubtask(ECSimSubtaskHandle task);
+
+  // Schedule the subtasks with the policy of this scheduler (only its ChooseTask is used; the composite is driven by the outer clock).
+  // The ready subtasks that are not picked then wait, as they would at the top level. NULL: first ready subtask, others don't wait.
+  // The policy must be stateless (IsStateless: FIFO, LWTF, round robin, priority): the scheduler never steps, so one that follows
+  // the loaded task (minimum quantum, hysteresis) would act as its base policy, and one that keeps state for each task (CFS, MLFQ)
+  // would never hear that a subtask finished. Return false for the others, and keep the scheduler set before
+  bool SetScheduler(const ECSimTaskScheduler *pSchedulerIn);
 
   // your code ehre
   // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
-  virtual bool IsReadyToRun(int tick) const;
+  virtual bool IsReadyToRun(ECSimTime tick) const;
   // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
-  virtual bool IsFinished(int tick) const;
+  virtual bool IsFinished(ECSimTime tick) const;
   // Is task early abort? There can be various reasons for abort: e.g., missed deadline
   // Run the task for some duration (usually 1, but can be more) starting from time tick
-  virtual void Run(int tick, int duration);
+  virtual void Run(ECSimTime tick, ECSimTime duration);
   // Wait for some duration (usually 1, but can be more), starting from time tick
-  virtual void Wait(int tick, int duration);
-  // How much total time does the task has to wait to get its turn so far?
-  virtual int GetTotWaitTime() const { return tmTotWait; }
-  // Get total run-time (so far)
-  virtual int GetTotRunTime() const { return tmTotRun; }
+  virtual void Wait(ECSimTime tick, ECSimTime duration);
+
+  virtual bool IsAborted(ECSimTime tick) const;
+
+  // Earliest tick at which any subtask may be ready to run or finished
+  virtual ECSimTime GetStartTime() const;
+
+  // Earliest next event of the subtasks that are not finished
+  virtual ECSimTime GetNextEventTime(ECSimTime tick) const;
+
+  // Save / restore the changing state
+  virtual void SaveState(std::vector<long long> &state) const;
+  virtual void RestoreState(const std::vector<long long> &state, size_t &pos);
 
-  virtual bool IsAborted(int tick) const;
+  // With the subtasks it keeps by value
+  virtual size_t GetMemoryUsage() const;
 
 private:
-  int tmTotWait;
-  int tmTotRun;
-  std::vector<ECSimTask *> tasklist;
-  std::string tidIn;
+  // bring the incremental state forward to tick (tick must not be earlier than tickSync)
+  void Sync(ECSimTime tick) const;
+  // drop the active subtasks that are finished at tick
+  void RetireFinished(ECSimTime tick) const;
+  // unfinished subtasks ready to run at tick, in the order they were added (cached until the next Run/Wait)
+  const std::vector<ECSimTask *> &GetReadySubtasks(ECSimTime tick) const;
+
+  std::vector<ECSimSubtaskHandle> tasklist;
+  const ECSimTaskScheduler *pScheduler;
+
+  // incremental state; queries for ticks before tickSync (e.g. from a periodic wrapper) walk all subtasks instead
+  mutable bool fDirty;
+  mutable ECSimTime tickSync;
+  mutable std::vector<int> listPending;
+  mutable size_t posPending;
+  mutable std::vector<int> listActive;
+  mutable int numFinished;
+  mutable bool fAborted;
+  mutable ECSimTime tickAborted;
+  mutable bool fReadyValid;
+  mutable ECSimTime tickReady;
+  mutable std::vector<ECSimTask *> listReady;
 };
 
 #endif /* ECSimTask3_h */
\ No newline at end of file
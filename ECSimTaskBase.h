@@ -0,0 +1,131 @@
+//
+//  ECSimTaskBase.h
+//
+//
+//  The one task interface of all task kinds: the interval / periodic tasks of
+//  ECSimTask.h and ECSimTask2.h, and the decorators and composites of
+//  ECSimTask3.h. Every scheduler policy works on it, so any task kind can be
+//  scheduled by any policy, and all of them link into one binary. The task
+//  headers bring the name into the global namespace.
+//
+
+#ifndef ECSimTaskBase_h
+#define ECSimTaskBase_h
+
+#include <string>
+#include <vector>
+#include <climits>
+#include <cstdint>
+#include "ECSimTaskIds.h"
+#include "ECSimTime.h"
+
+struct ECSimTimingModel;
+
+namespace ecsim
+{
+
+//***********************************************************
+// Generic simulation task
+
+class ECSimTask
+{
+public:
+    // Tasks that keep their own id and counters (the ECSimTask3 kinds) need no name here
+    ECSimTask() : idTask(0), pri(0), flags(0), tmTotWait(0), tmTotRun(0) {}
+
+    // Each task has a name (kept in ECSimTaskIds)
+    ECSimTask(const std::string &tidIn) : idTask(ECSimTaskIds::Add(tidIn)), pri(0), flags(0), tmTotWait(0), tmTotRun(0) {}
+    virtual ~ECSimTask() {}
+
+    // Tasks can be moved (e.g. into a task handle, see ECSimTaskHandle.h) and copied
+    ECSimTask(const ECSimTask &) = default;
+    ECSimTask(ECSimTask &&) = default;
+    ECSimTask &operator=(const ECSimTask &) = default;
+    ECSimTask &operator=(ECSimTask &&) = default;
+
+    // Get the task id
+    virtual std::string GetId() const { return ECSimTaskIds::Get(idTask); }
+
+    // Is task ready to run at certain time? tick: the current clock time (in simulation unit)
+    virtual bool IsReadyToRun(ECSimTime tick) const = 0;
+
+    // Is task complete at certain time? If so, scheduler may remove it from the list. tick the current clock time (in simulation unit)
+    virtual bool IsFinished(ECSimTime tick) const = 0;
+
+    // Is task early abort? There can be various reasons for abort: e.g., missed deadline. Plain tasks never abort
+    virtual bool IsAborted(ECSimTime /*tick*/) const { return false; }
+
+    // Earliest tick at which the task may be ready to run, finished or aborted; until then the scheduler can leave it alone. EC_TIME_MIN if unknown
+    virtual ECSimTime GetStartTime() const { return EC_TIME_MIN; }
+
+    // Earliest tick from tick on at which the task may be ready to run, finished or aborted: the ticks before it are
+    // idle for this task, and an event-driven scheduler may skip them. tick if unknown
+    virtual ECSimTime GetNextEventTime(ECSimTime tick) const { return tick; }
+
+    // Run the task for some duration (usually 1, but can be more) starting from time tick
+    virtual void Run(ECSimTime /*tick*/, ECSimTime duration) { tmTotRun = ECSimTimeAdd(tmTotRun, duration); }
+
+    // Wait for some duration (usually 1, but can be more), starting from time tick
+    virtual void Wait(ECSimTime /*tick*/, ECSimTime duration) { tmTotWait = ECSimTimeAdd(tmTotWait, duration); }
+
+    // How much total time does the task has to wait to get its turn so far?
+    virtual ECSimTime GetTotWaitTime64() const { return tmTotWait; }
+
+    // Get total run-time (so far)
+    virtual ECSimTime GetTotRunTime64() const { return tmTotRun; }
+
+    // The same for the int API, clamped to INT_MAX
+    int GetTotWaitTime() const { return ECSimTimeToInt(GetTotWaitTime64()); }
+    int GetTotRunTime() const { return ECSimTimeToInt(GetTotRunTime64()); }
+
+    // priority: by default, each task has the same priority 0 (the smaller the higher priority, as in Unix/Linux); -32768 to 32767,
+    // values out of that range are clamped to it (ClampPriority)
+    void SetPriority(int p) { pri = (int16_t)ClampPriority(p); }
+    int GetPriority() const { return pri; }
+    static int ClampPriority(int p) { return p < INT16_MIN ? INT16_MIN : (p > INT16_MAX ? INT16_MAX : p); }
+
+    // Append the task's changing state (counters and flags, wrapped tasks included) to state, so the task can be
+    // rolled back to this point with RestoreState (which reads it back from state[pos] on, advancing pos).
+    // By default the counters above and the flags; tasks with more state override these
+    virtual void SaveState(std::vector<long long> &state) const
+    {
+        state.push_back(tmTotWait);
+        state.push_back(tmTotRun);
+        state.push_back(flags);
+    }
+    virtual void RestoreState(const std::vector<long long> &state, size_t &pos)
+    {
+        tmTotWait = state[pos++];
+        tmTotRun = state[pos++];
+        flags = (uint16_t)state[pos++];
+    }
+
+    // Timing model for schedulability analysis (see ECSimSchedulability.h); false if the task has none
+    virtual bool GetTimingModel(ECSimTimingModel &/*model*/) const { return false; }
+
+    // Bytes the task takes: the object and what it owns (lists, wrapped tasks kept by value); task kinds override it
+    virtual size_t GetMemoryUsage() const { return sizeof(ECSimTask); }
+
+protected:
+    // State bits kept here, so task kinds need no bools of their own
+    enum
+    {
+        FLAG_STARTED = 1,
+        FLAG_INTERRUPTED = 2,
+        FLAG_HARD = 4
+    };
+    bool GetFlag(unsigned flag) const { return (flags & flag) != 0; }
+    void SetFlag(unsigned flag, bool f) { flags = f ? (uint16_t)(flags | flag) : (uint16_t)(flags & ~flag); }
+
+private:
+    // 32 bytes with the vtable pointer
+    uint32_t idTask;
+    int16_t pri;
+    uint16_t flags;
+    ECSimTime tmTotWait;
+    ECSimTime tmTotRun;
+};
+
+} // namespace ecsim
+
+#endif /* ECSimTaskBase_h */
@@ -0,0 +1,82 @@
+// Benchmark: timing-wheel activation vs. the per-tick scan of all tasks
+// Build: cmake -S . -B build && cmake --build build --target ecsim_bench3 (see CMakeLists.txt)
+// Usage: bench [numTasks] [numTicks] [numScanTicks]
+
+#include "ECSimTask3.h"
+#include "ECSimTaskScheduler3.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+// Interval tasks with random start in [1, numTicks] and length in [1, 100]
+#ifdef ECSIM_PERF_COUNTERS
+// phase counters of all the runs, printed once at the end
+static ECSimPerfCounters perfTotal;
+#endif
+
+static void MakeTasks(int numTasks, int numTicks, vector<ECSimIntervalTask *> &listTasks)
+{
+    unsigned long long seed = 12345;
+    for (int i = 0; i < numTasks; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int tmStart = 1 + (int)((seed >> 33) % (unsigned long long)numTicks);
+        int len = 1 + (int)((seed >> 17) % 100);
+        listTasks.push_back(new ECSimIntervalTask("t" + to_string(i), tmStart, tmStart + len - 1));
+    }
+}
+
+static double RunOnce(int numTasks, int numTicks, int duration, bool fWheel, int &numSteps, long long &tmTotRun, ECSimMemoryReport &report)
+{
+    vector<ECSimIntervalTask *> listTasks;
+    MakeTasks(numTasks, numTicks, listTasks);
+    ECSimFIFOTaskScheduler scheduler;
+    scheduler.SetTimingWheel(fWheel);
+    for (auto x : listTasks)
+    {
+        scheduler.AddTask(x);
+    }
+    report = scheduler.MemoryReport();
+    auto tmBegin = chrono::steady_clock::now();
+    numSteps = scheduler.Simulate(duration);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - tmBegin).count();
+#ifdef ECSIM_PERF_COUNTERS
+    perfTotal.Add(scheduler.GetPerfCounters());
+#endif
+    tmTotRun = 0;
+    for (auto x : listTasks)
+    {
+        tmTotRun += x->GetTotRunTime();
+        delete x;
+    }
+    return secs;
+}
+
+int main(int argc, char **argv)
+{
+    int numTasks = argc > 1 ? atoi(argv[1]) : 1000000;
+    int numTicks = argc > 2 ? atoi(argv[2]) : 1000000000;
+    int numScanTicks = argc > 3 ? atoi(argv[3]) : 100;
+
+    int numSteps = 0;
+    long long tmTotRun = 0;
+    ECSimMemoryReport report;
+    double secsWheel = RunOnce(numTasks, numTicks, -1, true, numSteps, tmTotRun, report);
+    int numStepsScan = 0;
+    long long tmTotRunScan = 0;
+    ECSimMemoryReport reportScan;
+    double secsScan = RunOnce(numTasks, numTicks, numScanTicks, false, numStepsScan, tmTotRunScan, reportScan);
+
+    cout << "tasks: " << numTasks << ", ticks: " << numSteps << ", total run: " << tmTotRun << endl;
+    cout << "timing wheel: " << secsWheel << " s" << endl;
+    cout << "scan: " << secsScan << " s for " << numStepsScan << " ticks, about " << secsScan / numStepsScan * numSteps << " s for the whole run" << endl;
+    cout << "memory at the start (timing wheel):" << endl;
+    report.Print(cout);
+#ifdef ECSIM_PERF_COUNTERS
+    perfTotal.PrintSummary(cerr);
+#endif
+    return 0;
+}
@@ -0,0 +1,160 @@
+// Differential check: the timing-wheel engine against the reference Simulate loop, on generated workloads
+// of ECSimTask/ECSimTask2 tasks (--gen 2, the default) or ECSimTask3 tasks (--gen 3)
+// Build: cmake -S . -B build && cmake --build build --target ecsim_diff (see CMakeLists.txt)
+// Usage: diff [--gen 2|3] [numScenarios] [seed]      or      diff [--gen 2|3] --replay FILE
+// On a mismatch the shrunk reproducer is printed and saved to repro.scenario (repro3.scenario for --gen 3)
+
+#include "ECSimTask.h"
+#include "ECSimTask2.h"
+#include "ECSimTaskScheduler.h"
+#include "ECSimTaskScheduler2.h"
+#include "ECSimWorkload.h"
+#include "ECSimWorkloadTasks.h"
+#include "ECSimDifferential.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+static const char *policyNames[] = {"fifo", "lwtf", "rr", "priority", "cfs", "mlfq"};
+static const int NUM_POLICIES = 6;
+
+#ifdef ECSIM_PERF_COUNTERS
+// phase counters of all the runs, printed once at the end
+static ECSimPerfCounters perfTotal;
+#endif
+
+// Print the phase counters of all the runs (if counted)
+static void PrintPerfSummary()
+{
+#ifdef ECSIM_PERF_COUNTERS
+    perfTotal.PrintSummary(cerr);
+#endif
+}
+
+static ECSimTaskScheduler *CreateScheduler(int policy)
+{
+    if (policy == 1)
+    {
+        return new ECSimLWTFTaskScheduler;
+    }
+    if (policy == 2)
+    {
+        return new ECSimRoundRobinTaskScheduler;
+    }
+    if (policy == 3)
+    {
+        return new ECSimPriorityScheduler;
+    }
+    if (policy == 4)
+    {
+        return new ECSimCFSScheduler;
+    }
+    if (policy == 5)
+    {
+        ECSimMLFQScheduler *pScheduler = new ECSimMLFQScheduler(4, 2);
+        pScheduler->SetAgingWait(20);
+        return pScheduler;
+    }
+    return new ECSimFIFOTaskScheduler;
+}
+
+static ECSimRunResult RunEngine(const ECSimWorkload &workload, int policy, bool fWheel, int duration)
+{
+    ECSimWorkloadTasks tasks;
+    ECSimTaskScheduler *pScheduler = CreateScheduler(policy);
+    pScheduler->SetTimingWheel(fWheel);
+    tasks.Build(workload, pScheduler);
+    ECSimRunResult res;
+    res.tmSimRun = pScheduler->Simulate64(duration);
+    for (auto x : tasks.GetTasks())
+    {
+        res.listIds.push_back(x->GetId());
+        res.listRun.push_back(x->GetTotRunTime64());
+        res.listWait.push_back(x->GetTotWaitTime64());
+    }
+#ifdef ECSIM_PERF_COUNTERS
+    perfTotal.Add(pScheduler->GetPerfCounters());
+#endif
+    delete pScheduler;
+    return res;
+}
+
+int main(int argc, char **argv)
+{
+    int gen = 2;
+    if (argc > 2 && string(argv[1]) == "--gen")
+    {
+        gen = atoi(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    ECSimWorkloadConfig config;
+    config.SetGeneration(gen);
+    if (gen == 3)
+    {
+        config.probDecorator = 0.3;
+    }
+    else
+    {
+        config.priorityMix.clear();
+        config.priorityMix.push_back(make_pair(1, 0.3));
+        config.priorityMix.push_back(make_pair(2, 0.7));
+    }
+    config.numTasks = 200;
+    config.tmHorizon = 4000;
+    config.lenMax = 40;
+    // periodic tasks never finish
+    int duration = 6000;
+    const char *reproPath = gen == 3 ? "repro3.scenario" : "repro.scenario";
+
+    if (argc > 2 && string(argv[1]) == "--replay")
+    {
+        ECSimWorkload workload;
+        if (!workload.Load(argv[2]))
+        {
+            cerr << "cannot read " << argv[2] << endl;
+            return 1;
+        }
+        bool fOk = true;
+        for (int policy = 0; policy < NUM_POLICIES; ++policy)
+        {
+            ECSimDifferential diff([=](const ECSimWorkload &w) { return RunEngine(w, policy, false, duration); },
+                                   [=](const ECSimWorkload &w) { return RunEngine(w, policy, true, duration); });
+            string msg;
+            if (!diff.Compare(workload, msg))
+            {
+                cout << policyNames[policy] << ": MISMATCH: " << msg << endl;
+                fOk = false;
+            }
+        }
+        PrintPerfSummary();
+        return fOk ? 0 : 1;
+    }
+
+    int numScenarios = argc > 1 ? atoi(argv[1]) : 50;
+    config.seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    for (int arrival = EC_ARRIVAL_POISSON; arrival <= EC_ARRIVAL_DIURNAL; ++arrival)
+    {
+        config.arrival = arrival;
+        config.diurnalPeriod = 1000;
+        for (int policy = 0; policy < NUM_POLICIES; ++policy)
+        {
+            ECSimDifferential diff([=](const ECSimWorkload &w) { return RunEngine(w, policy, false, duration); },
+                                   [=](const ECSimWorkload &w) { return RunEngine(w, policy, true, duration); });
+            ECSimWorkload repro;
+            string msg;
+            if (!diff.Run(config, numScenarios, repro, msg))
+            {
+                cout << policyNames[policy] << ", arrival " << arrival << ": MISMATCH: " << msg << endl;
+                cout << repro.ToString();
+                repro.Save(reproPath);
+                PrintPerfSummary();
+                return 1;
+            }
+            cout << policyNames[policy] << ", arrival " << arrival << ": " << numScenarios << " scenarios match" << endl;
+        }
+    }
+    PrintPerfSummary();
+    return 0;
+}
@@ -0,0 +1,176 @@
+//
+//  ECSimTaskHandle.h
+//
+//
+//  Value-semantic task handle, in the style of std::function: it holds any task kind by value, and small
+//  tasks (a plain interval task, or one decorator around one) live inside the handle itself, with no heap
+//  object of their own. A handle can also borrow a task owned elsewhere, so APIs taking a handle still take
+//  a plain ECSimTask *. Handles move but don't copy: a task carries its running state, and a copy would split it
+//
+
+#ifndef ECSimTaskHandle_h
+#define ECSimTaskHandle_h
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <type_traits>
+#include "ECSimTaskBase.h"
+
+namespace ecsim
+{
+
+//***********************************************************
+// Task handle with room for Capacity bytes of task inline
+
+template <size_t Capacity>
+class ECSimTaskHandle
+{
+public:
+    // Empty handle
+    ECSimTaskHandle() : pTask(NULL), pfnMove(NULL), sizeTask(0), fHeap(false) {}
+
+    // Borrow a task owned elsewhere (as a plain pointer would)
+    ECSimTaskHandle(ECSimTask *pTaskIn) : pTask(pTaskIn), pfnMove(NULL), sizeTask(0), fHeap(false) {}
+
+    // Own the task, moved (or copied) in: inline if it fits, else on the heap
+    template <class T, class = typename std::enable_if<std::is_base_of<ECSimTask, typename std::decay<T>::type>::value>::type>
+    ECSimTaskHandle(T &&task) : pTask(NULL), pfnMove(NULL), sizeTask(sizeof(typename std::decay<T>::type)), fHeap(false)
+    {
+        typedef typename std::decay<T>::type TTask;
+        Emplace<TTask>(std::forward<T>(task), std::integral_constant<bool, IsInlineFit<TTask>()>());
+    }
+
+    ECSimTaskHandle(ECSimTaskHandle &&rhs) noexcept : pTask(NULL), pfnMove(NULL), sizeTask(0), fHeap(false) { MoveFrom(rhs); }
+    ECSimTaskHandle &operator=(ECSimTaskHandle &&rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            Reset();
+            MoveFrom(rhs);
+        }
+        return *this;
+    }
+    ECSimTaskHandle(const ECSimTaskHandle &) = delete;
+    ECSimTaskHandle &operator=(const ECSimTaskHandle &) = delete;
+    ~ECSimTaskHandle() { Reset(); }
+
+    // The task (NULL if empty); an inline task moves along with the handle
+    ECSimTask *Get() const { return pTask; }
+    ECSimTask *operator->() const { return pTask; }
+    ECSimTask &operator*() const { return *pTask; }
+    explicit operator bool() const { return pTask != NULL; }
+
+    // Does the handle own its task, and is it stored inline?
+    bool IsOwned() const { return pfnMove != NULL || fHeap; }
+    bool IsInline() const { return pfnMove != NULL; }
+
+    // Size of the task object (0 if borrowed)
+    size_t GetTaskSize() const { return sizeTask; }
+
+    // Bytes the task takes outside the handle: all of it on the heap, what it owns if inline, nothing if borrowed
+    size_t GetMemoryUsage() const
+    {
+        if (!IsOwned())
+        {
+            return 0;
+        }
+        size_t numBytes = pTask->GetMemoryUsage();
+        if (fHeap)
+        {
+            return numBytes;
+        }
+        return numBytes > sizeTask ? numBytes - sizeTask : 0;
+    }
+
+    // Would a task of kind T be stored inline?
+    template <class T>
+    static constexpr bool IsInlineFit()
+    {
+        return sizeof(T) <= Capacity && alignof(T) <= alignof(void *) && std::is_nothrow_move_constructible<T>::value;
+    }
+
+    // Destroy an owned task and become empty
+    void Reset()
+    {
+        if (pfnMove != NULL)
+        {
+            pTask->~ECSimTask();
+        }
+        else if (fHeap)
+        {
+            delete pTask;
+        }
+        pTask = NULL;
+        pfnMove = NULL;
+        sizeTask = 0;
+        fHeap = false;
+    }
+
+private:
+    // create the task inline or on the heap
+    template <class TTask, class T>
+    void Emplace(T &&task, std::true_type)
+    {
+        pTask = new (&storage) TTask(std::forward<T>(task));
+        pfnMove = &MoveInline<TTask>;
+    }
+    template <class TTask, class T>
+    void Emplace(T &&task, std::false_type)
+    {
+        pTask = new TTask(std::forward<T>(task));
+        fHeap = true;
+    }
+
+    // move the inline task at pSrc into buf and destroy the source
+    template <class T>
+    static ECSimTask *MoveInline(ECSimTask *pSrc, void *buf)
+    {
+        T *pSrcT = static_cast<T *>(pSrc);
+        ECSimTask *pDest = new (buf) T(std::move(*pSrcT));
+        pSrcT->~T();
+        return pDest;
+    }
+
+    // take over rhs's task and leave rhs empty
+    void MoveFrom(ECSimTaskHandle &rhs)
+    {
+        if (rhs.pfnMove != NULL)
+        {
+            pTask = rhs.pfnMove(rhs.pTask, &storage);
+        }
+        else
+        {
+            pTask = rhs.pTask;
+        }
+        pfnMove = rhs.pfnMove;
+        sizeTask = rhs.sizeTask;
+        fHeap = rhs.fHeap;
+        rhs.pTask = NULL;
+        rhs.pfnMove = NULL;
+        rhs.sizeTask = 0;
+        rhs.fHeap = false;
+    }
+
+    typename std::aligned_storage<Capacity, alignof(void *)>::type storage;
+    ECSimTask *pTask;
+    // set for an inline task; a heap task is deleted, a borrowed one is left alone
+    ECSimTask *(*pfnMove)(ECSimTask *pSrc, void *buf);
+    uint32_t sizeTask;
+    bool fHeap;
+};
+
+// Handle to a wrapped task (a subtask or the task inside a decorator): room for any ECSimTask / ECSimTask2 kind
+// and a plain ECSimIntervalTask
+typedef ECSimTaskHandle<56> ECSimSubtaskHandle;
+
+// Handle to a top-level task: room for a decorator around an inline wrapped task
+typedef ECSimTaskHandle<136> Task;
+
+} // namespace ecsim
+
+using ecsim::ECSimTaskHandle;
+using ecsim::ECSimSubtaskHandle;
+
+#endif /* ECSimTaskHandle_h */
@@ -0,0 +1,164 @@
+//
+//  ECSimTaskIds.cpp
+//
+//
+//
+
+#include "ECSimTaskIds.h"
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+namespace ecsim
+{
+
+// Ids are packed into fixed-size character blocks (an id never spans two), found through fixed-size blocks of
+// entries (offset in the pool << 16 | length). Blocks never move once allocated, so readers need no lock.
+// Each distinct id is kept once: an open-addressing table of indices finds ids added before
+static const int idsEntryBits = 16;
+static const size_t idsEntryBlock = (size_t)1 << idsEntryBits;
+static const int idsCharBits = 20;
+static const size_t idsCharBlock = (size_t)1 << idsCharBits;
+static const size_t idsMaxBlocks = 65536;
+static const size_t idsMaxLen = 65535;
+
+static atomic<uint64_t *> listEntryBlocks[idsMaxBlocks];
+static atomic<char *> listCharBlocks[idsMaxBlocks];
+static mutex idsLock;
+static uint32_t numIds = 1;
+static uint64_t posChars = 0;
+static size_t numIdBytes = 0;
+static vector<uint32_t> listHash;
+
+// characters of the id at an index (the caller holds the lock or knows the index is published)
+static const char *GetChars(uint32_t index, size_t &len)
+{
+    uint64_t entry = listEntryBlocks[index >> idsEntryBits].load(memory_order_acquire)[index & (idsEntryBlock - 1)];
+    uint64_t pos = entry >> 16;
+    len = (size_t)(entry & 0xffff);
+    return listCharBlocks[pos >> idsCharBits].load(memory_order_acquire) + (pos & (idsCharBlock - 1));
+}
+
+// FNV-1a
+static size_t HashChars(const char *pChars, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h = (h ^ (unsigned char)pChars[i]) * 1099511628211ULL;
+    }
+    return (size_t)(h ^ (h >> 32));
+}
+
+// slot of the id in the table: where it is, or the empty one where it would go
+static size_t FindSlot(const char *pChars, size_t len, size_t h)
+{
+    size_t mask = listHash.size() - 1;
+    for (size_t slot = h & mask;; slot = (slot + 1) & mask)
+    {
+        uint32_t index = listHash[slot];
+        if (index == 0)
+        {
+            return slot;
+        }
+        size_t lenOther;
+        const char *pOther = GetChars(index, lenOther);
+        if (lenOther == len && memcmp(pOther, pChars, len) == 0)
+        {
+            return slot;
+        }
+    }
+}
+
+uint32_t ECSimTaskIds ::Add(const std::string &id)
+{
+    if (id.empty())
+    {
+        return 0;
+    }
+    size_t len = id.size() < idsMaxLen ? id.size() : idsMaxLen;
+    size_t h = HashChars(id.data(), len);
+    lock_guard<mutex> lock(idsLock);
+    if (listHash.empty())
+    {
+        listHash.assign(1024, 0);
+    }
+    size_t slot = FindSlot(id.data(), len, h);
+    if (listHash[slot] != 0)
+    {
+        return listHash[slot];
+    }
+    // the characters: start a new block if they don't fit in the current one
+    if ((posChars & (idsCharBlock - 1)) + len > idsCharBlock)
+    {
+        posChars = (posChars + idsCharBlock - 1) & ~(uint64_t)(idsCharBlock - 1);
+    }
+    size_t block = (size_t)(posChars >> idsCharBits);
+    if (block >= idsMaxBlocks)
+    {
+        return 0;
+    }
+    char *pChars = listCharBlocks[block].load(memory_order_relaxed);
+    if (pChars == NULL)
+    {
+        pChars = new char[idsCharBlock];
+        numIdBytes += idsCharBlock;
+        listCharBlocks[block].store(pChars, memory_order_release);
+    }
+    memcpy(pChars + (posChars & (idsCharBlock - 1)), id.data(), len);
+    // the entry
+    uint32_t index = numIds;
+    size_t blockEntry = index >> idsEntryBits;
+    if (blockEntry >= idsMaxBlocks)
+    {
+        return 0;
+    }
+    uint64_t *pEntries = listEntryBlocks[blockEntry].load(memory_order_relaxed);
+    if (pEntries == NULL)
+    {
+        pEntries = new uint64_t[idsEntryBlock];
+        numIdBytes += idsEntryBlock * sizeof(uint64_t);
+        listEntryBlocks[blockEntry].store(pEntries, memory_order_release);
+    }
+    pEntries[index & (idsEntryBlock - 1)] = posChars << 16 | len;
+    posChars += len;
+    ++numIds;
+    listHash[slot] = index;
+    // keep the table at most half full
+    if (2 * (size_t)numIds > listHash.size())
+    {
+        vector<uint32_t> listOld(2 * listHash.size(), 0);
+        listOld.swap(listHash);
+        for (uint32_t x : listOld)
+        {
+            if (x != 0)
+            {
+                size_t lenX;
+                const char *pX = GetChars(x, lenX);
+                listHash[FindSlot(pX, lenX, HashChars(pX, lenX))] = x;
+            }
+        }
+    }
+    return index;
+}
+
+std::string ECSimTaskIds ::Get(uint32_t index)
+{
+    if (index == 0)
+    {
+        return string();
+    }
+    size_t len;
+    const char *pChars = GetChars(index, len);
+    return string(pChars, len);
+}
+
+size_t ECSimTaskIds ::GetMemoryUsage()
+{
+    lock_guard<mutex> lock(idsLock);
+    return numIdBytes + listHash.capacity() * sizeof(uint32_t);
+}
+
+} // namespace ecsim
@@ -0,0 +1,34 @@
+//
+//  ECSimTaskIds.h
+//
+//
+//  Task ids, kept out of the tasks: a task holds a 32-bit index, and the characters of each distinct id live
+//  once in a shared pool. Adding ids takes a lock; looking them up doesn't
+//
+
+#ifndef ECSimTaskIds_h
+#define ECSimTaskIds_h
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace ecsim
+{
+
+class ECSimTaskIds
+{
+public:
+    // Index of an id, the same for equal ids (0 for the empty id). Ids longer than 64K characters are cut
+    static uint32_t Add(const std::string &id);
+
+    // The id at an index
+    static std::string Get(uint32_t index);
+
+    // Bytes taken by the ids added so far
+    static size_t GetMemoryUsage();
+};
+
+} // namespace ecsim
+
+#endif /* ECSimTaskIds_h */
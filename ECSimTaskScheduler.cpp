@@ -2,7 +2,6 @@
 //  ECSimTaskScheduler.cpp
 //
 //
-//  DON'T CHANGE THIS FILE!!
 //
 
 #include <vector>
@@ -10,98 +9,530 @@
 #include <iterator>
 #include <climits>
 #include <iostream>
+#include <iomanip>
+#include <typeinfo>
+#include <unordered_set>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
 using namespace std;
 
 #include "ECSimTaskScheduler.h"
-#include "ECSimTask.h"
+#include "ECSimTaskBase.h"
+#include "ECSimTimingWheel.h"
+#include "ECSimScheduleLog.h"
+#include "ECSimTaskIds.h"
+
+// Instrumentation of the phases of a tick (see ECSimPerfCounters.h); nothing unless built with ECSIM_PERF_COUNTERS
+#ifdef ECSIM_PERF_COUNTERS
+#define ECSIM_PERF_BEGIN() perf.Begin()
+#define ECSIM_PERF_END(phase) perf.End(phase)
+#else
+#define ECSIM_PERF_BEGIN()
+#define ECSIM_PERF_END(phase)
+#endif
+
+namespace ecsim
+{
+
+//***********************************************************
+// Memory report
+
+long long ECSimMemoryReport ::GetTotalBytes() const
+{
+    long long numBytes = numSchedulerBytes;
+    for (const auto &usage : listClasses)
+    {
+        numBytes += usage.numBytes;
+    }
+    return numBytes;
+}
+
+void ECSimMemoryReport ::Print(std::ostream &os) const
+{
+    ios::fmtflags flags = os.flags();
+    os << left << setw(32) << "class" << right << setw(14) << "tasks" << setw(16) << "bytes" << setw(12) << "per task" << "\n";
+    for (const auto &usage : listClasses)
+    {
+        os << left << setw(32) << usage.name << right << setw(14) << usage.numTasks << setw(16) << usage.numBytes;
+        os << setw(12) << fixed << setprecision(1) << (usage.numTasks > 0 ? (double)usage.numBytes / usage.numTasks : 0.0) << "\n";
+    }
+    os << left << setw(46) << "scheduler" << right << setw(16) << numSchedulerBytes << "\n";
+    os << left << setw(46) << "total" << right << setw(16) << GetTotalBytes() << "\n";
+    os << left << setw(46) << "task ids (shared, not in total)" << right << setw(16) << numIdBytes << "\n";
+    os.flags(flags);
+}
 
 //***********************************************************
 // Simulation task scheduler
 
-ECSimTaskScheduler ::ECSimTaskScheduler() : timeCurr(0), pTaskCurr(NULL)
+ECSimTaskScheduler ::ECSimTaskScheduler() : timeCurr(0), pTaskCurr(NULL), numReady(0), tmTotWait(0), tmTotRun(0), statsInterval(0), statsCountdown(0), pWheel(NULL), numTasksAdded(0), pLog(NULL), fTrace(false), switchCost(0), pTaskLoaded(NULL), numLoadedRunTicks(0), numSwitchTicksLeft(0), numSwitches(0), numSwitchTicks(0)
 {
 }
 
 ECSimTaskScheduler ::~ECSimTaskScheduler()
 {
+    delete pWheel;
 }
 
 // Add a task to be scheduled
 void ECSimTaskScheduler ::AddTask(ECSimTask *pTask)
 {
+    if (pWheel != NULL)
+    {
+        // tasks starting later wait in the wheel; remember the order for FIFO ties
+        mapTaskOrder[pTask] = numTasksAdded++;
+        ECSimTime tmStart = pTask->GetStartTime();
+        if (tmStart > timeCurr + 1)
+        {
+            pWheel->Insert(tmStart, pTask);
+            return;
+        }
+    }
     listTasks.push_back(pTask);
 }
 
+// Add a task that the scheduler keeps
+ECSimTask *ECSimTaskScheduler ::AddTask(Task task)
+{
+    const size_t numBlockTasks = 64;
+    if (!task)
+    {
+        return NULL;
+    }
+    if (listOwnedTasks.empty() || listOwnedTasks.back().size() == numBlockTasks)
+    {
+        listOwnedTasks.push_back(vector<Task>());
+        listOwnedTasks.back().reserve(numBlockTasks);
+    }
+    listOwnedTasks.back().push_back(std::move(task));
+    ECSimTask *pTask = listOwnedTasks.back().back().Get();
+    AddTask(pTask);
+    return pTask;
+}
+
 // Remove a task from the list of tasks to be scheduled
 void ECSimTaskScheduler ::RemoveTask(ECSimTask *pTask)
 {
     listTasks.erase(std::remove(listTasks.begin(), listTasks.end(), pTask), listTasks.end());
+    if (pWheel != NULL)
+    {
+        pWheel->Remove(pTask->GetStartTime(), pTask);
+        mapTaskOrder.erase(pTask);
+    }
+    ForgetTask(pTask);
+}
+
+void ECSimTaskScheduler ::ForgetTask(ECSimTask *pTask)
+{
+    // another task may later be added at its address: it must not inherit the quantum, nor skip the switch
+    if (pTask == pTaskLoaded)
+    {
+        pTaskLoaded = NULL;
+        numLoadedRunTicks = 0;
+    }
+    TaskRemoved(pTask);
+}
+
+// Turn the timing wheel on or off
+void ECSimTaskScheduler ::SetTimingWheel(bool fWheel)
+{
+    if (fWheel && pWheel == NULL)
+    {
+        pWheel = new ECSimTimingWheel<ECSimTask *>;
+        for (auto x : listTasks)
+        {
+            mapTaskOrder[x] = numTasksAdded++;
+        }
+    }
+    else if (!fWheel && pWheel != NULL)
+    {
+        // all tasks go back to the list
+        ActivateTasks(EC_TIME_MAX);
+        delete pWheel;
+        pWheel = NULL;
+        mapTaskOrder.clear();
+    }
+}
+
+// Move the tasks that start by tick from the wheel to the task list, keeping the order they were added
+void ECSimTaskScheduler ::ActivateTasks(ECSimTime tick)
+{
+    vector<ECSimTask *> listStart;
+    pWheel->Advance(tick, listStart);
+    if (listStart.empty())
+    {
+        return;
+    }
+    auto byOrder = [this](ECSimTask *px, ECSimTask *py)
+    { return mapTaskOrder[px] < mapTaskOrder[py]; };
+    std::sort(listStart.begin(), listStart.end(), byOrder);
+    size_t numOld = listTasks.size();
+    listTasks.insert(listTasks.end(), listStart.begin(), listStart.end());
+    if (numOld > 0 && byOrder(listTasks[numOld], listTasks[numOld - 1]))
+    {
+        std::inplace_merge(listTasks.begin(), listTasks.begin() + numOld, listTasks.end(), byOrder);
+    }
 }
 
 // Run simulation for the period of duration. If duration < 0, then run until there is no tasks is left
 // Return the number of ticks that it runs (can be smaller than duration if it terminates earlier)
 // Caution: this potneitally can enter an infinite loop
-int ECSimTaskScheduler ::Simulate(int duration)
+ECSimTime ECSimTaskScheduler ::Simulate64(ECSimTime duration)
 {
-    int durationUse = duration;
+    ECSimTime durationUse = duration;
     if (durationUse < 0)
     {
-        durationUse = INT_MAX;
-    }
-    int numStepsRuns = 0;
-    for (int step = 0; step < durationUse; ++step)
-    {
-        // first make sure there is some task to simulate
-        // update the list of tasks; remove those that are already finished; again, use lambda
-        // If a task is to expire at the next tick, consider it finished
-        int tmCur = GetTime();
-        auto it1 = std::remove_if(this->listTasks.begin(), this->listTasks.end(), [tmCur](ECSimTask *px)
-                                  { return px->IsFinished(tmCur + 1); });
-        // cout << "Number of tasks completed: " << listTasks.end()-it1 << endl;
-        listTasks.erase(it1, this->listTasks.end());
-        /*ECSimTask *ptc = GetCurrTask();
-        if( ptc != NULL )
+        durationUse = EC_TIME_MAX;
+    }
+    ECSimTime numStepsRuns = 0;
+    statsCountdown = statsInterval;
+    while (numStepsRuns < durationUse)
+    {
+        ECSimTime numTicks = Step(durationUse - numStepsRuns);
+        if (numTicks == 0)
         {
-        cout << "Current task: " << ptc->GetId() << endl;
+            break;
         }
-        else
+        numStepsRuns += numTicks;
+    }
+    if (statsInterval > 0)
+    {
+        PublishStats(numReady);
+    }
+    return numStepsRuns;
+}
+
+// Simulate the next tick; with the timing wheel, a stretch of at most maxTicks idle ticks is skipped at once.
+// Return the number of ticks simulated, 0 if no task is left (or the clock can't go further)
+ECSimTime ECSimTaskScheduler ::Step(ECSimTime maxTicks)
+{
+    if (timeCurr == EC_TIME_MAX)
+    {
+        return 0;
+    }
+    // first make sure there is some task to simulate
+    // update the list of tasks; remove those that are already finished; again, use lambda
+    // If a task is to expire at the next tick, consider it finished
+    ECSIM_PERF_BEGIN();
+    ECSimTime tmCur = timeCurr;
+    if (pWheel != NULL)
+    {
+        ActivateTasks(tmCur + 1);
+    }
+    auto it1 = std::remove_if(this->listTasks.begin(), this->listTasks.end(), [this, tmCur](ECSimTask *px)
+                              {
+                                  if (!px->IsFinished(tmCur + 1) && !px->IsAborted(tmCur + 1))
+                                  {
+                                      return false;
+                                  }
+                                  ForgetTask(px);
+                                  return true; });
+    // cout << "Number of tasks completed: " << listTasks.end()-it1 << endl;
+    listTasks.erase(it1, this->listTasks.end());
+    ECSIM_PERF_END(EC_PERF_RETIRE);
+    /*ECSimTask *ptc = GetCurrTask();
+    if( ptc != NULL )
+    {
+    cout << "Curr time: " << tmCur << ", Current task: " << ptc->GetId() << endl;
+    }
+    else
+    {
+    cout << "Curr time: " << tmCur <<  ". No task active\n";
+    }*/
+    // stop simulation if no simulation left
+    if (this->listTasks.size() == 0)
+    {
+        if (pWheel == NULL || pWheel->IsEmpty())
         {
-        cout << "No task active\n";
-        }*/
-        // stop simulation if no simulation left
-        if (this->listTasks.size() == 0)
+            return 0;
+        }
+        // nothing is active until the next task starts: skip the idle ticks
+        ECSimTime numIdle = std::min(pWheel->PeekNext() - 1 - tmCur, maxTicks);
+        SetTime(tmCur + numIdle);
+        SetTask(NULL);
+        numReady = 0;
+        return numIdle;
+    }
+    if (pWheel != NULL && maxTicks > 1 && numReady == 0 && numSwitchTicksLeft == 0)
+    {
+        // the last tick was idle: skip the ticks before any task can be ready (the policy has seen an idle tick,
+        // and more of them change nothing)
+        ECSimTime numIdle = SkipIdle(maxTicks);
+        if (numIdle > 0)
         {
-            break;
+            SetTime(tmCur + numIdle);
+            SetTask(NULL);
+            return numIdle;
         }
+    }
 
-        ++numStepsRuns;
-        // update time each time we run simulation
-        int tmNew = GetTime() + 1;
-        SetTime(tmNew);
+    // update time each time we run simulation
+    ECSimTime tmNew = timeCurr + 1;
+    SetTime(tmNew);
+    if (fTrace)
+    {
         cout << "Simulaton: " << tmNew << endl;
-        //  Find out all ready-to-run tasks. YW: use Lambda here to make code shorter
-        vector<ECSimTask *> listReadyTasks;
-        std::copy_if(this->listTasks.begin(), this->listTasks.end(), std::back_inserter(listReadyTasks), [tmNew](ECSimTask *px)
-                     { return px->IsReadyToRun(tmNew); });
+    }
+    //   Find out all ready-to-run tasks. YW: use Lambda here to make code shorter
+    ECSIM_PERF_BEGIN();
+    vector<ECSimTask *> listReadyTasks;
+    std::copy_if(this->listTasks.begin(), this->listTasks.end(), std::back_inserter(listReadyTasks), [tmNew](ECSimTask *px)
+                 { return px->IsReadyToRun(tmNew); });
+    ECSIM_PERF_END(EC_PERF_READY);
 
-        // find the task to schedule for this time
-        ECSimTask *ptNext = ChooseTaskToSchedule(listReadyTasks);
+    // find the task to schedule for this time
+    ECSimTask *ptNext = NULL;
+    if (numSwitchTicksLeft > 0)
+    {
+        // still switching to the loaded task: nothing runs
+        --numSwitchTicksLeft;
+        ++numSwitchTicks;
+    }
+    else
+    {
+        ECSIM_PERF_BEGIN();
+        ptNext = ChooseTaskToSchedule(listReadyTasks);
+        ECSIM_PERF_END(EC_PERF_CHOOSE);
+        if (ptNext != NULL && ptNext != pTaskLoaded)
+        {
+            // context switch: with a cost, the new task only runs once it is paid
+            ++numSwitches;
+            pTaskLoaded = ptNext;
+            numLoadedRunTicks = 0;
+            if (switchCost > 0)
+            {
+                numSwitchTicksLeft = switchCost - 1;
+                ++numSwitchTicks;
+                ptNext = NULL;
+            }
+        }
+    }
 
-        // let all other ready tasks to wait
-        if (ptNext != NULL)
+    // let all other ready tasks to wait
+    ECSIM_PERF_BEGIN();
+    if (ptNext != NULL)
+    {
+        ++numLoadedRunTicks;
+        ptNext->Run(tmNew, 1);
+        if (fTrace)
         {
-            ptNext->Run(tmNew, 1);
-            for (auto x : listReadyTasks)
+            cout << "running: " << ptNext->GetId() << endl;
+        }
+    }
+    for (auto x : listReadyTasks)
+    {
+        if (x != ptNext)
+        {
+            if (fTrace)
             {
-                if (x != ptNext)
-                {
-                    x->Wait(tmNew, 1);
-                }
+                cout << "Waiting: " << x->GetId() << endl;
             }
+            x->Wait(tmNew, 1);
         }
-        SetTask(ptNext);
     }
-    return numStepsRuns;
+    ECSIM_PERF_END(EC_PERF_DISPATCH);
+    SetTask(ptNext);
+    if (pLog != NULL)
+    {
+        pLog->RecordTick(tmNew, ptNext, listReadyTasks);
+    }
+
+    // keep the aggregate counters and publish them every statsInterval ticks
+    numReady = (int)listReadyTasks.size();
+    if (ptNext != NULL)
+    {
+        ++tmTotRun;
+    }
+    tmTotWait += numReady - (ptNext != NULL ? 1 : 0);
+    if (statsInterval > 0 && --statsCountdown <= 0)
+    {
+        PublishStats(numReady);
+        statsCountdown = statsInterval;
+    }
+    return 1;
+}
+
+// Idle ticks from the next one on, before the first tick any task (active or in the wheel) can be ready at
+ECSimTime ECSimTaskScheduler ::SkipIdle(ECSimTime maxTicks)
+{
+    ECSimTime tmNext = pWheel->IsEmpty() ? EC_TIME_MAX : pWheel->PeekNext();
+    for (auto x : listTasks)
+    {
+        tmNext = std::min(tmNext, x->GetNextEventTime(timeCurr + 1));
+        if (tmNext <= timeCurr + 1)
+        {
+            return 0;
+        }
+    }
+    return std::min(tmNext - 1 - timeCurr, maxTicks);
+}
+
+// Move an idle scheduler's clock forward
+void ECSimTaskScheduler ::AdvanceTime(ECSimTime tick)
+{
+    if (tick > timeCurr)
+    {
+        SetTime(tick);
+        SetTask(NULL);
+        numReady = 0;
+    }
+}
+
+// Save the state needed to roll back to the current tick
+void ECSimTaskScheduler ::SaveCheckpoint(ECSimSchedulerCheckpoint &checkpoint) const
+{
+    checkpoint.timeCurr = timeCurr;
+    checkpoint.pTaskCurr = pTaskCurr;
+    checkpoint.numReady = numReady;
+    checkpoint.tmTotWait = tmTotWait;
+    checkpoint.tmTotRun = tmTotRun;
+    checkpoint.numTasksAdded = numTasksAdded;
+    checkpoint.pTaskLoaded = pTaskLoaded;
+    checkpoint.numLoadedRunTicks = numLoadedRunTicks;
+    checkpoint.numSwitchTicksLeft = numSwitchTicksLeft;
+    checkpoint.numSwitches = numSwitches;
+    checkpoint.numSwitchTicks = numSwitchTicks;
+    checkpoint.listTasks = listTasks;
+    checkpoint.listWheel.clear();
+    if (pWheel != NULL)
+    {
+        pWheel->GetItems(checkpoint.listWheel);
+    }
+    checkpoint.listState.clear();
+    for (auto x : listTasks)
+    {
+        x->SaveState(checkpoint.listState);
+    }
+    for (const auto &item : checkpoint.listWheel)
+    {
+        item.second->SaveState(checkpoint.listState);
+    }
+    checkpoint.listPolicyTasks.clear();
+    checkpoint.listPolicyState.clear();
+    SavePolicyState(checkpoint);
+}
+
+// Roll back to a saved tick
+void ECSimTaskScheduler ::RestoreCheckpoint(const ECSimSchedulerCheckpoint &checkpoint)
+{
+    timeCurr = checkpoint.timeCurr;
+    pTaskCurr = checkpoint.pTaskCurr;
+    numReady = checkpoint.numReady;
+    tmTotWait = checkpoint.tmTotWait;
+    tmTotRun = checkpoint.tmTotRun;
+    numTasksAdded = checkpoint.numTasksAdded;
+    pTaskLoaded = checkpoint.pTaskLoaded;
+    numLoadedRunTicks = checkpoint.numLoadedRunTicks;
+    numSwitchTicksLeft = checkpoint.numSwitchTicksLeft;
+    numSwitches = checkpoint.numSwitches;
+    numSwitchTicks = checkpoint.numSwitchTicks;
+    listTasks = checkpoint.listTasks;
+    if (pWheel != NULL)
+    {
+        // rebuild the wheel from scratch: its clock can't go back
+        delete pWheel;
+        pWheel = new ECSimTimingWheel<ECSimTask *>;
+        for (const auto &item : checkpoint.listWheel)
+        {
+            pWheel->Insert(item.first, item.second);
+        }
+    }
+    size_t pos = 0;
+    for (auto x : listTasks)
+    {
+        x->RestoreState(checkpoint.listState, pos);
+    }
+    for (const auto &item : checkpoint.listWheel)
+    {
+        item.second->RestoreState(checkpoint.listState, pos);
+    }
+    RestorePolicyState(checkpoint);
+}
+
+// Name of the class of a task
+static string GetTaskClassName(const ECSimTask *pTask)
+{
+    const char *name = typeid(*pTask).name();
+#ifdef __GNUG__
+    int status = 0;
+    char *pDemangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if (status == 0 && pDemangled != NULL)
+    {
+        string str(pDemangled);
+        free(pDemangled);
+        return str;
+    }
+#endif
+    return name;
+}
+
+// Bytes taken by the tasks, the scheduler and the task ids
+ECSimMemoryReport ECSimTaskScheduler ::MemoryReport() const
+{
+    ECSimMemoryReport report;
+    map<string, ECSimMemoryUsage> mapClasses;
+    unordered_set<const ECSimTask *> setSeen;
+    auto addTask = [&](const ECSimTask *pTask)
+    {
+        if (setSeen.insert(pTask).second)
+        {
+            ECSimMemoryUsage &usage = mapClasses[GetTaskClassName(pTask)];
+            ++usage.numTasks;
+            usage.numBytes += pTask->GetMemoryUsage();
+        }
+    };
+    // storage of the tasks kept by value: what the tasks inside don't take
+    long long numBytes = sizeof(*this) + listOwnedTasks.capacity() * sizeof(listOwnedTasks[0]);
+    for (const auto &block : listOwnedTasks)
+    {
+        numBytes += block.capacity() * sizeof(Task);
+        for (const auto &task : block)
+        {
+            addTask(task.Get());
+            numBytes -= task.IsInline() ? task.GetTaskSize() : 0;
+        }
+    }
+    for (auto x : listTasks)
+    {
+        addTask(x);
+    }
+    numBytes += listTasks.capacity() * sizeof(ECSimTask *);
+    if (pWheel != NULL)
+    {
+        vector<pair<ECSimTime, ECSimTask *> > listWheel;
+        pWheel->GetItems(listWheel);
+        for (const auto &item : listWheel)
+        {
+            addTask(item.second);
+        }
+        // the order map: a node per task, and the buckets
+        numBytes += pWheel->GetMemoryUsage() + mapTaskOrder.size() * (sizeof(void *) + sizeof(pair<ECSimTask *const, long long>) + sizeof(size_t)) + mapTaskOrder.bucket_count() * sizeof(void *);
+    }
+    report.numSchedulerBytes = numBytes;
+    report.numIdBytes = (long long)ECSimTaskIds::GetMemoryUsage();
+    for (auto &item : mapClasses)
+    {
+        item.second.name = item.first;
+        report.listClasses.push_back(item.second);
+    }
+    std::stable_sort(report.listClasses.begin(), report.listClasses.end(), [](const ECSimMemoryUsage &x, const ECSimMemoryUsage &y)
+                     { return x.numBytes > y.numBytes; });
+    return report;
+}
+
+// Publish the current statistics for observers
+void ECSimTaskScheduler ::PublishStats(int numReady)
+{
+    ECSimStats<ECSimTask> st;
+    st.tick = GetTime64();
+    st.numTasks = (int)listTasks.size();
+    st.numReady = numReady;
+    st.pTaskCurr = GetCurrTask();
+    st.tmTotWait = tmTotWait;
+    st.tmTotRun = tmTotRun;
+    stats.Publish(st);
 }
 
 //***********************************************************
@@ -124,3 +555,47 @@ ECSimTask *ECSimFIFOTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSim
         return NULL;
     }
 }
+
+//***********************************************************
+// Longest wait-time first scheduler
+
+ECSimLWTFTaskScheduler ::ECSimLWTFTaskScheduler()
+{
+}
+
+// Choose from a list of tasks that are ready to run
+ECSimTask *ECSimLWTFTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+{
+    ECSimTask *pNext = NULL;
+    for (auto task : listReadyTasks)
+    {
+        if (pNext == NULL || task->GetTotWaitTime64() > pNext->GetTotWaitTime64())
+        {
+            pNext = task;
+        }
+    }
+    return pNext;
+}
+
+//***********************************************************
+// Round-robin scheduler
+
+ECSimRoundRobinTaskScheduler ::ECSimRoundRobinTaskScheduler()
+{
+}
+
+// Choose from a list of tasks that are ready to run
+ECSimTask *ECSimRoundRobinTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+{
+    ECSimTask *pNext = NULL;
+    for (auto task : listReadyTasks)
+    {
+        if (pNext == NULL || task->GetTotRunTime64() < pNext->GetTotRunTime64())
+        {
+            pNext = task;
+        }
+    }
+    return pNext;
+}
+
+} // namespace ecsim
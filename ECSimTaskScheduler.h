@@ -2,15 +2,90 @@
 //  ECSimTaskScheduler.h
 //  
 //
-//  DON'T CHANGE THIS FILE!!
+//  Scheduler core shared by all task kinds (see ECSimTaskBase.h), with the basic policies;
+//  more policies are in ECSimTaskScheduler2.h
 
 #ifndef ECSimTaskScheduler_h
 #define ECSimTaskScheduler_h
 
 #include <map>
 #include <vector>
+#include <string>
+#include <ostream>
+#include <unordered_map>
+#include "ECSimStatsSnapshot.h"
+#include "ECSimTaskHandle.h"
+#include "ECSimTime.h"
+#ifdef ECSIM_PERF_COUNTERS
+#include "ECSimPerfCounters.h"
+#endif
 
-class ECSimTask;
+class ECSimScheduleLogWriter;
+template <class T>
+class ECSimTimingWheel;
+
+namespace ecsim
+{
+
+//***********************************************************
+// Scheduler state at some tick, for rolling a simulation back (see ECSimTaskScheduler::SaveCheckpoint)
+
+struct ECSimSchedulerCheckpoint
+{
+    ECSimSchedulerCheckpoint() : timeCurr(0), pTaskCurr(NULL), numReady(0), tmTotWait(0), tmTotRun(0), numTasksAdded(0), pTaskLoaded(NULL), numLoadedRunTicks(0), numSwitchTicksLeft(0), numSwitches(0), numSwitchTicks(0) {}
+    
+    ECSimTime timeCurr;
+    ECSimTask *pTaskCurr;
+    int numReady;
+    long long tmTotWait;
+    long long tmTotRun;
+    long long numTasksAdded;
+    // context switch state
+    ECSimTask *pTaskLoaded;
+    ECSimTime numLoadedRunTicks;
+    int numSwitchTicksLeft;
+    long long numSwitches;
+    long long numSwitchTicks;
+    // tasks not yet finished: active ones in order, and those waiting in the timing wheel with their start time
+    std::vector<ECSimTask *> listTasks;
+    std::vector<std::pair<ECSimTime, ECSimTask *> > listWheel;
+    // SaveState of the tasks above, in that order
+    std::vector<long long> listState;
+    // what the policy keeps of its own (see SavePolicyState): the tasks it knows, and its state
+    std::vector<ECSimTask *> listPolicyTasks;
+    std::vector<long long> listPolicyState;
+};
+
+//***********************************************************
+// Memory taken by a scheduler and its tasks, by task class (see ECSimTaskScheduler::MemoryReport)
+
+struct ECSimMemoryUsage
+{
+    ECSimMemoryUsage() : numTasks(0), numBytes(0) {}
+    
+    std::string name;
+    long long numTasks;
+    // the tasks and what they own (wrapped tasks kept by value, lists)
+    long long numBytes;
+};
+
+struct ECSimMemoryReport
+{
+    ECSimMemoryReport() : numSchedulerBytes(0), numIdBytes(0) {}
+    
+    // Sum of the tasks and the scheduler (the id pool is not the scheduler's, so it's left out)
+    long long GetTotalBytes() const;
+    
+    // Table of the classes, then the scheduler, the total and the shared id pool
+    void Print(std::ostream &os) const;
+    
+    // task classes, most bytes first
+    std::vector<ECSimMemoryUsage> listClasses;
+    // the scheduler's own lists, timing wheel and task storage (less the tasks in it)
+    long long numSchedulerBytes;
+    // the pool of task ids: process-wide, shared by all tasks of all schedulers and never freed (see ECSimTaskIds.h)
+    long long numIdBytes;
+};
 
 //***********************************************************
 // Simulation task scheduler
@@ -24,37 +99,165 @@ public:
     // Add a task to be scheduled
     void AddTask(ECSimTask *pTask);
     
+    // Add a task that the scheduler keeps, passed by value (see ECSimTaskHandle.h): small tasks are stored inline,
+    // side by side, with no heap object of their own. Returns the stored task, which stays put while the scheduler lives
+    ECSimTask *AddTask(Task task);
+    
     // Remove a task from the list of tasks to be scheduled
     void RemoveTask(ECSimTask *pTask);
     
     // Run simulation for the period of duration. If duration < 0, then run until there is no tasks is ready to run
     // Return the number of ticks that it runs (can be smaller than duration if it terminates earlier)
     // Caution: this potneitally can enter an infinite loop
-    virtual int Simulate(int duration);
+    virtual ECSimTime Simulate64(ECSimTime duration);
     
-    // Get current time
-    int GetTime() const { return timeCurr; }
+    // The same for the int API (the ticks run are clamped to INT_MAX)
+    int Simulate(int duration) { return ECSimTimeToInt(Simulate64(duration)); }
+    
+    // Simulate one tick (or, with the timing wheel, up to maxTicks idle ticks at once) and return how many; 0 if no task is left.
+    // GetTime, GetCurrTask and GetNumReady then describe the tick. Simulate is a loop of Steps
+    ECSimTime Step(ECSimTime maxTicks = 1);
+    
+    // Move the clock of an idle scheduler (Step returned 0) forward to tick without simulating, so tasks added
+    // afterwards line up with an outside clock
+    void AdvanceTime(ECSimTime tick);
+    
+    // Get current time (the int version is clamped to the int range)
+    ECSimTime GetTime64() const { return timeCurr; }
+    int GetTime() const { return ECSimTimeToInt(timeCurr); }
     
     // Get current scheduled task
     ECSimTask *GetCurrTask() const { return pTaskCurr; }
     
+    // Number of tasks that were ready at the current tick
+    int GetNumReady() const { return numReady; }
+    
+    // Pick one of the ready tasks by this scheduler's policy without simulating (e.g. among the subtasks of a composite task, see IsStateless).
+    // Stateful policies (CFS, MLFQ) count the pick as if simulating: use an instance that does nothing else
+    ECSimTask *ChooseTask(const std::vector<ECSimTask *> &listReadyTasks) const { return ChooseTaskToSchedule(listReadyTasks); }
+
+    // Does the policy pick by which tasks are ready alone (FIFO, priority), not by run / wait counters or state of its
+    // own? Then a schedule that repeats once repeats for good
+    virtual bool IsReadinessOnly() const { return false; }
+
+    // Does the policy pick by the ready tasks alone (their own counters included), keeping no state of its own and not
+    // looking at the loaded task (FIFO, LWTF, round robin, priority)? Only those can pick for a driver that doesn't simulate
+    virtual bool IsStateless() const { return false; }
+    
+    // Publish a statistics snapshot every so many ticks while simulating (0: don't publish)
+    void SetStatsInterval(int ticks) { statsInterval = ticks; }
+    
+    // Latest published statistics; safe to call from another thread while Simulate runs
+    ECSimStats<ECSimTask> GetStats() const { return stats.Read(); }
+    
+    // Event-driven mode: keep tasks that have not started yet in a timing wheel instead of checking them every tick,
+    // and skip over ticks where no task is active, or where no active task can be ready (by GetNextEventTime), so
+    // long idle spans cost one step. Results are the same as without it
+    void SetTimingWheel(bool fWheel);
+    bool IsTimingWheel() const { return pWheel != NULL; }
+    
+    // Record which task ran and which waited at every tick into a binary schedule log (NULL: none); the log is not owned
+    void SetScheduleLog(ECSimScheduleLogWriter *pLogIn) { pLog = pLogIn; }
+    
+    // Print the tick, the task that runs and those that wait to cout at every tick (off by default)
+    void SetTrace(bool fTraceIn) { fTrace = fTraceIn; }
+    
+    // Charge a context switch: whenever a different task than the loaded one (the last one switched to) is chosen,
+    // nothing runs for this many ticks (the ready tasks wait), then the new task runs. 0 (default): switches are free
+    void SetSwitchCost(int ticks) { switchCost = ticks; }
+    
+    // Context switches so far, and the ticks they cost (clamped to INT_MAX)
+    int GetNumSwitches() const { return ECSimTimeToInt(numSwitches); }
+    int GetNumSwitchTicks() const { return ECSimTimeToInt(numSwitchTicks); }
+    
+    // Task whose context is loaded (NULL at first), and how many ticks it ran since it was switched to
+    ECSimTask *GetLoadedTask() const { return pTaskLoaded; }
+    ECSimTime GetLoadedRunTicks() const { return numLoadedRunTicks; }
+    
+    // Save what a rollback to the current tick needs: clock, counters, the state of the tasks that are not finished
+    // (finished tasks never change again) and what the policy keeps of them. Restoring puts the scheduler and these
+    // tasks back; tasks added since are dropped. Statistics already published and the schedule log are not rolled back
+    void SaveCheckpoint(ECSimSchedulerCheckpoint &checkpoint) const;
+    void RestoreCheckpoint(const ECSimSchedulerCheckpoint &checkpoint);
+    
+    // Bytes taken by each class of tasks (those the scheduler keeps, and those added by pointer that are not finished),
+    // by the scheduler itself and by the task ids, for capacity planning
+    ECSimMemoryReport MemoryReport() const;
+    
+#ifdef ECSIM_PERF_COUNTERS
+    // Counters of each phase of the ticks simulated so far (by Simulate or Step); the program prints them (PrintSummary)
+    // once its run is over, adding up those of all its schedulers
+    const ECSimPerfCounters &GetPerfCounters() const { return perf; }
+    ECSimPerfCounters &GetPerfCounters() { return perf; }
+#endif
+    
 protected:
     // Choose from a list of tasks that are ready to run
     virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const = 0;
-    void SetTime(int t) { timeCurr = t; }
+    
+    // For policies that keep state of their own for each task (CFS, MLFQ): a task left the scheduler (finished or
+    // removed), so its state can go; and save / restore that state with a checkpoint, for the tasks in its lists
+    virtual void TaskRemoved(ECSimTask * /*pTask*/) {}
+    virtual void SavePolicyState(ECSimSchedulerCheckpoint & /*checkpoint*/) const {}
+    virtual void RestorePolicyState(const ECSimSchedulerCheckpoint & /*checkpoint*/) {}
+    
+    void SetTime(ECSimTime t) { timeCurr = t; }
     void SetTask(ECSimTask *pt) { pTaskCurr = pt; }
     
 private:
     // impelementation
+    void PublishStats(int numReady);
+    void ActivateTasks(ECSimTime tick);
+    // a task left the scheduler (retired or removed): it is no longer the loaded one, and the policy forgets it
+    void ForgetTask(ECSimTask *pTask);
+    // an idle stretch from the next tick on: up to maxTicks ticks before the next event (active tasks and wheel)
+    ECSimTime SkipIdle(ECSimTime maxTicks);
     
     // Order tasks by the order of receiving the schedule request
     std::vector<ECSimTask *> listTasks;
     
+    // Tasks the scheduler keeps, in blocks that are never reallocated so the tasks don't move
+    std::vector<std::vector<Task> > listOwnedTasks;
+    
     // Current time
-    int timeCurr;
+    ECSimTime timeCurr;
     
     // Currently scheduled task
     ECSimTask *pTaskCurr;
+    
+    // Number of ready tasks at the current tick
+    int numReady;
+    
+    // Aggregate wait/run time over all tasks
+    long long tmTotWait;
+    long long tmTotRun;
+    
+    // Statistics for observers
+    int statsInterval;
+    int statsCountdown;
+    ECSimStatsPublisher<ECSimTask> stats;
+    
+    // Tasks waiting for their start time (NULL if not used), and the order in which tasks were added
+    ECSimTimingWheel<ECSimTask *> *pWheel;
+    std::unordered_map<ECSimTask *, long long> mapTaskOrder;
+    long long numTasksAdded;
+    
+    // Schedule log (NULL if not used), and the per-tick trace
+    ECSimScheduleLogWriter *pLog;
+    bool fTrace;
+    
+    // Context switch cost model
+    int switchCost;
+    ECSimTask *pTaskLoaded;
+    ECSimTime numLoadedRunTicks;
+    int numSwitchTicksLeft;
+    long long numSwitches;
+    long long numSwitchTicks;
+    
+#ifdef ECSIM_PERF_COUNTERS
+    // Hot-path instrumentation
+    ECSimPerfCounters perf;
+#endif
 };
 
 //***********************************************************
@@ -63,10 +266,46 @@ class ECSimFIFOTaskScheduler : public ECSimTaskScheduler
 {
 public:
     ECSimFIFOTaskScheduler();
+    virtual bool IsReadinessOnly() const { return true; }
+    virtual bool IsStateless() const { return true; }
     
 protected:
     // Choose from a list of tasks that are ready to run
     virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
 };
 
+//***********************************************************
+// Longest wait-time first scheduler: choose the task that has waited the longest so far; break ties by the order of requests receiving
+class ECSimLWTFTaskScheduler : public ECSimTaskScheduler
+{
+public:
+    ECSimLWTFTaskScheduler();
+    virtual bool IsStateless() const { return true; }
+    
+protected:
+    virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+};
+
+//***********************************************************
+// Round-robin scheduler: the task having run the fewest in the past, get the highest priority
+class ECSimRoundRobinTaskScheduler : public ECSimTaskScheduler
+{
+public:
+    ECSimRoundRobinTaskScheduler();
+    virtual bool IsStateless() const { return true; }
+    
+protected:
+    virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+};
+
+} // namespace ecsim
+
+using ecsim::ECSimSchedulerCheckpoint;
+using ecsim::ECSimMemoryUsage;
+using ecsim::ECSimMemoryReport;
+using ecsim::ECSimTaskScheduler;
+using ecsim::ECSimFIFOTaskScheduler;
+using ecsim::ECSimLWTFTaskScheduler;
+using ecsim::ECSimRoundRobinTaskScheduler;
+
 #endif /* ECSimTaskScheduler_h */
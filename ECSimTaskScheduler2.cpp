@@ -5,20 +5,39 @@
 //
 
 #include <vector>
+#include <algorithm>
 #include <iostream>
+#include <unordered_set>
 using namespace std;
 
 #include "ECSimTaskScheduler2.h"
-#include "ECSimTask.h"
+#include "ECSimTaskBase.h"
+
+namespace ecsim
+{
+
+// Tasks of a checkpoint (active and in the timing wheel): a policy keeps state for these only
+static unordered_set<const ECSimTask *> GetCheckpointTasks(const ECSimSchedulerCheckpoint &checkpoint)
+{
+    unordered_set<const ECSimTask *> setTasks(checkpoint.listTasks.begin(), checkpoint.listTasks.end());
+    for (const auto &item : checkpoint.listWheel)
+    {
+        setTasks.insert(item.second);
+    }
+    return setTasks;
+}
+
+// Entities of tasks that left are compacted away once they are this many, and half of all
+static const int minDeadCompact = 64;
 
 //***********************************************************
-// get by task wait time
-ECSimLWTFTaskScheduler ::ECSimLWTFTaskScheduler()
+// get by task priority
+ECSimPriorityScheduler ::ECSimPriorityScheduler()
 {
 }
 
 // Choose from a list of tasks that are ready to run
-ECSimTask *ECSimLWTFTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+ECSimTask *ECSimPriorityScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
 {
 
     // loop through list
@@ -29,7 +48,7 @@ ECSimTask *ECSimLWTFTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSim
 
         for (auto task : listReadyTasks)
         {
-            if (task->GetTotWaitTime() > Next->GetTotWaitTime())
+            if (task->GetPriority() < Next->GetPriority())
             {
 
                 Next = task;
@@ -45,68 +64,589 @@ ECSimTask *ECSimLWTFTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSim
 }
 
 //***********************************************************
-// get by task priority
-ECSimPriorityScheduler ::ECSimPriorityScheduler()
+// keep the loaded task for a minimum quantum
+
+ECSimMinQuantumScheduler ::ECSimMinQuantumScheduler(const ECSimTaskScheduler *pPolicyIn, int quantumIn) : pPolicy(pPolicyIn), quantum(quantumIn)
 {
 }
 
-// Choose from a list of tasks that are ready to run
-ECSimTask *ECSimPriorityScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+// choose from list
+ECSimTask *ECSimMinQuantumScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
 {
+    ECSimTask *pLoaded = GetLoadedTask();
+    if (pLoaded != NULL && GetLoadedRunTicks() < quantum && std::find(listReadyTasks.begin(), listReadyTasks.end(), pLoaded) != listReadyTasks.end())
+    {
+        return pLoaded;
+    }
+    return pPolicy->ChooseTask(listReadyTasks);
+}
 
-    // loop through list
-    if (listReadyTasks.size() > 0)
+//***********************************************************
+// least run, but only switch for a clear difference
+
+ECSimHysteresisRoundRobinScheduler ::ECSimHysteresisRoundRobinScheduler(int marginIn) : margin(marginIn)
+{
+}
+
+// choose from list
+ECSimTask *ECSimHysteresisRoundRobinScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+{
+    ECSimTask *pLoaded = GetLoadedTask();
+    ECSimTask *Next = NULL;
+    bool fLoadedReady = false;
+    for (auto task : listReadyTasks)
+    {
+        if (Next == NULL || task->GetTotRunTime64() < Next->GetTotRunTime64())
+        {
+            Next = task;
+        }
+        fLoadedReady = fLoadedReady || task == pLoaded;
+    }
+    if (fLoadedReady && pLoaded->GetTotRunTime64() - Next->GetTotRunTime64() <= margin)
     {
+        return pLoaded;
+    }
+    return Next;
+}
 
-        ECSimTask *Next = listReadyTasks[0];
+//***********************************************************
+// completely fair scheduler
 
-        for (auto task : listReadyTasks)
+// nice -20..19 to weight, from the Linux kernel: each nice level is about 1.25 times the next
+static const int listNiceWeights[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906,
+    3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423,
+    335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45,
+    36, 29, 23, 18, 15};
+
+ECSimCFSScheduler ::ECSimCFSScheduler() : sleeperCredit(3 * NICE_0_WEIGHT), vruntimeMin(0), numPicks(0), indexLast(-1), numDead(0)
+{
+}
+
+int ECSimCFSScheduler ::GetWeight(int nice)
+{
+    return listNiceWeights[std::min(19, std::max(-20, nice)) + 20];
+}
+
+long long ECSimCFSScheduler ::GetVirtualRuntime(const ECSimTask *pTask) const
+{
+    auto it = mapEntities.find(pTask);
+    return it != mapEntities.end() ? listEntities[it->second].vruntime : vruntimeMin;
+}
+
+void ECSimCFSScheduler ::Enqueue(int index) const
+{
+    treeReady.insert(std::make_pair(listEntities[index].vruntime, index));
+    listEntities[index].fQueued = true;
+}
+
+void ECSimCFSScheduler ::Dequeue(int index) const
+{
+    treeReady.erase(std::make_pair(listEntities[index].vruntime, index));
+    listEntities[index].fQueued = false;
+}
+
+void ECSimCFSScheduler ::ChargeLast() const
+{
+    if (indexLast < 0)
+    {
+        return;
+    }
+    Entity &ent = listEntities[indexLast];
+    ECSimTime tmRun = ent.pTask->GetTotRunTime64() - ent.tmRunCharged;
+    if (tmRun <= 0)
+    {
+        return;
+    }
+    bool fQueued = ent.fQueued;
+    if (fQueued)
+    {
+        Dequeue(indexLast);
+    }
+    ent.vruntime += (long long)tmRun * NICE_0_WEIGHT * NICE_0_WEIGHT / GetWeight(ent.pTask->GetPriority());
+    ent.tmRunCharged += tmRun;
+    if (fQueued)
+    {
+        Enqueue(indexLast);
+    }
+    // the floor follows the least virtual runtime of the running and the queued tasks, and never goes back
+    long long vruntime = ent.vruntime;
+    if (!treeReady.empty())
+    {
+        vruntime = std::min(vruntime, treeReady.begin()->first);
+    }
+    vruntimeMin = std::max(vruntimeMin, vruntime);
+}
+
+// choose from list
+ECSimTask *ECSimCFSScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+{
+    ChargeLast();
+    ++numPicks;
+    // only tasks that were not ready at the last pick move into the tree
+    for (auto task : listReadyTasks)
+    {
+        auto it = mapEntities.find(task);
+        if (it == mapEntities.end())
         {
-            if (task->GetPriority() < Next->GetPriority())
+            Entity ent;
+            ent.pTask = task;
+            ent.vruntime = vruntimeMin;
+            ent.tmRunCharged = task->GetTotRunTime64();
+            ent.pickReady = numPicks;
+            ent.fQueued = false;
+            mapEntities[task] = (int)listEntities.size();
+            listEntities.push_back(ent);
+            Enqueue((int)listEntities.size() - 1);
+            continue;
+        }
+        Entity &ent = listEntities[it->second];
+        if (ent.pickReady != numPicks - 1)
+        {
+            // waking up: sleeping earns a bounded head start
+            if (ent.fQueued)
             {
-
-                Next = task;
+                Dequeue(it->second);
             }
+            ent.vruntime = std::max(ent.vruntime, vruntimeMin - sleeperCredit);
+            Enqueue(it->second);
         }
-        return Next;
+        ent.pickReady = numPicks;
     }
-
-    else
+    // the leftmost task that is ready; those found not ready have gone to sleep and leave the tree
+    indexLast = -1;
+    while (!treeReady.empty())
+    {
+        int index = treeReady.begin()->second;
+        if (listEntities[index].pickReady == numPicks)
+        {
+            indexLast = index;
+            break;
+        }
+        Dequeue(index);
+    }
+    if (indexLast < 0)
     {
         return NULL;
     }
+    vruntimeMin = std::max(vruntimeMin, listEntities[indexLast].vruntime);
+    return listEntities[indexLast].pTask;
+}
+
+void ECSimCFSScheduler ::TaskRemoved(ECSimTask *pTask)
+{
+    // the charge is due before the tree changes, as it would be at the next pick
+    ChargeLast();
+    auto it = mapEntities.find(pTask);
+    if (it == mapEntities.end())
+    {
+        return;
+    }
+    int index = it->second;
+    mapEntities.erase(it);
+    if (listEntities[index].fQueued)
+    {
+        Dequeue(index);
+    }
+    listEntities[index].pTask = NULL;
+    if (indexLast == index)
+    {
+        indexLast = -1;
+    }
+    if (++numDead >= minDeadCompact && numDead * 2 >= (int)listEntities.size())
+    {
+        Compact();
+    }
+}
+
+void ECSimCFSScheduler ::Compact()
+{
+    vector<int> listIndexNew(listEntities.size(), -1);
+    vector<Entity> listLive;
+    for (size_t i = 0; i < listEntities.size(); ++i)
+    {
+        if (listEntities[i].pTask != NULL)
+        {
+            listIndexNew[i] = (int)listLive.size();
+            listLive.push_back(listEntities[i]);
+        }
+    }
+    // the order of first sight is kept, so is that of the tree
+    std::set<std::pair<long long, int> > treeNew;
+    for (const auto &item : treeReady)
+    {
+        treeNew.insert(treeNew.end(), std::make_pair(item.first, listIndexNew[item.second]));
+    }
+    for (auto &item : mapEntities)
+    {
+        item.second = listIndexNew[item.second];
+    }
+    indexLast = indexLast >= 0 ? listIndexNew[indexLast] : -1;
+    listEntities.swap(listLive);
+    treeReady.swap(treeNew);
+    numDead = 0;
+}
+
+// State: floor, picks, last task picked (position in listPolicyTasks, -1 if none), then the entity of each task
+void ECSimCFSScheduler ::SavePolicyState(ECSimSchedulerCheckpoint &checkpoint) const
+{
+    unordered_set<const ECSimTask *> setTasks = GetCheckpointTasks(checkpoint);
+    vector<long long> &listState = checkpoint.listPolicyState;
+    listState.push_back(vruntimeMin);
+    listState.push_back(numPicks);
+    listState.push_back(-1);
+    for (size_t i = 0; i < listEntities.size(); ++i)
+    {
+        const Entity &ent = listEntities[i];
+        if (ent.pTask == NULL || setTasks.count(ent.pTask) == 0)
+        {
+            continue;
+        }
+        if ((int)i == indexLast)
+        {
+            listState[2] = (long long)checkpoint.listPolicyTasks.size();
+        }
+        checkpoint.listPolicyTasks.push_back(ent.pTask);
+        listState.push_back(ent.vruntime);
+        listState.push_back(ent.tmRunCharged);
+        listState.push_back(ent.pickReady);
+        listState.push_back(ent.fQueued ? 1 : 0);
+    }
+}
+
+void ECSimCFSScheduler ::RestorePolicyState(const ECSimSchedulerCheckpoint &checkpoint)
+{
+    listEntities.clear();
+    mapEntities.clear();
+    treeReady.clear();
+    numDead = 0;
+    indexLast = -1;
+    const vector<long long> &listState = checkpoint.listPolicyState;
+    if (listState.empty())
+    {
+        // nothing saved: start over
+        vruntimeMin = 0;
+        numPicks = 0;
+        return;
+    }
+    unordered_set<const ECSimTask *> setTasks = GetCheckpointTasks(checkpoint);
+    vruntimeMin = listState[0];
+    numPicks = listState[1];
+    for (size_t k = 0; k < checkpoint.listPolicyTasks.size(); ++k)
+    {
+        ECSimTask *pTask = checkpoint.listPolicyTasks[k];
+        if (setTasks.count(pTask) == 0)
+        {
+            continue;
+        }
+        const long long *pState = &listState[3 + 4 * k];
+        Entity ent;
+        ent.pTask = pTask;
+        ent.vruntime = pState[0];
+        ent.tmRunCharged = pState[1];
+        ent.pickReady = pState[2];
+        ent.fQueued = false;
+        int index = (int)listEntities.size();
+        if ((long long)k == listState[2])
+        {
+            indexLast = index;
+        }
+        mapEntities[pTask] = index;
+        listEntities.push_back(ent);
+        if (pState[3] != 0)
+        {
+            Enqueue(index);
+        }
+    }
 }
 
 //***********************************************************
-// get by least run?
+// multi-level feedback queue
 
-ECSimRoundRobinTaskScheduler ::ECSimRoundRobinTaskScheduler()
+ECSimMLFQScheduler ::ECSimMLFQScheduler(int numLevelsIn, int quantumTopIn) : numLevels(std::min(64, std::max(1, numLevelsIn))), quantumTop(std::max(1, quantumTopIn)), agingWait(0), bitmapLevels(0), numPicks(0), indexLast(-1), numDead(0)
 {
+    listQueues.resize(numLevels);
 }
 
-// choose from list
-ECSimTask *ECSimRoundRobinTaskScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+int ECSimMLFQScheduler ::GetLevel(const ECSimTask *pTask) const
 {
+    auto it = mapEntities.find(pTask);
+    return it != mapEntities.end() ? listEntities[it->second].level : -1;
+}
 
-    // loop through list
-    if (listReadyTasks.size() > 0)
+void ECSimMLFQScheduler ::Enqueue(int index) const
+{
+    Entity &ent = listEntities[index];
+    // an entry left in another queue (or further up this one) is now stale
+    ++ent.gen;
+    ent.fQueued = true;
+    listQueues[ent.level].push_back(std::make_pair(index, ent.gen));
+    bitmapLevels |= (uint64_t)1 << ent.level;
+}
+
+void ECSimMLFQScheduler ::ChargeLast() const
+{
+    if (indexLast < 0)
     {
+        return;
+    }
+    Entity &ent = listEntities[indexLast];
+    ECSimTime tmRun = ent.pTask->GetTotRunTime64() - ent.tmRunCharged;
+    if (tmRun <= 0)
+    {
+        return;
+    }
+    ent.tmRunCharged += tmRun;
+    ent.tmUsed += tmRun;
+    ent.tmWaitMark = ent.pTask->GetTotWaitTime64();
+    if (ent.tmUsed >= GetQuantum(ent.level))
+    {
+        ent.level = std::min(ent.level + 1, numLevels - 1);
+        ent.tmUsed = 0;
+        Enqueue(indexLast);
+    }
+}
 
-        ECSimTask *Next = listReadyTasks[0];
+// choose from list
+ECSimTask *ECSimMLFQScheduler ::ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const
+{
+    ChargeLast();
+    ++numPicks;
+    for (auto task : listReadyTasks)
+    {
+        auto it = mapEntities.find(task);
+        int index;
+        if (it == mapEntities.end())
+        {
+            Entity ent;
+            ent.pTask = task;
+            ent.level = std::min(numLevels - 1, std::max(0, task->GetPriority()));
+            ent.tmRunCharged = task->GetTotRunTime64();
+            ent.tmUsed = 0;
+            ent.tmWaitMark = task->GetTotWaitTime64();
+            ent.gen = 0;
+            ent.fQueued = false;
+            index = (int)listEntities.size();
+            mapEntities[task] = index;
+            listEntities.push_back(ent);
+            Enqueue(index);
+        }
+        else
+        {
+            index = it->second;
+            if (!listEntities[index].fQueued || listEntities[index].pickReady != numPicks - 1)
+            {
+                // ready again: to the back of its level
+                Enqueue(index);
+            }
+        }
+        Entity &ent = listEntities[index];
+        ent.pickReady = numPicks;
+        if (agingWait > 0 && ent.level > 0 && task->GetTotWaitTime64() - ent.tmWaitMark >= agingWait)
+        {
+            --ent.level;
+            ent.tmUsed = 0;
+            ent.tmWaitMark = task->GetTotWaitTime64();
+            Enqueue(index);
+        }
+    }
+    // front of the first non-empty level; stale entries and tasks no longer ready are dropped on the way
+    indexLast = -1;
+    while (bitmapLevels != 0 && indexLast < 0)
+    {
+        int level = __builtin_ctzll(bitmapLevels);
+        std::deque<std::pair<int, unsigned> > &queue = listQueues[level];
+        while (!queue.empty())
+        {
+            Entity &ent = listEntities[queue.front().first];
+            if (ent.gen == queue.front().second)
+            {
+                if (ent.pickReady == numPicks)
+                {
+                    indexLast = queue.front().first;
+                    break;
+                }
+                ent.fQueued = false;
+            }
+            queue.pop_front();
+        }
+        if (queue.empty())
+        {
+            bitmapLevels &= ~((uint64_t)1 << level);
+        }
+    }
+    return indexLast >= 0 ? listEntities[indexLast].pTask : NULL;
+}
 
-        for (auto task : listReadyTasks)
+void ECSimMLFQScheduler ::TaskRemoved(ECSimTask *pTask)
+{
+    ChargeLast();
+    auto it = mapEntities.find(pTask);
+    if (it == mapEntities.end())
+    {
+        return;
+    }
+    int index = it->second;
+    mapEntities.erase(it);
+    // its queue entry goes stale
+    Entity &ent = listEntities[index];
+    ++ent.gen;
+    ent.fQueued = false;
+    ent.pTask = NULL;
+    if (indexLast == index)
+    {
+        indexLast = -1;
+    }
+    if (++numDead >= minDeadCompact && numDead * 2 >= (int)listEntities.size())
+    {
+        Compact();
+    }
+}
+
+void ECSimMLFQScheduler ::Compact()
+{
+    vector<int> listIndexNew(listEntities.size(), -1);
+    vector<Entity> listLive;
+    for (size_t i = 0; i < listEntities.size(); ++i)
+    {
+        if (listEntities[i].pTask != NULL)
         {
+            listIndexNew[i] = (int)listLive.size();
+            listLive.push_back(listEntities[i]);
+        }
+    }
+    // only the current entries are kept, in their order
+    for (int level = 0; level < numLevels; ++level)
+    {
+        std::deque<std::pair<int, unsigned> > queueNew;
+        for (const auto &item : listQueues[level])
+        {
+            const Entity &ent = listEntities[item.first];
+            if (ent.pTask != NULL && ent.gen == item.second)
+            {
+                queueNew.push_back(std::make_pair(listIndexNew[item.first], item.second));
+            }
+        }
+        listQueues[level].swap(queueNew);
+        if (listQueues[level].empty())
+        {
+            bitmapLevels &= ~((uint64_t)1 << level);
+        }
+    }
+    for (auto &item : mapEntities)
+    {
+        item.second = listIndexNew[item.second];
+    }
+    indexLast = indexLast >= 0 ? listIndexNew[indexLast] : -1;
+    listEntities.swap(listLive);
+    numDead = 0;
+}
 
-            if (task->GetTotRunTime() < Next->GetTotRunTime())
+// State: picks, last task picked (position in listPolicyTasks, -1 if none), the entity of each task, then for each
+// level the number of current queue entries and their positions in listPolicyTasks
+void ECSimMLFQScheduler ::SavePolicyState(ECSimSchedulerCheckpoint &checkpoint) const
+{
+    unordered_set<const ECSimTask *> setTasks = GetCheckpointTasks(checkpoint);
+    vector<long long> &listState = checkpoint.listPolicyState;
+    listState.push_back(numPicks);
+    listState.push_back(-1);
+    vector<long long> listPos(listEntities.size(), -1);
+    for (size_t i = 0; i < listEntities.size(); ++i)
+    {
+        const Entity &ent = listEntities[i];
+        if (ent.pTask == NULL || setTasks.count(ent.pTask) == 0)
+        {
+            continue;
+        }
+        listPos[i] = (long long)checkpoint.listPolicyTasks.size();
+        if ((int)i == indexLast)
+        {
+            listState[1] = listPos[i];
+        }
+        checkpoint.listPolicyTasks.push_back(ent.pTask);
+        listState.push_back(ent.level);
+        listState.push_back(ent.tmRunCharged);
+        listState.push_back(ent.tmUsed);
+        listState.push_back(ent.tmWaitMark);
+        listState.push_back(ent.pickReady);
+        listState.push_back(ent.fQueued ? 1 : 0);
+    }
+    for (int level = 0; level < numLevels; ++level)
+    {
+        size_t posCount = listState.size();
+        listState.push_back(0);
+        for (const auto &item : listQueues[level])
+        {
+            if (listPos[item.first] >= 0 && listEntities[item.first].gen == item.second)
             {
-                Next = task;
+                listState.push_back(listPos[item.first]);
+                ++listState[posCount];
             }
         }
-        return Next;
     }
+}
 
-    else
+void ECSimMLFQScheduler ::RestorePolicyState(const ECSimSchedulerCheckpoint &checkpoint)
+{
+    listEntities.clear();
+    mapEntities.clear();
+    listQueues.assign(numLevels, std::deque<std::pair<int, unsigned> >());
+    bitmapLevels = 0;
+    numDead = 0;
+    indexLast = -1;
+    const vector<long long> &listState = checkpoint.listPolicyState;
+    if (listState.empty())
     {
-        return nullptr;
+        numPicks = 0;
+        return;
+    }
+    unordered_set<const ECSimTask *> setTasks = GetCheckpointTasks(checkpoint);
+    numPicks = listState[0];
+    size_t numTasks = checkpoint.listPolicyTasks.size();
+    vector<int> listIndex(numTasks, -1);
+    for (size_t k = 0; k < numTasks; ++k)
+    {
+        ECSimTask *pTask = checkpoint.listPolicyTasks[k];
+        if (setTasks.count(pTask) == 0)
+        {
+            continue;
+        }
+        const long long *pState = &listState[2 + 6 * k];
+        Entity ent;
+        ent.pTask = pTask;
+        ent.level = (int)pState[0];
+        ent.tmRunCharged = pState[1];
+        ent.tmUsed = pState[2];
+        ent.tmWaitMark = pState[3];
+        ent.pickReady = pState[4];
+        ent.gen = 0;
+        ent.fQueued = pState[5] != 0;
+        listIndex[k] = (int)listEntities.size();
+        mapEntities[pTask] = listIndex[k];
+        listEntities.push_back(ent);
+    }
+    if (listState[1] >= 0)
+    {
+        indexLast = listIndex[listState[1]];
+    }
+    size_t pos = 2 + 6 * numTasks;
+    for (int level = 0; level < numLevels; ++level)
+    {
+        long long num = listState[pos++];
+        for (long long i = 0; i < num; ++i)
+        {
+            int index = listIndex[listState[pos++]];
+            if (index >= 0)
+            {
+                listQueues[level].push_back(std::make_pair(index, 0u));
+                bitmapLevels |= (uint64_t)1 << level;
+            }
+        }
     }
 }
+
+} // namespace ecsim
@@ -7,41 +7,197 @@
 #ifndef ECSimTaskScheduler2_h
 #define ECSimTaskScheduler2_h
 
+#include <set>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
 #include "ECSimTaskScheduler.h"
 
-// Now define your new schedulers here...
+namespace ecsim
+{
+
+// Now define your new schedulers here (LWTF and round robin are in ECSimTaskScheduler.h)...
 
 //***********************************************************
-// Longest wait-time first scheduler: choose the task that has waited the longest so far; break ties by the order of requests receiving
-class ECSimLWTFTaskScheduler : public ECSimTaskScheduler
+// Priority-based scheduler. By default, each task has the same priority 0; this priorty can be set (the smaller the higher priority, as in Unix/Linux).
+class ECSimPriorityScheduler : public ECSimTaskScheduler
 {
 public:
-    ECSimLWTFTaskScheduler();
+    ECSimPriorityScheduler();
+    virtual bool IsReadinessOnly() const { return true; }
+    virtual bool IsStateless() const { return true; }
 
 protected:
     virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
 };
 
 //***********************************************************
-// Priority-based scheduler. By default, each task has the same priority 0; this priorty can be set (the smaller the higher priority, as in Unix/Linux).
-class ECSimPriorityScheduler : public ECSimTaskScheduler
+// Minimum quantum: once switched to, a task keeps running while it is ready for at least quantum ticks;
+// then the policy of another scheduler (only its ChooseTask is used) picks the next task.
+// With a switch cost, this trades latency for fewer switches
+class ECSimMinQuantumScheduler : public ECSimTaskScheduler
 {
 public:
-    ECSimPriorityScheduler();
+    ECSimMinQuantumScheduler(const ECSimTaskScheduler *pPolicy, int quantum);
+
+protected:
+    virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+
+private:
+    const ECSimTaskScheduler *pPolicy;
+    int quantum;
+};
+
+//***********************************************************
+// Round-robin with hysteresis: the loaded task keeps running while it is ready, unless another ready task
+// has run more than margin ticks less (margin 0: plain round-robin, but ties go to the loaded task)
+class ECSimHysteresisRoundRobinScheduler : public ECSimTaskScheduler
+{
+public:
+    ECSimHysteresisRoundRobinScheduler(int margin);
+
+protected:
+    virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+
+private:
+    int margin;
+};
+
+//***********************************************************
+// Completely fair scheduler, as in Linux: each task accumulates virtual runtime, its run time scaled down by the
+// weight of its nice value (the priority, -20..19, 0 by default; each step is about 10% of CPU share), and the
+// ready task with the least virtual runtime runs. Ready tasks are kept in a balanced tree by virtual runtime:
+// only the tasks that start or stop being ready, or that ran, are moved, and the next one is picked in O(log n).
+// A task first seen starts at the minimum virtual runtime; a task that wakes up (ready again after not being
+// ready) starts no lower than the minimum less the sleeper credit, so sleeping earns at most that much.
+// What it keeps of a task goes into checkpoints, and is dropped when the task leaves the scheduler
+class ECSimCFSScheduler : public ECSimTaskScheduler
+{
+public:
+    ECSimCFSScheduler();
+
+    // Largest head start of a waking task, in ticks at nice 0 (default 3)
+    void SetSleeperCredit(int ticks) { sleeperCredit = (long long)ticks * NICE_0_WEIGHT; }
+
+    // Virtual runtime of a task (in 1/1024 ticks at nice 0), and the floor that new and waking tasks start from
+    long long GetVirtualRuntime(const ECSimTask *pTask) const;
+    long long GetMinVirtualRuntime() const { return vruntimeMin; }
+
+    // CPU weight of a nice value (1024 at 0)
+    static int GetWeight(int nice);
 
 protected:
     virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+    virtual void TaskRemoved(ECSimTask *pTask);
+    virtual void SavePolicyState(ECSimSchedulerCheckpoint &checkpoint) const;
+    virtual void RestorePolicyState(const ECSimSchedulerCheckpoint &checkpoint);
+
+private:
+    enum
+    {
+        NICE_0_WEIGHT = 1024
+    };
+
+    struct Entity
+    {
+        // NULL once the task left the scheduler
+        ECSimTask *pTask;
+        long long vruntime;
+        // run time already charged
+        ECSimTime tmRunCharged;
+        // last pick at which the task was ready, and whether it is in the tree
+        long long pickReady;
+        bool fQueued;
+    };
+
+    // charge the task picked last for what it ran since
+    void ChargeLast() const;
+    void Enqueue(int index) const;
+    void Dequeue(int index) const;
+    // drop the entities of the tasks that left, keeping the others in the order they were first seen
+    void Compact();
+
+    long long sleeperCredit;
+    mutable std::vector<Entity> listEntities;
+    mutable std::unordered_map<const ECSimTask *, int> mapEntities;
+    // (vruntime, first seen) of the queued entities
+    mutable std::set<std::pair<long long, int> > treeReady;
+    mutable long long vruntimeMin;
+    mutable long long numPicks;
+    mutable int indexLast;
+    int numDead;
 };
 
 //***********************************************************
-// Round-robin scheduler: the task having run the fewest in the past, get the highest priority
-class ECSimRoundRobinTaskScheduler : public ECSimTaskScheduler
+// Multi-level feedback queue: one FIFO queue of ready tasks per level, level 0 first; a bitmap of the non-empty
+// levels finds the next task in O(1). A task starts at the level of its priority and drops a level each time it
+// uses up the quantum of its level (which doubles per level); on the last level tasks take turns. A ready task
+// that has waited agingWait ticks (by GetTotWaitTime) since it last ran or moved is boosted a level up,
+// so a steady stream of short tasks can't starve the others. Like CFS, its state goes into checkpoints and is dropped
+// when a task leaves
+class ECSimMLFQScheduler : public ECSimTaskScheduler
 {
 public:
-    ECSimRoundRobinTaskScheduler();
+    // numLevels: 1..64; quantumTop: quantum of level 0
+    ECSimMLFQScheduler(int numLevels = 8, int quantumTop = 1);
+
+    // Waiting time that boosts a task one level (0: no aging)
+    void SetAgingWait(int ticks) { agingWait = ticks; }
+
+    // Level of a task (-1 if not seen yet), and the quantum of a level
+    int GetLevel(const ECSimTask *pTask) const;
+    int GetQuantum(int level) const { return quantumTop << std::min(level, 20); }
 
 protected:
     virtual ECSimTask *ChooseTaskToSchedule(const std::vector<ECSimTask *> &listReadyTasks) const;
+    virtual void TaskRemoved(ECSimTask *pTask);
+    virtual void SavePolicyState(ECSimSchedulerCheckpoint &checkpoint) const;
+    virtual void RestorePolicyState(const ECSimSchedulerCheckpoint &checkpoint);
+
+private:
+    struct Entity
+    {
+        // NULL once the task left the scheduler
+        ECSimTask *pTask;
+        int level;
+        // run time already charged, and used of the current quantum
+        ECSimTime tmRunCharged;
+        ECSimTime tmUsed;
+        // wait time when the task last ran or moved
+        ECSimTime tmWaitMark;
+        // last pick at which the task was ready
+        long long pickReady;
+        // a queue entry is current only if it carries the entity's generation
+        unsigned gen;
+        bool fQueued;
+    };
+
+    // charge the task picked last for what it ran since, demoting it when its quantum is used up
+    void ChargeLast() const;
+    // (re)queue at the back of its level
+    void Enqueue(int index) const;
+    // drop the entities of the tasks that left, keeping the others in the order they were first seen
+    void Compact();
+
+    int numLevels;
+    int quantumTop;
+    int agingWait;
+    mutable std::vector<Entity> listEntities;
+    mutable std::unordered_map<const ECSimTask *, int> mapEntities;
+    mutable std::vector<std::deque<std::pair<int, unsigned> > > listQueues;
+    mutable uint64_t bitmapLevels;
+    mutable long long numPicks;
+    mutable int indexLast;
+    int numDead;
 };
 
+} // namespace ecsim
+
+using ecsim::ECSimPriorityScheduler;
+using ecsim::ECSimMinQuantumScheduler;
+using ecsim::ECSimHysteresisRoundRobinScheduler;
+using ecsim::ECSimCFSScheduler;
+using ecsim::ECSimMLFQScheduler;
+
 #endif /* ECSimTaskScheduler2_h */
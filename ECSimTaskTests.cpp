@@ -1,11 +1,22 @@
 // Test task simulations
-// Build: c++ -std=c++11 ECSimTask.cpp ECSimTask2.cpp ECSimTaskScheduler.cpp ECSimTaskScheduler2.cpp ECSimTaskTests.cpp -o test
+// Build: cmake -S . -B build && cmake --build build --target ecsim_tests (see CMakeLists.txt); run: ctest --test-dir build
 
 #include "ECSimTask.h"
 #include "ECSimTask2.h"
 #include "ECSimTaskScheduler.h"
 #include "ECSimTaskScheduler2.h"
+#include "ECSimWorkload.h"
+#include "ECSimWorkloadTasks.h"
+#include "ECSimScheduleStream.h"
+#include "ECSimSchedulability.h"
+#include "ECSimStaticSchedule.h"
 #include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cstdlib>
+#include <new>
 using namespace std;
 
 template <class T>
@@ -234,10 +245,495 @@ static void Test7()
     ASSERT_EQ(t3.GetTotWaitTime(), 3);
 }
 
+// Statistics snapshot polled by a monitoring thread while the simulation runs
+static void Test8()
+{
+    cout << "****Test8\n";
+    ECSoftIntervalTask t1("t1", 3, 2000);
+    ECSoftIntervalTask t2("t2", 5, 3000);
+    ECSimRoundRobinTaskScheduler scheduler;
+    scheduler.SetStatsInterval(16);
+    scheduler.AddTask(&t1);
+    scheduler.AddTask(&t2);
+    std::atomic<bool> fDone(false);
+    bool fConsistent = true;
+    std::thread monitor([&]()
+                        {
+        ECSimTime tickLast = 0;
+        while (!fDone.load())
+        {
+            ECSimStats<ECSimTask> st = scheduler.GetStats();
+            // totals can never exceed what the elapsed ticks allow
+            if (st.tick < tickLast || st.tmTotRun > st.tick || st.tmTotWait > st.tick)
+            {
+                fConsistent = false;
+            }
+            tickLast = st.tick;
+        } });
+    int tmSimRun = scheduler.Simulate(-1);
+    fDone = true;
+    monitor.join();
+    ASSERT_EQ(fConsistent, true);
+    ECSimStats<ECSimTask> st = scheduler.GetStats();
+    ASSERT_EQ(st.tick, (ECSimTime)tmSimRun);
+    ASSERT_EQ(st.tmTotRun, (long long)(t1.GetTotRunTime() + t2.GetTotRunTime()));
+    ASSERT_EQ(st.tmTotWait, (long long)(t1.GetTotWaitTime() + t2.GetTotWaitTime()));
+}
+
+// Generated workload of every ECSimTask/ECSimTask2 kind with a priority mix: scheduled one task per tick
+static void Test9()
+{
+    cout << "****Test9\n";
+    ECSimWorkloadConfig config;
+    config.SetGeneration(2);
+    config.seed = 7;
+    config.numTasks = 200;
+    config.tmHorizon = 2000;
+    config.arrival = EC_ARRIVAL_DIURNAL;
+    config.diurnalPeriod = 500;
+    config.lenMax = 30;
+    config.priorityMix.clear();
+    config.priorityMix.push_back(make_pair(1, 0.2));
+    config.priorityMix.push_back(make_pair(5, 0.8));
+    ECSimWorkload workload;
+    ECSimWorkloadGenerator(config).Generate(workload);
+    ASSERT_EQ(workload.GetNumTasks(EC_PERIODIC) > 0 && workload.GetNumTasks(EC_MULTI_INTERVALS) > 0, true);
+
+    ECSimWorkloadTasks tasks;
+    ECSimPriorityScheduler scheduler;
+    ASSERT_EQ(tasks.Build(workload, &scheduler), true);
+    ASSERT_EQ((int)tasks.GetTasks().size(), 200);
+    int numHigh = 0;
+    for (auto x : tasks.GetTasks())
+    {
+        numHigh += x->GetPriority() == 1 ? 1 : 0;
+    }
+    ASSERT_EQ(numHigh > 0 && numHigh < 200, true);
+    // periodic tasks never finish: bound the run
+    int tmSimRun = scheduler.Simulate(3000);
+    long long tmTotRun = 0;
+    for (auto x : tasks.GetTasks())
+    {
+        tmTotRun += x->GetTotRunTime();
+    }
+    ASSERT_EQ(tmSimRun, 3000);
+    ASSERT_EQ(tmTotRun <= tmSimRun, true);
+}
+
+// Schedule stream over a priority scheduler: the same decisions as Simulate, pulled one at a time
+static void Test10()
+{
+    cout << "****Test10\n";
+    ECSoftIntervalTask t1("t1", 1, 4);
+    ECSoftIntervalTask t2("t2", 2, 3);
+    t1.SetPriority(2);
+    t2.SetPriority(1);
+    ECSimPriorityScheduler scheduler;
+    scheduler.AddTask(&t1);
+    scheduler.AddTask(&t2);
+    ECSimScheduleStream<ECSimTaskScheduler, ECSimTask> stream(scheduler);
+    string trace;
+    for (const auto &d : stream)
+    {
+        trace += to_string(d.tick) + ":" + d.pTask->GetId() + "/" + to_string(d.numReady) + " ";
+    }
+    ASSERT_EQ(trace, string("1:t1/1 2:t2/2 3:t2/2 4:t1/1 "));
+    ASSERT_EQ(t1.GetTotWaitTime(), 2);
+}
+
+// Context switch cost: round-robin thrashes between two tasks and pays for every switch;
+// a minimum quantum or hysteresis switches less and gets more work done in the same time
+static void Test11()
+{
+    cout << "****Test11\n";
+    ECSimRoundRobinTaskScheduler policy;
+    for (int run = 0; run < 4; ++run)
+    {
+        ECSoftIntervalTask t1("t1", 1, 12);
+        ECSoftIntervalTask t2("t2", 1, 12);
+        ECSimRoundRobinTaskScheduler schedulerRR;
+        ECSimMinQuantumScheduler schedulerQuantum(&policy, 4);
+        ECSimHysteresisRoundRobinScheduler schedulerHysteresis(2);
+        ECSimTaskScheduler *pScheduler = run < 2 ? (ECSimTaskScheduler *)&schedulerRR : run == 2 ? (ECSimTaskScheduler *)&schedulerQuantum : (ECSimTaskScheduler *)&schedulerHysteresis;
+        pScheduler->SetSwitchCost(run == 0 ? 0 : 1);
+        pScheduler->AddTask(&t1);
+        pScheduler->AddTask(&t2);
+        ASSERT_EQ(pScheduler->Simulate(-1), 12);
+        string res = to_string(pScheduler->GetNumSwitches()) + " " + to_string(pScheduler->GetNumSwitchTicks()) + " " + to_string(t1.GetTotRunTime()) + " " + to_string(t2.GetTotRunTime()) + " " + to_string(t1.GetTotWaitTime() + t2.GetTotWaitTime());
+        const char *listExpected[] = {"12 0 6 6 12", "6 6 3 3 18", "3 3 5 4 15", "3 3 3 6 15"};
+        ASSERT_EQ(res, string(listExpected[run]));
+    }
+
+    // the loaded task is removed and a new one is made at its address: it gets no quantum, and its load is a switch
+    ECSimMinQuantumScheduler scheduler(&policy, 4);
+    alignas(ECSoftIntervalTask) char buf[sizeof(ECSoftIntervalTask)];
+    ECSoftIntervalTask *pTask = new (buf) ECSoftIntervalTask("a", 1, 100);
+    scheduler.AddTask(pTask);
+    scheduler.Simulate(2);
+    ASSERT_EQ(scheduler.GetLoadedTask() == pTask, true);
+    scheduler.RemoveTask(pTask);
+    ASSERT_EQ(scheduler.GetLoadedTask() == NULL, true);
+    ASSERT_EQ(scheduler.GetLoadedRunTicks(), (ECSimTime)0);
+    pTask->~ECSoftIntervalTask();
+    ECSoftIntervalTask *pTask2 = new (buf) ECSoftIntervalTask("b", 1, 100);
+    scheduler.AddTask(pTask2);
+    scheduler.Simulate(3);
+    ASSERT_EQ(scheduler.GetNumSwitches(), 2);
+    ASSERT_EQ(scheduler.GetLoadedRunTicks(), (ECSimTime)3);
+    scheduler.RemoveTask(pTask2);
+    pTask2->~ECSoftIntervalTask();
+}
+
+// CFS: CPU shares follow the nice weights, equal tasks share evenly, and a task waking up after
+// sleeping gets only a bounded head start over the task that kept running
+static void Test12()
+{
+    cout << "****Test12\n";
+    ECSoftIntervalTask t1("t1", 1, 1359);
+    ECSoftIntervalTask t2("t2", 1, 1359);
+    t2.SetPriority(5);
+    ECSimCFSScheduler scheduler;
+    scheduler.AddTask(&t1);
+    scheduler.AddTask(&t2);
+    scheduler.Simulate(-1);
+    // weights 1024 and 335
+    ASSERT_EQ(t1.GetTotRunTime() >= 1023 && t1.GetTotRunTime() <= 1025, true);
+    ASSERT_EQ(t1.GetTotRunTime() + t2.GetTotRunTime(), 1359);
+
+    ECSoftIntervalTask u1("u1", 1, 9);
+    ECSoftIntervalTask u2("u2", 1, 9);
+    ECSoftIntervalTask u3("u3", 1, 9);
+    ECSimCFSScheduler scheduler2;
+    scheduler2.AddTask(&u1);
+    scheduler2.AddTask(&u2);
+    scheduler2.AddTask(&u3);
+    scheduler2.Simulate(-1);
+    ASSERT_EQ(u1.GetTotRunTime() == 3 && u2.GetTotRunTime() == 3 && u3.GetTotRunTime() == 3, true);
+
+    // v2 sleeps over [11, 50] while v1 keeps running; back at 51 it is 40 ticks behind
+    for (int credit = 3; credit <= 100; credit += 97)
+    {
+        ECSoftIntervalTask v1("v1", 1, 100);
+        ECMultiIntervalsTask v2("v2");
+        v2.AddInterval(1, 10);
+        v2.AddInterval(51, 60);
+        ECSimCFSScheduler scheduler3;
+        scheduler3.SetSleeperCredit(credit);
+        scheduler3.AddTask(&v1);
+        scheduler3.AddTask(&v2);
+        ECSimScheduleStream<ECSimTaskScheduler, ECSimTask> stream(scheduler3);
+        string trace;
+        for (const auto &d : stream)
+        {
+            if (d.tick >= 51 && d.tick <= 60)
+            {
+                trace += d.pTask->GetId() == "v2" ? "2" : "1";
+            }
+        }
+        // a small credit: 3 ticks ahead, then sharing; a large one: the whole interval
+        ASSERT_EQ(trace, string(credit == 3 ? "2221212121" : "2222222222"));
+    }
+}
+
+// MLFQ: a task drops a level per used-up quantum and new tasks go first; aging keeps a low task from starving
+// behind a stream of short ones; a level is served in arrival order, even with 100k ready tasks
+static void Test13()
+{
+    cout << "****Test13\n";
+    // t1 drops a level per used-up quantum (2, 4, 8, ...); t2 comes in at level 0 and goes first
+    ECSoftIntervalTask t1("t1", 1, 20);
+    ECSoftIntervalTask t2("t2", 5, 8);
+    ECSimMLFQScheduler scheduler(8, 2);
+    scheduler.AddTask(&t1);
+    scheduler.AddTask(&t2);
+    ECSimScheduleStream<ECSimTaskScheduler, ECSimTask> stream(scheduler);
+    string trace;
+    int levelT1 = -1, levelT2 = -1;
+    for (const auto &d : stream)
+    {
+        if (d.tick <= 10)
+        {
+            trace += d.pTask->GetId() == "t1" ? "1" : "2";
+        }
+        // the last tick of each task: a task is forgotten once it leaves
+        levelT1 = d.tick == 20 ? scheduler.GetLevel(&t1) : levelT1;
+        levelT2 = d.tick == 8 ? scheduler.GetLevel(&t2) : levelT2;
+    }
+    ASSERT_EQ(trace, string("1111221111"));
+    ASSERT_EQ(levelT1, 3);
+    ASSERT_EQ(levelT2, 1);
+    ASSERT_EQ(scheduler.GetLevel(&t1), -1);
+
+    // a stream of short tasks keeps level 0 busy: without aging the low task starves, as with fixed priorities
+    for (int agingWait = -1; agingWait <= 10; agingWait += agingWait < 0 ? 1 : 10)
+    {
+        ECSoftIntervalTask low("low", 1, 100);
+        low.SetPriority(2);
+        vector<ECSoftIntervalTask *> listShort;
+        ECSimMLFQScheduler scheduler2(3, 2);
+        scheduler2.SetAgingWait(agingWait);
+        ECSimPriorityScheduler scheduler3;
+        ECSimTaskScheduler &schedulerUse = agingWait < 0 ? (ECSimTaskScheduler &)scheduler3 : scheduler2;
+        schedulerUse.AddTask(&low);
+        for (int k = 0; k < 50; ++k)
+        {
+            listShort.push_back(new ECSoftIntervalTask("s" + to_string(k), 2 * k + 1, 2 * k + 2));
+            schedulerUse.AddTask(listShort.back());
+        }
+        schedulerUse.Simulate(100);
+        ASSERT_EQ(low.GetTotRunTime() > 0, agingWait > 0);
+        for (auto x : listShort)
+        {
+            delete x;
+        }
+    }
+
+    // 100k ready tasks: level 0 is served in arrival order, each then drops to level 1
+    vector<ECSoftIntervalTask *> listMany;
+    ECSimMLFQScheduler scheduler4;
+    for (int i = 0; i < 100000; ++i)
+    {
+        listMany.push_back(new ECSoftIntervalTask("m" + to_string(i), 1, 100));
+        scheduler4.AddTask(listMany.back());
+    }
+    scheduler4.Simulate(30);
+    bool fInOrder = true;
+    for (int i = 0; i < 100000; ++i)
+    {
+        // the task run last is charged at the next pick
+        fInOrder = fInOrder && listMany[i]->GetTotRunTime() == (i < 30 ? 1 : 0) && scheduler4.GetLevel(listMany[i]) == (i < 29 ? 1 : 0);
+        delete listMany[i];
+    }
+    ASSERT_EQ(fInOrder, true);
+}
+
+static ECSimTimingModel MakeTimingModel(int wcet, int period, int deadline, int priority)
+{
+    ECSimTimingModel model;
+    model.wcet = wcet;
+    model.period = period;
+    model.deadline = deadline;
+    model.priority = priority;
+    return model;
+}
+
+// Schedulability: response times, utilization, density and demand bound tests, admission control of periodic
+// tasks by their windows, and the window test against simulating random sets
+static void Test14()
+{
+    cout << "****Test14\n";
+    // (3, 7), (3, 12), (5, 20): above the rate-monotonic bounds, but every response time fits
+    ECSimSchedulabilityAnalysis analysis;
+    analysis.AddTask(MakeTimingModel(3, 7, 7, 1));
+    analysis.AddTask(MakeTimingModel(3, 12, 12, 2));
+    analysis.AddTask(MakeTimingModel(5, 20, 20, 3));
+    vector<int> listResponse;
+    ASSERT_EQ(analysis.ComputeResponseTimes(listResponse), true);
+    ASSERT_EQ(listResponse[0] == 3 && listResponse[1] == 6 && listResponse[2] == 20, true);
+    ASSERT_EQ(analysis.IsLiuLaylandSchedulable() || analysis.IsHyperbolicSchedulable(), false);
+    ASSERT_EQ(analysis.IsDensitySchedulable() && analysis.IsDemandBoundSchedulable(), true);
+    analysis.AddTask(MakeTimingModel(2, 14, 14, 4));
+    ASSERT_EQ(analysis.IsDemandBoundSchedulable() || analysis.ComputeResponseTimes(listResponse), false);
+
+    // constrained deadlines: the demand test is exact where density is not
+    ECSimSchedulabilityAnalysis analysis2(EC_SCHED_TEST_DEMAND_BOUND);
+    ASSERT_EQ(analysis2.AddTask(MakeTimingModel(2, 4, 3, 0)), true);
+    ASSERT_EQ(analysis2.AddTask(MakeTimingModel(4, 8, 5, 0)), false);
+    ASSERT_EQ(analysis2.AddTask(MakeTimingModel(3, 8, 5, 0)), true);
+    ASSERT_EQ(analysis2.GetNumTasks(), 2);
+    ASSERT_EQ(analysis2.IsDensitySchedulable(), false);
+
+    // periodic tasks need every tick of their windows: p2 meets p1 at 7 and is kept out
+    ECPeriodicTask p1("p1", 1, 2, 4);
+    ECPeriodicTask p2("p2", 3, 1, 3);
+    ECPeriodicTask p3("p3", 3, 3, 3);
+    ECSimFIFOTaskScheduler scheduler;
+    ECSimAdmissionControl<ECSimTaskScheduler, ECSimTask> admission(scheduler, EC_SCHED_TEST_WINDOWS);
+    ASSERT_EQ(admission.AddTask(&p1), true);
+    ASSERT_EQ(admission.AddTask(&p2), false);
+    ASSERT_EQ(admission.AddTask(&p3), true);
+    scheduler.Simulate(60);
+    ASSERT_EQ(p1.GetTotRunTime() == 20 && p3.GetTotRunTime() == 30, true);
+
+    // the window test agrees with simulating random sets over two hyperperiods
+    mt19937 rng(7);
+    int numDisjoint = 0;
+    bool fAgree = true;
+    for (int k = 0; k < 300; ++k)
+    {
+        ECSimSchedulabilityAnalysis analysis3;
+        vector<ECPeriodicTask *> listTasks;
+        ECSimFIFOTaskScheduler scheduler2;
+        int numTasks = 2 + rng() % 2;
+        int hyperperiod = 1;
+        for (int i = 0; i < numTasks; ++i)
+        {
+            int runLen = 1 + rng() % 2;
+            int sleepLen = 1 + rng() % 8;
+            int tmStart = 1 + rng() % 6;
+            listTasks.push_back(new ECPeriodicTask("p" + to_string(i), tmStart, runLen, sleepLen));
+            ECSimTimingModel model;
+            listTasks.back()->GetTimingModel(model);
+            analysis3.AddTask(model);
+            scheduler2.AddTask(listTasks.back());
+            int a = hyperperiod, b = runLen + sleepLen;
+            while (b != 0)
+            {
+                int r = a % b;
+                a = b;
+                b = r;
+            }
+            hyperperiod = hyperperiod / a * (runLen + sleepLen);
+        }
+        int duration = 6 + 2 * hyperperiod;
+        int numReady = 0;
+        for (int tick = 1; tick <= duration; ++tick)
+        {
+            for (auto x : listTasks)
+            {
+                numReady += x->IsReadyToRun(tick) ? 1 : 0;
+            }
+        }
+        scheduler2.Simulate(duration);
+        int tmRun = 0;
+        for (auto x : listTasks)
+        {
+            tmRun += x->GetTotRunTime();
+            delete x;
+        }
+        numDisjoint += analysis3.HasDisjointWindows() ? 1 : 0;
+        fAgree = fAgree && analysis3.HasDisjointWindows() == (tmRun == numReady);
+    }
+    ASSERT_EQ(fAgree && numDisjoint > 0, true);
+
+    // 2000 tasks whose hyperperiod is far beyond any simulation
+    ECSimSchedulabilityAnalysis analysis4;
+    for (int i = 0; i < 2000; ++i)
+    {
+        analysis4.AddTask(MakeTimingModel(1, 5000 + 7 * i, 4000 + 7 * i, i));
+    }
+    ASSERT_EQ(analysis4.IsDemandBoundSchedulable() && analysis4.ComputeResponseTimes(listResponse), true);
+    ASSERT_EQ(listResponse.back(), 2000);
+}
+
+// Compile-time schedules
+static void Test15()
+{
+    cout << "****Test15\n";
+    // Test0 and Test3, worked out by the compiler
+    constexpr std::array<ECSimStaticTask, 2> listTasks0 = {{ECSimStaticTask::SoftInterval(3, 5), ECSimStaticTask::SoftInterval(4, 6)}};
+    constexpr auto schedule0 = ECSimStaticSimulate<ECSimStaticFIFOScheduler, 10>(listTasks0);
+    static_assert(schedule0.numTicks == 6, "Test0: simulate [1, 6]");
+    static_assert(schedule0.listStates[0].tmTotRun == 3 && schedule0.listStates[1].tmTotRun == 1 && schedule0.listStates[1].tmTotWait == 2, "Test0: counters");
+    constexpr std::array<int, 10> table0 = schedule0.GetTable();
+    static_assert(table0[0] == -1 && table0[2] == 0 && table0[4] == 0 && table0[5] == 1 && table0[6] == -1, "Test0: table");
+    constexpr std::array<ECSimStaticTask, 3> listTasks3 = {{ECSimStaticTask::SoftInterval(3, 5), ECSimStaticTask::SoftInterval(7, 7), ECSimStaticTask::ConsecutiveInterval(4, 9)}};
+    constexpr auto schedule3 = ECSimStaticSimulate<ECSimStaticFIFOScheduler, 10>(listTasks3);
+    static_assert(schedule3.numTicks == 7 && schedule3.listStates[2].tmTotRun == 1 && schedule3.listStates[2].tmTotWait == 3, "Test3");
+    // Test1's multi-intervals, and priorities over a periodic task
+    constexpr std::array<ECSimStaticTask, 2> listTasks1 = {{ECSimStaticTask::MultiIntervals().AddInterval(3, 5).AddInterval(8, 9), ECSimStaticTask::MultiIntervals().AddInterval(2, 2).AddInterval(4, 4).AddInterval(7, 8)}};
+    constexpr auto schedule1 = ECSimStaticSimulate<ECSimStaticFIFOScheduler, 10>(listTasks1);
+    static_assert(schedule1.numTicks == 9 && schedule1.listStates[1].tmTotRun == 2 && schedule1.listStates[1].tmTotWait == 2, "Test1");
+    constexpr std::array<ECSimStaticTask, 2> listTasksPri = {{ECSimStaticTask::Periodic(1, 2, 1, 1), ECSimStaticTask::SoftInterval(2, 4, 0)}};
+    constexpr auto schedulePri = ECSimStaticSimulate<ECSimStaticPriorityScheduler, 6>(listTasksPri);
+    static_assert(schedulePri.GetTask(1) == 0 && schedulePri.GetTask(2) == 1 && schedulePri.GetTask(4) == 1 && schedulePri.GetTask(5) == 0 && schedulePri.GetTask(6) == -1, "priority");
+    ASSERT_EQ(table0[3], 0);
+
+    // the same decisions as the runtime schedulers, on random task sets
+    mt19937 rng(15);
+    int numMismatch = 0;
+    for (int iter = 0; iter < 500; ++iter)
+    {
+        std::array<ECSimStaticTask, 4> listStatic;
+        vector<ECSimTask *> listTasks;
+        for (int i = 0; i < 4; ++i)
+        {
+            int kind = (int)(rng() % 5);
+            int a = 1 + (int)(rng() % 20);
+            int b = a + (int)(rng() % 8);
+            int pri = (int)(rng() % 3);
+            ECSimTask *pTask = NULL;
+            if (kind == 0)
+            {
+                listStatic[i] = ECSimStaticTask::SoftInterval(a, b, pri);
+                pTask = new ECSoftIntervalTask("s", a, b);
+            }
+            else if (kind == 1)
+            {
+                listStatic[i] = ECSimStaticTask::HardInterval(a, b, pri);
+                pTask = new ECHardIntervalTask("h", a, b);
+            }
+            else if (kind == 2)
+            {
+                listStatic[i] = ECSimStaticTask::ConsecutiveInterval(a, b, pri);
+                pTask = new ECConsecutiveIntervalTask("c", a, b);
+            }
+            else if (kind == 3)
+            {
+                listStatic[i] = ECSimStaticTask::Periodic(a, 1 + (b - a) % 3, 1 + (int)(rng() % 3), pri);
+                pTask = new ECPeriodicTask("p", a, listStatic[i].runLen, listStatic[i].sleepLen);
+            }
+            else
+            {
+                ECMultiIntervalsTask *pMulti = new ECMultiIntervalsTask("m");
+                listStatic[i] = ECSimStaticTask::MultiIntervals(pri).AddInterval(a, b).AddInterval(b + 2, b + 4);
+                pMulti->AddInterval(a, b);
+                pMulti->AddInterval(b + 2, b + 4);
+                pTask = pMulti;
+            }
+            pTask->SetPriority(pri);
+            listTasks.push_back(pTask);
+        }
+        bool fPriority = iter % 2 == 1;
+        ECSimStaticSchedule<40, 4> schedule = fPriority ? ECSimStaticSimulate<ECSimStaticPriorityScheduler, 40>(listStatic) : ECSimStaticSimulate<ECSimStaticFIFOScheduler, 40>(listStatic);
+        ECSimFIFOTaskScheduler schedulerFIFO;
+        ECSimPriorityScheduler schedulerPri;
+        ECSimTaskScheduler &scheduler = fPriority ? (ECSimTaskScheduler &)schedulerPri : (ECSimTaskScheduler &)schedulerFIFO;
+        for (auto x : listTasks)
+        {
+            scheduler.AddTask(x);
+        }
+        int numTicks = 0;
+        bool fSame = true;
+        while (numTicks < 40 && scheduler.Step() > 0)
+        {
+            ++numTicks;
+            int index = -1;
+            for (int i = 0; i < 4; ++i)
+            {
+                index = listTasks[i] == scheduler.GetCurrTask() ? i : index;
+            }
+            fSame = fSame && index == schedule.GetTask(numTicks);
+        }
+        fSame = fSame && numTicks == schedule.numTicks;
+        for (int i = 0; i < 4; ++i)
+        {
+            fSame = fSame && listTasks[i]->GetTotRunTime() == schedule.listStates[i].tmTotRun && listTasks[i]->GetTotWaitTime() == schedule.listStates[i].tmTotWait;
+            delete listTasks[i];
+        }
+        numMismatch += fSame ? 0 : 1;
+    }
+    ASSERT_EQ(numMismatch, 0);
+}
+
 // Un-comment out test cases when you get the implementaiton
 
-int main()
+int main(int argc, char **argv)
 {
+    // with arguments: only the tests of those numbers (ctest runs them one by one)
+    if (argc > 1)
+    {
+        void (*listTests[])() = {Test0, Test1, Test2, Test3, Test4, Test5, Test6, Test7, Test8, Test9, Test10, Test11, Test12, Test13, Test14, Test15};
+        for (int i = 1; i < argc; ++i)
+        {
+            int num = atoi(argv[i]);
+            if (num >= 0 && num < (int)(sizeof(listTests) / sizeof(listTests[0])))
+            {
+                listTests[num]();
+            }
+        }
+        return 0;
+    }
     // Test0(); // works
     // Test1(); // works
     Test2(); // works
@@ -246,4 +742,12 @@ int main()
     // Test5(); // works
     // Test6(); // works
     // Test7();
+    Test8();
+    Test9();
+    Test10();
+    Test11();
+    Test12();
+    Test13();
+    Test14();
+    Test15();
 }
@@ -0,0 +1,48 @@
+//
+//  ECSimTime.h
+//
+//
+//  Simulation time: 64-bit ticks, so that fine-grained traces (e.g. one tick per microsecond) can run for
+//  centuries of simulated time. Sums of times saturate instead of wrapping, and the int API kept for older
+//  callers (GetTime, GetTotRunTime, Simulate(int), ...) clamps to the int range
+//
+
+#ifndef ECSimTime_h
+#define ECSimTime_h
+
+#include <climits>
+
+namespace ecsim
+{
+
+typedef long long ECSimTime;
+
+const ECSimTime EC_TIME_MAX = LLONG_MAX;
+const ECSimTime EC_TIME_MIN = LLONG_MIN;
+
+// a + b, stuck at EC_TIME_MAX / EC_TIME_MIN instead of overflowing
+inline ECSimTime ECSimTimeAdd(ECSimTime a, ECSimTime b)
+{
+    ECSimTime sum;
+    if (__builtin_add_overflow(a, b, &sum))
+    {
+        return b > 0 ? EC_TIME_MAX : EC_TIME_MIN;
+    }
+    return sum;
+}
+
+// A time (or count of ticks) for the int API: clamped to the int range
+inline int ECSimTimeToInt(ECSimTime t)
+{
+    return t > INT_MAX ? INT_MAX : (t < INT_MIN ? INT_MIN : (int)t);
+}
+
+} // namespace ecsim
+
+using ecsim::ECSimTime;
+using ecsim::EC_TIME_MAX;
+using ecsim::EC_TIME_MIN;
+using ecsim::ECSimTimeAdd;
+using ecsim::ECSimTimeToInt;
+
+#endif /* ECSimTime_h */
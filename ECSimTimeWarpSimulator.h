@@ -0,0 +1,482 @@
+//
+//  ECSimTimeWarpSimulator.h
+//
+//
+//  Optimistic (Time Warp) parallel simulation of several machines, one
+//  scheduler each. Like ECSimPdesNode, machines interact only through task
+//  arrivals sent from a per-tick hook, but the delay may be as small as one
+//  tick: instead of waiting for its inputs, each machine runs ahead on its own
+//  and, when an arrival shows up for a tick it already simulated (a
+//  straggler), rolls back to a checkpoint and re-simulates. Tasks it sent
+//  from the undone ticks are cancelled with anti-messages, which may roll the
+//  receivers back in turn.
+//
+//  State saving is kept cheap: a checkpoint (ECSimSchedulerCheckpoint) holds
+//  only the tasks that are not finished, and is taken every few ticks; a
+//  rollback restores the last checkpoint before the straggler and coasts
+//  forward to it without sending again. Machines run in rounds on a thread
+//  pool, at most a window of ticks past the global virtual time (GVT: no
+//  rollback can reach back to it); between rounds the GVT is computed and
+//  checkpoints, arrivals and sends older than it are released.
+//
+//  A rollback restores a policy's own state only if the checkpoint holds it:
+//  CFS and MLFQ save what they keep of each task through the scheduler's
+//  SavePolicyState / RestorePolicyState. A scheduler with other private
+//  state must override these, or its results after a rollback are wrong.
+//
+
+#ifndef ECSimTimeWarpSimulator_h
+#define ECSimTimeWarpSimulator_h
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include "ECSimWorkload.h"
+#include "ECSimShardedSimulator.h"
+#include "ECSimPerfCounters.h"
+
+//***********************************************************
+// Rollback metrics
+
+struct ECSimTimeWarpStats
+{
+    ECSimTimeWarpStats() : numRounds(0), numTicksSimulated(0), numRollbacks(0), numTicksRolledBack(0), numTasksSent(0), numAntiMessages(0), maxCheckpoints(0) {}
+
+    int numRounds;
+    // ticks simulated by all machines, re-simulated ones included
+    long long numTicksSimulated;
+    int numRollbacks;
+    long long numTicksRolledBack;
+    int numTasksSent;
+    int numAntiMessages;
+    // most checkpoints a machine held at once
+    int maxCheckpoints;
+};
+
+//***********************************************************
+
+template <class TScheduler, class TTask>
+class ECSimTimeWarpSimulator
+{
+public:
+    // createScheduler / createTask make the scheduler of each machine and the tasks that arrive at them (the simulator
+    // owns both). numThreads <= 0: one per core
+    ECSimTimeWarpSimulator(int numMachines, const std::function<TScheduler *()> &createScheduler,
+                           const std::function<TTask *(const ECSimTaskSpec &)> &createTaskIn, int numThreadsIn = 0)
+        : createTask(createTaskIn), numThreads(numThreadsIn), checkpointInterval(8), window(64), duration(0)
+    {
+        if (numThreads <= 0)
+        {
+            numThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+        for (int m = 0; m < numMachines; ++m)
+        {
+            listMachines.push_back(new Machine);
+            listMachines.back()->index = m;
+            listMachines.back()->pScheduler = createScheduler();
+        }
+    }
+
+    ~ECSimTimeWarpSimulator()
+    {
+        for (auto pMachine : listMachines)
+        {
+            delete pMachine->pScheduler;
+            for (auto &entry : pMachine->mapApplied)
+            {
+                delete entry.second.second;
+            }
+            for (size_t i = pMachine->numInitial; i < pMachine->listTasks.size(); ++i)
+            {
+                delete pMachine->listTasks[i];
+            }
+            delete pMachine;
+        }
+    }
+
+    int GetNumMachines() const { return (int)listMachines.size(); }
+
+    // Initial task of a machine (not owned)
+    void AddTask(int machine, TTask *pTask)
+    {
+        Machine &mach = *listMachines[machine];
+        mach.pScheduler->AddTask(pTask);
+        mach.listTasks.push_back(pTask);
+        mach.numInitial = mach.listTasks.size();
+    }
+
+    // Scheduler of a machine (from the tick hook: of the hook's own machine only), and after Simulate all its tasks
+    // (initial ones, then arrived ones in arrival order)
+    TScheduler &GetScheduler(int machine) { return *listMachines[machine]->pScheduler; }
+    const std::vector<TTask *> &GetTasks(int machine) const { return listMachines[machine]->listTasks; }
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of every machine's scheduler to perf, ticks simulated again after rollbacks included
+    // (to print once the run is over)
+    void AddPerfCounters(ECSimPerfCounters &perf) const
+    {
+        for (auto pMachine : listMachines)
+        {
+            perf.Add(pMachine->pScheduler->GetPerfCounters());
+        }
+    }
+#endif
+
+    // Called after a machine simulated a tick, possibly more than once for the same tick after rollbacks, and on
+    // several threads at once (for different machines). It must depend on the machine's own state only; it may call SendTask
+    void SetTickHook(const std::function<void(ECSimTimeWarpSimulator &, int machine, int tick)> &hook) { tickHook = hook; }
+
+    // From the tick hook of machineSrc: a task (no subtasks or decorators) arrives at machineDest at tickArrive, which
+    // must be after the current tick. Return false if it is too early
+    bool SendTask(int machineSrc, int machineDest, int tickArrive, const ECSimTaskSpec &spec)
+    {
+        Machine &src = *listMachines[machineSrc];
+        if (!src.fInHook || tickArrive <= src.tickHook)
+        {
+            return false;
+        }
+        Event ev;
+        ev.tickArrive = tickArrive;
+        ev.machineSrc = machineSrc;
+        ev.tickSent = src.tickHook;
+        ev.index = src.numSentTick++;
+        ev.machineDest = machineDest;
+        ev.spec = spec;
+        // already sent before the rollback that is being coasted over; arrivals after the end never happen
+        if (src.tickHook <= src.tickCoastEnd || tickArrive > duration)
+        {
+            return true;
+        }
+        src.listSent.push_back(ev);
+        ++src.stats.numTasksSent;
+        Deliver(ev);
+        return true;
+    }
+
+    // Ticks between checkpoints: more ticks save less often and coast forward further
+    void SetCheckpointInterval(int ticks) { checkpointInterval = std::max(1, ticks); }
+
+    // How far past the GVT a machine may run in a round
+    void SetWindow(int ticks) { window = std::max(1, ticks); }
+
+    // Simulate every machine for durationIn (>= 0) ticks
+    void Simulate(int durationIn)
+    {
+        duration = durationIn;
+        statsTotal = ECSimTimeWarpStats();
+        for (auto pMachine : listMachines)
+        {
+            pMachine->listCheckpoints.assign(1, ECSimSchedulerCheckpoint());
+            pMachine->pScheduler->SaveCheckpoint(pMachine->listCheckpoints.back());
+            pMachine->stats = ECSimTimeWarpStats();
+            pMachine->stats.maxCheckpoints = 1;
+        }
+        int gvt = 0;
+        while (gvt < duration)
+        {
+            int tickTarget = (int)std::min((long long)duration, (long long)gvt + window);
+            std::atomic<int> next(0);
+            RunWorkers([&]()
+                       {
+                int index;
+                while ((index = next.fetch_add(1)) < (int)listMachines.size())
+                {
+                    Advance(*listMachines[index], tickTarget);
+                } });
+            ++statsTotal.numRounds;
+            gvt = ComputeGvt();
+            CollectFossils(gvt);
+        }
+        for (auto pMachine : listMachines)
+        {
+            // all arrivals are final now
+            for (auto &entry : pMachine->mapApplied)
+            {
+                pMachine->listTasks.push_back(entry.second.second);
+            }
+            pMachine->mapApplied.clear();
+            pMachine->mapPending.clear();
+            pMachine->listSent.clear();
+            pMachine->listCheckpoints.clear();
+            statsTotal.numTicksSimulated += pMachine->stats.numTicksSimulated;
+            statsTotal.numRollbacks += pMachine->stats.numRollbacks;
+            statsTotal.numTicksRolledBack += pMachine->stats.numTicksRolledBack;
+            statsTotal.numTasksSent += pMachine->stats.numTasksSent;
+            statsTotal.numAntiMessages += pMachine->stats.numAntiMessages;
+            statsTotal.maxCheckpoints = std::max(statsTotal.maxCheckpoints, pMachine->stats.maxCheckpoints);
+        }
+    }
+
+    // Rollback metrics of the last Simulate
+    const ECSimTimeWarpStats &GetTimeWarpStats() const { return statsTotal; }
+
+    // Merged metrics of all machines
+    ECSimShardedStats GetStats() const
+    {
+        ECSimShardedStats st;
+        st.numShards = (int)listMachines.size();
+        for (auto pMachine : listMachines)
+        {
+            st.numTasks += (int)pMachine->listTasks.size();
+            st.numTicks = std::max(st.numTicks, pMachine->pScheduler->GetTime());
+            st.numShardTicks += pMachine->pScheduler->GetTime();
+            for (auto x : pMachine->listTasks)
+            {
+                st.tmTotRun += x->GetTotRunTime();
+                st.tmTotWait += x->GetTotWaitTime();
+            }
+        }
+        return st;
+    }
+
+private:
+    ECSimTimeWarpSimulator(const ECSimTimeWarpSimulator &);
+    ECSimTimeWarpSimulator &operator=(const ECSimTimeWarpSimulator &);
+
+    // a task arrival, or its cancellation
+    struct Event
+    {
+        Event() : tickArrive(0), machineSrc(0), tickSent(0), index(0), machineDest(0), fAnti(false) {}
+
+        // arrivals are applied in (tick, sending machine, sending tick, index) order: the order of sending
+        std::tuple<int, int, int, int> GetKey() const { return std::make_tuple(tickArrive, machineSrc, tickSent, index); }
+
+        int tickArrive;
+        int machineSrc;
+        int tickSent;
+        int index;
+        int machineDest;
+        ECSimTaskSpec spec;
+        bool fAnti;
+    };
+    typedef std::tuple<int, int, int, int> EventKey;
+
+    struct Machine
+    {
+        Machine() : index(0), pScheduler(NULL), numInitial(0), fInHook(false), tickHook(0), numSentTick(0), tickCoastEnd(-1) {}
+
+        int index;
+        TScheduler *pScheduler;
+        // initial tasks, then committed arrivals
+        std::vector<TTask *> listTasks;
+        size_t numInitial;
+        // sent to this machine, not looked at yet
+        std::mutex mtxInbox;
+        std::vector<Event> listInbox;
+        // arrivals not applied yet, and applied ones with their task
+        std::map<EventKey, Event> mapPending;
+        std::map<EventKey, std::pair<Event, TTask *> > mapApplied;
+        // checkpoints by increasing tick; the first one is at or before the GVT
+        std::vector<ECSimSchedulerCheckpoint> listCheckpoints;
+        // arrivals sent from ticks after the GVT, by increasing sending tick
+        std::vector<Event> listSent;
+        bool fInHook;
+        int tickHook;
+        int numSentTick;
+        // ticks up to here are being re-simulated after a rollback: their sends stand
+        int tickCoastEnd;
+        ECSimTimeWarpStats stats;
+    };
+
+    // Run the work on min(numThreads, machines) threads, the calling thread being one of them
+    void RunWorkers(const std::function<void()> &work)
+    {
+        int num = std::min(numThreads, (int)listMachines.size());
+        std::vector<std::thread> listThreads;
+        for (int i = 1; i < num; ++i)
+        {
+            listThreads.push_back(std::thread(work));
+        }
+        work();
+        for (auto &t : listThreads)
+        {
+            t.join();
+        }
+    }
+
+    void Deliver(const Event &ev)
+    {
+        Machine &dest = *listMachines[ev.machineDest];
+        std::lock_guard<std::mutex> lock(dest.mtxInbox);
+        dest.listInbox.push_back(ev);
+    }
+
+    // Simulate a machine up to tickTarget, taking in what arrives meanwhile
+    void Advance(Machine &mach, int tickTarget)
+    {
+        while (true)
+        {
+            TakeInbox(mach);
+            int tick = mach.pScheduler->GetTime() + 1;
+            if (tick > tickTarget)
+            {
+                return;
+            }
+            // tasks arriving at this tick join before it is simulated
+            while (!mach.mapPending.empty() && std::get<0>(mach.mapPending.begin()->first) <= tick)
+            {
+                const Event &ev = mach.mapPending.begin()->second;
+                TTask *pTask = createTask(ev.spec);
+                mach.pScheduler->AddTask(pTask);
+                mach.mapApplied[ev.GetKey()] = std::make_pair(ev, pTask);
+                mach.mapPending.erase(mach.mapPending.begin());
+            }
+            // an idle machine still follows the clock
+            if (mach.pScheduler->Step(1) == 0)
+            {
+                mach.pScheduler->AdvanceTime(tick);
+            }
+            ++mach.stats.numTicksSimulated;
+            if (tickHook)
+            {
+                mach.fInHook = true;
+                mach.tickHook = tick;
+                mach.numSentTick = 0;
+                tickHook(*this, mach.index, tick);
+                mach.fInHook = false;
+            }
+            if (tick % checkpointInterval == 0)
+            {
+                mach.listCheckpoints.push_back(ECSimSchedulerCheckpoint());
+                mach.pScheduler->SaveCheckpoint(mach.listCheckpoints.back());
+                mach.stats.maxCheckpoints = std::max(mach.stats.maxCheckpoints, (int)mach.listCheckpoints.size());
+            }
+        }
+    }
+
+    // Take in arrivals and cancellations, rolling back for those in the simulated past
+    void TakeInbox(Machine &mach)
+    {
+        std::vector<Event> listIn;
+        {
+            std::lock_guard<std::mutex> lock(mach.mtxInbox);
+            listIn.swap(mach.listInbox);
+        }
+        for (const auto &ev : listIn)
+        {
+            EventKey key = ev.GetKey();
+            if (ev.fAnti && mach.mapPending.count(key) == 0 && mach.mapApplied.count(key) == 0)
+            {
+                continue;
+            }
+            if (ev.tickArrive <= mach.pScheduler->GetTime())
+            {
+                // straggler, or cancellation of an applied arrival
+                Rollback(mach, ev.tickArrive);
+            }
+            else if (ev.tickArrive <= mach.tickCoastEnd)
+            {
+                // the ticks being coasted over no longer repeat what was simulated before
+                CancelSends(mach, ev.tickArrive);
+            }
+            if (ev.fAnti)
+            {
+                // a cancellation always comes after its arrival, from the same sender; an applied arrival is pending again by now
+                mach.mapPending.erase(key);
+            }
+            else
+            {
+                mach.mapPending[key] = ev;
+            }
+        }
+    }
+
+    // Undo the ticks from tickRollback on: restore the last checkpoint before it and coast forward to it
+    void Rollback(Machine &mach, int tickRollback)
+    {
+        int tickOld = mach.pScheduler->GetTime();
+        while (mach.listCheckpoints.size() > 1 && mach.listCheckpoints.back().timeCurr >= tickRollback)
+        {
+            mach.listCheckpoints.pop_back();
+        }
+        const ECSimSchedulerCheckpoint &checkpoint = mach.listCheckpoints.back();
+        mach.pScheduler->RestoreCheckpoint(checkpoint);
+        // arrivals after the checkpoint are applied again later, with new tasks
+        auto it = mach.mapApplied.upper_bound(std::make_tuple(checkpoint.timeCurr, INT_MAX, INT_MAX, INT_MAX));
+        for (auto it2 = it; it2 != mach.mapApplied.end(); ++it2)
+        {
+            delete it2->second.second;
+            mach.mapPending[it2->first] = it2->second.first;
+        }
+        mach.mapApplied.erase(it, mach.mapApplied.end());
+        CancelSends(mach, tickRollback);
+        ++mach.stats.numRollbacks;
+        mach.stats.numTicksRolledBack += tickOld - checkpoint.timeCurr;
+    }
+
+    // Cancel what was sent from tick on, and send again when simulating it
+    void CancelSends(Machine &mach, int tick)
+    {
+        while (!mach.listSent.empty() && mach.listSent.back().tickSent >= tick)
+        {
+            Event ev = mach.listSent.back();
+            mach.listSent.pop_back();
+            ev.fAnti = true;
+            Deliver(ev);
+            ++mach.stats.numAntiMessages;
+        }
+        mach.tickCoastEnd = tick - 1;
+    }
+
+    // Global virtual time: every machine has simulated up to it, and nothing left in the system can change a tick at or before it
+    int ComputeGvt() const
+    {
+        int gvt = duration;
+        for (auto pMachine : listMachines)
+        {
+            gvt = std::min(gvt, pMachine->pScheduler->GetTime());
+            if (!pMachine->mapPending.empty())
+            {
+                gvt = std::min(gvt, std::get<0>(pMachine->mapPending.begin()->first) - 1);
+            }
+            for (const auto &ev : pMachine->listInbox)
+            {
+                gvt = std::min(gvt, ev.tickArrive - 1);
+            }
+        }
+        return gvt;
+    }
+
+    // Release what no rollback can need any more: checkpoints before the last one at or before the GVT, and the
+    // arrivals and sends before it
+    void CollectFossils(int gvt)
+    {
+        for (auto pMachine : listMachines)
+        {
+            std::vector<ECSimSchedulerCheckpoint> &listCheckpoints = pMachine->listCheckpoints;
+            size_t first = 0;
+            while (first + 1 < listCheckpoints.size() && listCheckpoints[first + 1].timeCurr <= gvt)
+            {
+                ++first;
+            }
+            listCheckpoints.erase(listCheckpoints.begin(), listCheckpoints.begin() + first);
+            int tickKeep = listCheckpoints.front().timeCurr;
+            auto it = pMachine->mapApplied.upper_bound(std::make_tuple(tickKeep, INT_MAX, INT_MAX, INT_MAX));
+            for (auto it2 = pMachine->mapApplied.begin(); it2 != it; ++it2)
+            {
+                pMachine->listTasks.push_back(it2->second.second);
+            }
+            pMachine->mapApplied.erase(pMachine->mapApplied.begin(), it);
+            auto itSent = std::find_if(pMachine->listSent.begin(), pMachine->listSent.end(), [gvt](const Event &ev)
+                                       { return ev.tickSent > gvt; });
+            pMachine->listSent.erase(pMachine->listSent.begin(), itSent);
+        }
+    }
+
+    std::function<TTask *(const ECSimTaskSpec &)> createTask;
+    std::function<void(ECSimTimeWarpSimulator &, int, int)> tickHook;
+    int numThreads;
+    int checkpointInterval;
+    int window;
+    int duration;
+    std::vector<Machine *> listMachines;
+    ECSimTimeWarpStats statsTotal;
+};
+
+#endif /* ECSimTimeWarpSimulator_h */
@@ -0,0 +1,249 @@
+//
+//  ECSimTimingWheel.h
+//
+//
+//  Hierarchical timing wheel: holds items keyed by a future tick, O(1) insert
+//  and remove, and pops everything that is due as the clock advances.
+//  Eight levels of 256 slots cover the whole range of 64-bit ticks; an item sits at the
+//  level of the highest byte in which its tick differs from the wheel clock,
+//  and moves down a level when the clock enters its slot.
+//
+
+#ifndef ECSimTimingWheel_h
+#define ECSimTimingWheel_h
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+
+template <class T>
+class ECSimTimingWheel
+{
+public:
+    ECSimTimingWheel() : now(0), numItems(0)
+    {
+        std::fill(bitmap, bitmap + NUM_LEVELS * WORDS_PER_LEVEL, 0);
+    }
+
+    // Current wheel clock (starts at LLONG_MIN): all items are due at or after this tick
+    long long GetTime() const { return Tick(now); }
+
+    // Number of items not yet popped
+    int GetSize() const { return numItems; }
+    bool IsEmpty() const { return numItems == 0; }
+
+    // Schedule an item at a tick; ticks in the past are due immediately
+    void Insert(long long tick, const T &item)
+    {
+        uint64_t key = std::max(Key(tick), now);
+        Place(key, item);
+        ++numItems;
+    }
+
+    // Remove an item that was inserted at the given tick; return false if not found
+    bool Remove(long long tick, const T &item)
+    {
+        uint64_t key = std::max(Key(tick), now);
+        int level = Level(key);
+        int slot = Slot(key, level);
+        std::vector<std::pair<uint64_t, T> > &list = slots[level][slot];
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            if (list[i].second == item)
+            {
+                list.erase(list.begin() + i);
+                if (list.empty())
+                {
+                    ClearBit(level, slot);
+                }
+                --numItems;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Earliest tick at which some item is due (the wheel must not be empty); doesn't move the clock
+    long long PeekNext() const
+    {
+        for (int level = 0; level < NUM_LEVELS; ++level)
+        {
+            int slot = FindBit(level, Slot(now, level) + (level > 0 ? 1 : 0));
+            if (slot >= 0)
+            {
+                // items of a slot are not sorted: scan it
+                const std::vector<std::pair<uint64_t, T> > &list = slots[level][slot];
+                uint64_t key = list[0].first;
+                for (size_t i = 1; i < list.size(); ++i)
+                {
+                    key = std::min(key, list[i].first);
+                }
+                return Tick(key);
+            }
+        }
+        return Tick(now);
+    }
+
+    // Move the clock to tick and pop all items due at or before it (appended to listDue in tick order)
+    void Advance(long long tick, std::vector<T> &listDue)
+    {
+        uint64_t to = Key(tick);
+        if (to < now)
+        {
+            return;
+        }
+        uint64_t key;
+        while (numItems > 0 && FindNext(to, key))
+        {
+            std::vector<std::pair<uint64_t, T> > &list = slots[0][key & SLOT_MASK];
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                listDue.push_back(list[i].second);
+            }
+            numItems -= (int)list.size();
+            list.clear();
+            ClearBit(0, key & SLOT_MASK);
+            now = key;
+        }
+        now = to;
+    }
+
+    // All items not yet popped with the tick they are due, in no particular order
+    void GetItems(std::vector<std::pair<long long, T> > &listItems) const
+    {
+        for (int level = 0; level < NUM_LEVELS; ++level)
+        {
+            for (int slot = FindBit(level, 0); slot >= 0; slot = slot + 1 < NUM_SLOTS ? FindBit(level, slot + 1) : -1)
+            {
+                for (const auto &item : slots[level][slot])
+                {
+                    listItems.push_back(std::make_pair(Tick(item.first), item.second));
+                }
+            }
+        }
+    }
+
+    // Bytes taken by the wheel and its slot lists
+    size_t GetMemoryUsage() const
+    {
+        size_t numBytes = sizeof(*this);
+        for (int level = 0; level < NUM_LEVELS; ++level)
+        {
+            for (int slot = 0; slot < NUM_SLOTS; ++slot)
+            {
+                numBytes += slots[level][slot].capacity() * sizeof(slots[level][slot][0]);
+            }
+        }
+        return numBytes;
+    }
+
+private:
+    enum
+    {
+        NUM_LEVELS = 8,
+        SLOT_BITS = 8,
+        NUM_SLOTS = 1 << SLOT_BITS,
+        SLOT_MASK = NUM_SLOTS - 1,
+        WORDS_PER_LEVEL = NUM_SLOTS / 64
+    };
+
+    // map ticks onto unsigned keys that keep the order of (possibly negative) ticks
+    static uint64_t Key(long long tick) { return (uint64_t)tick ^ 0x8000000000000000ull; }
+    static long long Tick(uint64_t key) { return (long long)(key ^ 0x8000000000000000ull); }
+
+    int Level(uint64_t key) const
+    {
+        uint64_t diff = key ^ now;
+        int level = 0;
+        while (level < NUM_LEVELS - 1 && (diff >> ((level + 1) * SLOT_BITS)) != 0)
+        {
+            ++level;
+        }
+        return level;
+    }
+    static int Slot(uint64_t key, int level) { return (int)((key >> (level * SLOT_BITS)) & SLOT_MASK); }
+
+    void Place(uint64_t key, const T &item)
+    {
+        int level = Level(key);
+        int slot = Slot(key, level);
+        slots[level][slot].push_back(std::make_pair(key, item));
+        SetBit(level, slot);
+    }
+
+    // Find the earliest due key that is <= limit, cascading upper levels as needed
+    bool FindNext(uint64_t limit, uint64_t &key)
+    {
+        while (numItems > 0)
+        {
+            int level = 0;
+            int slot = -1;
+            for (; level < NUM_LEVELS; ++level)
+            {
+                // level 0 may hold items due exactly now; upper levels only hold later slots
+                int from = Slot(now, level) + (level > 0 ? 1 : 0);
+                slot = FindBit(level, from);
+                if (slot >= 0)
+                {
+                    break;
+                }
+            }
+            if (slot < 0)
+            {
+                return false;
+            }
+            // start of the slot: keep the clock's upper bytes, set this level's byte, clear the lower ones
+            uint32_t shift = level * SLOT_BITS;
+            uint64_t upperMask = (level + 1 < NUM_LEVELS) ? ~(((uint64_t)1 << (shift + SLOT_BITS)) - 1) : 0;
+            uint64_t start = (now & upperMask) | ((uint64_t)slot << shift);
+            if (start > limit)
+            {
+                return false;
+            }
+            if (level == 0)
+            {
+                key = start;
+                return true;
+            }
+            // cascade the slot one or more levels down
+            now = start;
+            std::vector<std::pair<uint64_t, T> > list;
+            list.swap(slots[level][slot]);
+            ClearBit(level, slot);
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                Place(list[i].first, list[i].second);
+            }
+        }
+        return false;
+    }
+
+    void SetBit(int level, int slot) { bitmap[level * WORDS_PER_LEVEL + slot / 64] |= (uint64_t)1 << (slot % 64); }
+    void ClearBit(int level, int slot) { bitmap[level * WORDS_PER_LEVEL + slot / 64] &= ~((uint64_t)1 << (slot % 64)); }
+
+    // first non-empty slot at or after from, -1 if none
+    int FindBit(int level, int from) const
+    {
+        for (int w = from / 64; w < WORDS_PER_LEVEL; ++w)
+        {
+            uint64_t bits = bitmap[level * WORDS_PER_LEVEL + w];
+            if (w == from / 64)
+            {
+                bits &= ~(uint64_t)0 << (from % 64);
+            }
+            if (bits != 0)
+            {
+                return w * 64 + __builtin_ctzll(bits);
+            }
+        }
+        return -1;
+    }
+
+    uint64_t now;
+    int numItems;
+    std::vector<std::pair<uint64_t, T> > slots[NUM_LEVELS][NUM_SLOTS];
+    uint64_t bitmap[NUM_LEVELS * WORDS_PER_LEVEL];
+};
+
+#endif /* ECSimTimingWheel_h */
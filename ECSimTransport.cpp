@@ -0,0 +1,356 @@
+//
+//  ECSimTransport.cpp
+//
+//
+//
+
+#include "ECSimTransport.h"
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+using namespace std;
+
+//***********************************************************
+// Unix domain sockets
+
+bool ECSimSocketTransport ::CreateMesh(int numNodes, vector<vector<int> > &mesh)
+{
+    mesh.assign(numNodes, vector<int>(numNodes, -1));
+    for (int i = 0; i < numNodes; ++i)
+    {
+        for (int j = i + 1; j < numNodes; ++j)
+        {
+            int sv[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+            {
+                return false;
+            }
+            mesh[i][j] = sv[0];
+            mesh[j][i] = sv[1];
+        }
+    }
+    return true;
+}
+
+ECSimSocketTransport ::ECSimSocketTransport(int rankIn, const vector<vector<int> > &mesh) : rank(rankIn)
+{
+    for (int i = 0; i < (int)mesh.size(); ++i)
+    {
+        for (int j = 0; j < (int)mesh.size(); ++j)
+        {
+            if (i != rank && mesh[i][j] >= 0)
+            {
+                close(mesh[i][j]);
+            }
+        }
+    }
+    listFds = mesh[rank];
+    listPartial.resize(mesh.size());
+}
+
+ECSimSocketTransport ::~ECSimSocketTransport()
+{
+    for (int fd : listFds)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+bool ECSimSocketTransport ::Pump(int nodeWrite)
+{
+    vector<pollfd> listPoll;
+    vector<int> listNodes;
+    for (int node = 0; node < (int)listFds.size(); ++node)
+    {
+        if (listFds[node] >= 0)
+        {
+            pollfd pfd;
+            pfd.fd = listFds[node];
+            pfd.events = POLLIN | (node == nodeWrite ? POLLOUT : 0);
+            pfd.revents = 0;
+            listPoll.push_back(pfd);
+            listNodes.push_back(node);
+        }
+    }
+    if (listPoll.empty())
+    {
+        return false;
+    }
+    if (poll(listPoll.data(), listPoll.size(), -1) < 0)
+    {
+        return errno == EINTR;
+    }
+    for (size_t i = 0; i < listPoll.size(); ++i)
+    {
+        if ((listPoll[i].revents & (POLLIN | POLLHUP | POLLERR)) == 0)
+        {
+            continue;
+        }
+        int node = listNodes[i];
+        vector<char> &partial = listPartial[node];
+        char buf[sizeof(ECSimMessage)];
+        ssize_t n = recv(listFds[node], buf, sizeof(ECSimMessage) - partial.size(), MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            // peer closed
+            close(listFds[node]);
+            listFds[node] = -1;
+            continue;
+        }
+        partial.insert(partial.end(), buf, buf + n);
+        if (partial.size() == sizeof(ECSimMessage))
+        {
+            ECSimMessage msg;
+            memcpy(&msg, partial.data(), sizeof(msg));
+            listInbox.push_back(msg);
+            partial.clear();
+        }
+    }
+    return true;
+}
+
+bool ECSimSocketTransport ::Send(int node, const ECSimMessage &msg)
+{
+    const char *p = reinterpret_cast<const char *>(&msg);
+    size_t left = sizeof(msg);
+    while (left > 0)
+    {
+        if (listFds[node] < 0)
+        {
+            return false;
+        }
+        // a peer that already finished must not kill us with SIGPIPE
+        ssize_t n = send(listFds[node], p, left, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            if (!Pump(node))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        left -= n;
+    }
+    return true;
+}
+
+bool ECSimSocketTransport ::Receive(ECSimMessage &msg)
+{
+    while (listInbox.empty())
+    {
+        if (!Pump(-1))
+        {
+            return false;
+        }
+    }
+    msg = listInbox.front();
+    listInbox.pop_front();
+    return true;
+}
+
+//***********************************************************
+// Shared memory rings
+//
+// Region layout: numNodes, capacity, then numNodes peers (mutex / state), then numNodes * numNodes rings
+// (head / tail), then their slots
+
+static size_t RegionHeaderSize()
+{
+    return 64;
+}
+
+// Bytes of the peers, rounded up so the rings stay aligned
+static size_t RegionPeersSize(int numNodes, size_t sizePeer)
+{
+    return ((size_t)numNodes * sizePeer + 63) / 64 * 64;
+}
+
+// Idle rounds between checks of the peers
+static const int numIdleCheck = 1024;
+
+void *ECSimShmTransport ::CreateRegion(int numNodes, int capacity)
+{
+    size_t size = RegionHeaderSize() + RegionPeersSize(numNodes, sizeof(Peer)) + (size_t)numNodes * numNodes * (sizeof(Ring) + (size_t)capacity * sizeof(ECSimMessage));
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        return NULL;
+    }
+    int *pHeader = static_cast<int *>(p);
+    pHeader[0] = numNodes;
+    pHeader[1] = capacity;
+    // anonymous mappings are zeroed: all rings start empty, all peers not started
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    Peer *listPeers = reinterpret_cast<Peer *>(static_cast<char *>(p) + RegionHeaderSize());
+    for (int node = 0; node < numNodes; ++node)
+    {
+        pthread_mutex_init(&listPeers[node].mutex, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+    return p;
+}
+
+void ECSimShmTransport ::DestroyRegion(void *pRegion)
+{
+    int *pHeader = static_cast<int *>(pRegion);
+    size_t size = RegionHeaderSize() + RegionPeersSize(pHeader[0], sizeof(Peer)) + (size_t)pHeader[0] * pHeader[0] * (sizeof(Ring) + (size_t)pHeader[1] * sizeof(ECSimMessage));
+    munmap(pRegion, size);
+}
+
+ECSimShmTransport ::ECSimShmTransport(int rankIn, void *pRegion) : rank(rankIn), pBase(static_cast<char *>(pRegion)), numIdle(0)
+{
+    numNodes = static_cast<int *>(pRegion)[0];
+    capacity = static_cast<int *>(pRegion)[1];
+    Peer *pPeer = GetPeer(rank);
+    if (pthread_mutex_lock(&pPeer->mutex) == EOWNERDEAD)
+    {
+        pthread_mutex_consistent(&pPeer->mutex);
+    }
+    pPeer->state.store(PEER_RUNNING, std::memory_order_release);
+}
+
+ECSimShmTransport ::~ECSimShmTransport()
+{
+    // what was sent stays readable: peers take it in before they see the channel broken
+    Peer *pPeer = GetPeer(rank);
+    pPeer->state.store(PEER_GONE, std::memory_order_release);
+    pthread_mutex_unlock(&pPeer->mutex);
+}
+
+ECSimShmTransport::Peer *ECSimShmTransport ::GetPeer(int node) const
+{
+    return reinterpret_cast<Peer *>(pBase + RegionHeaderSize()) + node;
+}
+
+ECSimShmTransport::Ring *ECSimShmTransport ::GetRing(int from, int to) const
+{
+    return reinterpret_cast<Ring *>(pBase + RegionHeaderSize() + RegionPeersSize(numNodes, sizeof(Peer))) + (from * numNodes + to);
+}
+
+ECSimMessage *ECSimShmTransport ::GetSlots(int from, int to) const
+{
+    char *pSlots = pBase + RegionHeaderSize() + RegionPeersSize(numNodes, sizeof(Peer)) + (size_t)numNodes * numNodes * sizeof(Ring);
+    return reinterpret_cast<ECSimMessage *>(pSlots) + (size_t)(from * numNodes + to) * capacity;
+}
+
+bool ECSimShmTransport ::IsPeerGone(int node) const
+{
+    Peer *pPeer = GetPeer(node);
+    int state = pPeer->state.load(std::memory_order_acquire);
+    if (state != PEER_RUNNING)
+    {
+        return state == PEER_GONE;
+    }
+    // a running peer holds its mutex; if it died with it, the mutex says so (a dead process holds nothing, zombie or not)
+    int res = pthread_mutex_trylock(&pPeer->mutex);
+    if (res == EOWNERDEAD)
+    {
+        pPeer->state.store(PEER_GONE, std::memory_order_release);
+        pthread_mutex_consistent(&pPeer->mutex);
+        pthread_mutex_unlock(&pPeer->mutex);
+        return true;
+    }
+    if (res == 0)
+    {
+        // it just closed its transport
+        pthread_mutex_unlock(&pPeer->mutex);
+        return pPeer->state.load(std::memory_order_acquire) == PEER_GONE;
+    }
+    return false;
+}
+
+bool ECSimShmTransport ::Idle()
+{
+    sched_yield();
+    if (++numIdle < numIdleCheck)
+    {
+        return false;
+    }
+    numIdle = 0;
+    return true;
+}
+
+bool ECSimShmTransport ::Pump()
+{
+    bool fAny = false;
+    for (int node = 0; node < numNodes; ++node)
+    {
+        if (node == rank)
+        {
+            continue;
+        }
+        Ring *pRing = GetRing(node, rank);
+        uint32_t head = pRing->head.load(std::memory_order_relaxed);
+        if (head != pRing->tail.load(std::memory_order_acquire))
+        {
+            listInbox.push_back(GetSlots(node, rank)[head % capacity]);
+            pRing->head.store(head + 1, std::memory_order_release);
+            fAny = true;
+        }
+    }
+    return fAny;
+}
+
+bool ECSimShmTransport ::Send(int node, const ECSimMessage &msg)
+{
+    Ring *pRing = GetRing(rank, node);
+    uint32_t tail = pRing->tail.load(std::memory_order_relaxed);
+    // wait for room, taking in what others send meanwhile; nobody makes room if the peer is gone
+    while (tail - pRing->head.load(std::memory_order_acquire) >= (uint32_t)capacity)
+    {
+        if (!Pump() && Idle() && IsPeerGone(node))
+        {
+            return false;
+        }
+    }
+    GetSlots(rank, node)[tail % capacity] = msg;
+    pRing->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool ECSimShmTransport ::Receive(ECSimMessage &msg)
+{
+    if (numNodes <= 1 && listInbox.empty())
+    {
+        return false;
+    }
+    while (listInbox.empty())
+    {
+        if (Pump() || !Idle())
+        {
+            continue;
+        }
+        // all channels are broken once every peer is gone and nothing it sent is left
+        bool fAllGone = true;
+        for (int node = 0; node < numNodes && fAllGone; ++node)
+        {
+            fAllGone = node == rank || IsPeerGone(node);
+        }
+        if (fAllGone && !Pump())
+        {
+            return false;
+        }
+    }
+    msg = listInbox.front();
+    listInbox.pop_front();
+    return true;
+}
@@ -0,0 +1,173 @@
+//
+//  ECSimTransport.h
+//
+//
+//  Message transport between the processes of a distributed simulation
+//  (see ECSimPdesNode.h). Each ordered pair of nodes has a FIFO channel;
+//  a node sends to one peer and receives from whichever peer has a message.
+//  A send that has to wait for room keeps receiving meanwhile (into an inbox),
+//  so two nodes sending to each other can't block each other.
+//  Two local transports: Unix domain sockets and shared-memory rings. Both
+//  are set up by the parent before fork(), and each child then opens its end.
+//
+
+#ifndef ECSimTransport_h
+#define ECSimTransport_h
+
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+
+//***********************************************************
+// Fixed-size message
+
+enum ECSimMessageType
+{
+    // a task arrives at a machine at tick
+    EC_MSG_TASK = 0,
+    // null message: the sender will send no task arriving at or before tick
+    EC_MSG_NULL
+};
+
+struct ECSimMessage
+{
+    ECSimMessage() : type(EC_MSG_NULL), node(0), tick(0), machineSrc(0), seq(0), machine(0), kind(0), priority(0), tmStart(0), tmEnd(0), runLen(0), sleepLen(0)
+    {
+        id[0] = '\0';
+    }
+
+    int type;
+    // sending node
+    int node;
+    int tick;
+    // sending machine and its message count: orders arrivals the same way however machines are partitioned
+    int machineSrc;
+    int seq;
+    // destination machine and the task (an ECSimTaskSpec without subtasks or decorators)
+    int machine;
+    int kind;
+    int priority;
+    int tmStart;
+    int tmEnd;
+    int runLen;
+    int sleepLen;
+    char id[32];
+};
+
+//***********************************************************
+// Transport interface
+
+class ECSimTransport
+{
+public:
+    virtual ~ECSimTransport() {}
+
+    // This node's number, and the number of nodes
+    virtual int GetRank() const = 0;
+    virtual int GetNumNodes() const = 0;
+
+    // Send a message to a peer; return false if the channel is broken
+    virtual bool Send(int node, const ECSimMessage &msg) = 0;
+
+    // Wait for the next message from any peer; return false if all channels are broken
+    virtual bool Receive(ECSimMessage &msg) = 0;
+};
+
+//***********************************************************
+// Unix domain sockets: one socket pair per pair of nodes
+
+class ECSimSocketTransport : public ECSimTransport
+{
+public:
+    // Create the sockets of all pairs (before fork); mesh[i][j] is node i's end towards node j (-1 on the diagonal)
+    static bool CreateMesh(int numNodes, std::vector<std::vector<int> > &mesh);
+
+    // Take this node's ends of the mesh and close all the others (in each process after fork)
+    ECSimSocketTransport(int rank, const std::vector<std::vector<int> > &mesh);
+    virtual ~ECSimSocketTransport();
+
+    virtual int GetRank() const { return rank; }
+    virtual int GetNumNodes() const { return (int)listFds.size(); }
+    virtual bool Send(int node, const ECSimMessage &msg);
+    virtual bool Receive(ECSimMessage &msg);
+
+private:
+    ECSimSocketTransport(const ECSimSocketTransport &);
+    ECSimSocketTransport &operator=(const ECSimSocketTransport &);
+
+    // wait until a peer is readable (or node is writable, if >= 0) and read what is there into the inbox
+    bool Pump(int nodeWrite);
+
+    int rank;
+    std::vector<int> listFds;
+    // partially received message of each peer
+    std::vector<std::vector<char> > listPartial;
+    std::deque<ECSimMessage> listInbox;
+};
+
+//***********************************************************
+// Shared memory: one single-producer single-consumer ring per ordered pair of nodes.
+// Each node holds a robust process-shared mutex for as long as its transport lives, so a peer that exits or dies
+// (even one not yet reaped) is noticed: its channel is broken once its ring is empty
+
+class ECSimShmTransport : public ECSimTransport
+{
+public:
+    // Map the rings of all pairs in memory shared with the children (before fork); NULL on failure
+    static void *CreateRegion(int numNodes, int capacity);
+    // Unmap it (in each process, when done)
+    static void DestroyRegion(void *pRegion);
+
+    // Create and destroy the transport on the same thread (it holds the node's mutex)
+    ECSimShmTransport(int rank, void *pRegion);
+    virtual ~ECSimShmTransport();
+
+    virtual int GetRank() const { return rank; }
+    virtual int GetNumNodes() const { return numNodes; }
+    virtual bool Send(int node, const ECSimMessage &msg);
+    virtual bool Receive(ECSimMessage &msg);
+
+private:
+    ECSimShmTransport(const ECSimShmTransport &);
+    ECSimShmTransport &operator=(const ECSimShmTransport &);
+
+    struct Ring
+    {
+        std::atomic<uint32_t> head;
+        std::atomic<uint32_t> tail;
+    };
+
+    // A node: its mutex, held while its transport lives, and whether it is not started yet, running or gone
+    enum
+    {
+        PEER_NEW = 0,
+        PEER_RUNNING,
+        PEER_GONE
+    };
+    struct Peer
+    {
+        pthread_mutex_t mutex;
+        std::atomic<int> state;
+    };
+
+    Peer *GetPeer(int node) const;
+    Ring *GetRing(int from, int to) const;
+    ECSimMessage *GetSlots(int from, int to) const;
+    // move one waiting message of each peer into the inbox; return false if there was none
+    bool Pump();
+    // has a peer closed its transport or died?
+    bool IsPeerGone(int node) const;
+    // wait a little after finding nothing to do; every so often, true if the peers should be checked
+    bool Idle();
+
+    int rank;
+    int numNodes;
+    int capacity;
+    char *pBase;
+    std::deque<ECSimMessage> listInbox;
+    int numIdle;
+};
+
+#endif /* ECSimTransport_h */
@@ -0,0 +1,416 @@
+//
+//  ECSimWindowedSimulator.cpp
+//
+//
+//
+
+#include "ECSimWindowedSimulator.h"
+#include "ECSimTaskBase.h"
+#include "ECSimSchedulability.h"
+#include <algorithm>
+#include <climits>
+using namespace std;
+
+namespace ecsim
+{
+
+// Value at percentile p (nearest rank) of sorted values
+static int GetPercentile(const vector<int> &listSorted, int p)
+{
+    if (listSorted.empty())
+    {
+        return 0;
+    }
+    size_t rank = (listSorted.size() * p + 99) / 100;
+    return listSorted[rank > 0 ? rank - 1 : 0];
+}
+
+static long long Gcd(long long a, long long b)
+{
+    while (b != 0)
+    {
+        long long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static bool IsSameMetrics(const ECSimWindowMetrics &m1, const ECSimWindowMetrics &m2)
+{
+    return m1.numTicks == m2.numTicks && m1.numBusyTicks == m2.numBusyTicks && m1.tmTotWait == m2.tmTotWait && m1.numWaits == m2.numWaits &&
+           m1.waitP50 == m2.waitP50 && m1.waitP95 == m2.waitP95 && m1.waitP99 == m2.waitP99 && m1.waitMax == m2.waitMax &&
+           m1.numReleases == m2.numReleases && m1.numMisses == m2.numMisses;
+}
+
+//***********************************************************
+// Metrics being gathered
+
+void ECSimWindowedSimulator::Accumulator ::Clear(ECSimTime tmStartIn)
+{
+    metrics = ECSimWindowMetrics();
+    metrics.tmStart = tmStartIn;
+    metrics.tmEnd = tmStartIn - 1;
+    listWaits.clear();
+}
+
+void ECSimWindowedSimulator::Accumulator ::Close(ECSimWindowMetrics &result, ECSimTime tmEnd)
+{
+    result = metrics;
+    result.tmEnd = tmEnd;
+    std::sort(listWaits.begin(), listWaits.end());
+    result.waitP50 = GetPercentile(listWaits, 50);
+    result.waitP95 = GetPercentile(listWaits, 95);
+    result.waitP99 = GetPercentile(listWaits, 99);
+    result.waitMax = listWaits.empty() ? 0 : listWaits.back();
+    listWaits.clear();
+}
+
+//***********************************************************
+// Windowed simulation
+
+ECSimWindowedSimulator ::ECSimWindowedSimulator(ECSimTaskScheduler &schedulerIn, int windowIn) : scheduler(schedulerIn), window(max(1, windowIn)), numSimulated(0), numExtrapolated(0),
+                                                                                                 fDetect(true), maxHyperperiod(65536), numRepeats(0), hyperperiod(0), tmCycleStart(-1), hashCycle(0), hashPrev(0), numSame(0), fSteady(false), tmSteady(0)
+{
+    windowCurr.Clear(scheduler.GetTime64() + 1);
+    totals.tmStart = scheduler.GetTime64() + 1;
+    totals.tmEnd = scheduler.GetTime64();
+}
+
+void ECSimWindowedSimulator ::AddTask(ECSimTask *pTask)
+{
+    scheduler.AddTask(pTask);
+    FollowTask(pTask);
+}
+
+ECSimTask *ECSimWindowedSimulator ::AddTask(Task task)
+{
+    ECSimTask *pTask = scheduler.AddTask(std::move(task));
+    if (pTask != NULL)
+    {
+        FollowTask(pTask);
+    }
+    return pTask;
+}
+
+void ECSimWindowedSimulator ::SetSteadyStateDetection(bool fDetectIn, int maxHyperperiodIn, int numRepeatsIn)
+{
+    fDetect = fDetectIn;
+    maxHyperperiod = maxHyperperiodIn;
+    numRepeats = max(0, numRepeatsIn);
+    tmCycleStart = -1;
+}
+
+void ECSimWindowedSimulator ::FollowTask(ECSimTask *pTask)
+{
+    TaskInfo info;
+    info.pTask = pTask;
+    info.tmLastWait = pTask->GetTotWaitTime64();
+    info.lenWait = 0;
+    ECSimTimingModel model;
+    info.fModel = pTask->GetTimingModel(model) && model.deadline > 0;
+    info.offset = model.offset;
+    info.wcet = model.wcet;
+    info.period = model.period;
+    info.deadline = model.deadline;
+    info.tmRelease = model.offset;
+    info.numReleaseRuns = 0;
+    // releases before now are not ours to count
+    while (info.fModel && info.tmRelease + info.deadline - 1 <= scheduler.GetTime64())
+    {
+        if (info.period > 0)
+        {
+            info.tmRelease += info.period;
+        }
+        else
+        {
+            info.fModel = false;
+        }
+    }
+    listInfo.push_back(info);
+    // a new task makes a new schedule
+    tmCycleStart = -1;
+    fSteady = false;
+}
+
+long long ECSimWindowedSimulator ::Simulate(long long duration)
+{
+    long long numLeft = duration < 0 ? LLONG_MAX : duration;
+    long long numCovered = 0;
+    while (numCovered < numLeft)
+    {
+        if (fSteady)
+        {
+            // nothing more to learn by simulating on
+            if (duration < 0)
+            {
+                break;
+            }
+            long long numCycles = (numLeft - numCovered) / hyperperiod;
+            if (numCycles > 0)
+            {
+                CloseWindow();
+                AddTotals(steady, numCycles);
+                numExtrapolated += numCycles * hyperperiod;
+                numCovered += numCycles * hyperperiod;
+                totals.tmEnd = ECSimTimeAdd(scheduler.GetTime64(), numExtrapolated);
+                windowCurr.Clear(scheduler.GetTime64() + 1);
+                continue;
+            }
+        }
+        // steps never cross the end of a window or of a hyperperiod
+        ECSimTime tick = scheduler.GetTime64();
+        ECSimTime maxTicks = min(numLeft - numCovered, windowCurr.metrics.tmStart + window - 1 - tick);
+        if (tmCycleStart >= 0)
+        {
+            maxTicks = min(maxTicks, tmCycleStart + hyperperiod - tick);
+        }
+        ECSimTime numTicks = scheduler.Step(max((ECSimTime)1, maxTicks));
+        if (numTicks == 0)
+        {
+            CloseWindow();
+            break;
+        }
+        numCovered += numTicks;
+        AfterStep(numTicks);
+        if (fSteady && duration < 0)
+        {
+            CloseWindow();
+            break;
+        }
+    }
+    return numCovered;
+}
+
+void ECSimWindowedSimulator ::AfterStep(ECSimTime numTicks)
+{
+    ECSimTime tick = scheduler.GetTime64();
+    ECSimTask *pRun = scheduler.GetCurrTask();
+    numSimulated += numTicks;
+    long long numBusy = pRun != NULL ? 1 : 0;
+    windowCurr.metrics.numTicks += numTicks;
+    windowCurr.metrics.numBusyTicks += numBusy;
+    totals.numTicks += numTicks;
+    totals.numBusyTicks += numBusy;
+    totals.tmEnd = ECSimTimeAdd(tick, numExtrapolated);
+    bool fCycle = tmCycleStart >= 0;
+    if (fCycle)
+    {
+        cycleCurr.metrics.numTicks += numTicks;
+        cycleCurr.metrics.numBusyTicks += numBusy;
+    }
+
+    // waits and releases of each task
+    int indexRun = -1;
+    bool fLeft = false;
+    for (size_t i = 0; i < listInfo.size(); ++i)
+    {
+        TaskInfo &info = listInfo[i];
+        ECSimTime tmWait = info.pTask->GetTotWaitTime64();
+        if (tmWait != info.tmLastWait)
+        {
+            ECSimTime numWait = tmWait - info.tmLastWait;
+            windowCurr.metrics.tmTotWait += numWait;
+            totals.tmTotWait += numWait;
+            if (fCycle)
+            {
+                cycleCurr.metrics.tmTotWait += numWait;
+            }
+            info.lenWait += numWait;
+            info.tmLastWait = tmWait;
+        }
+        else if (info.lenWait > 0)
+        {
+            AddWait(info.lenWait);
+            info.lenWait = 0;
+        }
+        bool fRan = info.pTask == pRun;
+        if (fRan)
+        {
+            indexRun = (int)i;
+        }
+        // a release that is over counts, and misses if it didn't get its wcet; one cut short by the task leaving too
+        bool fDone = info.pTask->IsFinished(tick + 1) || info.pTask->IsAborted(tick + 1);
+        if (info.fModel && fRan && tick >= info.tmRelease && tick < info.tmRelease + info.deadline)
+        {
+            ++info.numReleaseRuns;
+        }
+        while (info.fModel && (tick >= info.tmRelease + info.deadline - 1 || (fDone && tick >= info.tmRelease)))
+        {
+            long long numMiss = info.numReleaseRuns < info.wcet ? 1 : 0;
+            ++windowCurr.metrics.numReleases;
+            windowCurr.metrics.numMisses += numMiss;
+            ++totals.numReleases;
+            totals.numMisses += numMiss;
+            if (fCycle)
+            {
+                ++cycleCurr.metrics.numReleases;
+                cycleCurr.metrics.numMisses += numMiss;
+            }
+            info.numReleaseRuns = 0;
+            if (info.period > 0 && !fDone)
+            {
+                info.tmRelease += info.period;
+            }
+            else
+            {
+                info.fModel = false;
+            }
+        }
+        if (fDone)
+        {
+            if (info.lenWait > 0)
+            {
+                AddWait(info.lenWait);
+            }
+            info.pTask = NULL;
+            fLeft = true;
+        }
+    }
+    if (fLeft)
+    {
+        listInfo.erase(std::remove_if(listInfo.begin(), listInfo.end(), [](const TaskInfo &info)
+                                      { return info.pTask == NULL; }),
+                       listInfo.end());
+        // the schedule is not the same without them
+        tmCycleStart = -1;
+        fCycle = false;
+    }
+
+    if (fCycle)
+    {
+        UpdateCycle(numTicks, indexRun);
+    }
+    if (tick >= windowCurr.metrics.tmStart + window - 1)
+    {
+        CloseWindow();
+        if (fDetect && !fSteady && tmCycleStart < 0)
+        {
+            StartCycle();
+        }
+    }
+}
+
+void ECSimWindowedSimulator ::AddWait(ECSimTime lenIn)
+{
+    int len = ECSimTimeToInt(lenIn);
+    windowCurr.listWaits.push_back(len);
+    ++windowCurr.metrics.numWaits;
+    ++totals.numWaits;
+    totals.waitMax = max(totals.waitMax, len);
+    if (tmCycleStart >= 0)
+    {
+        cycleCurr.listWaits.push_back(len);
+        ++cycleCurr.metrics.numWaits;
+    }
+}
+
+void ECSimWindowedSimulator ::CloseWindow()
+{
+    if (windowCurr.metrics.numTicks == 0)
+    {
+        return;
+    }
+    ECSimWindowMetrics metrics;
+    windowCurr.Close(metrics, scheduler.GetTime64());
+    // after an extrapolation, windows count the extrapolated ticks too
+    metrics.tmStart = ECSimTimeAdd(metrics.tmStart, numExtrapolated);
+    metrics.tmEnd = ECSimTimeAdd(metrics.tmEnd, numExtrapolated);
+    totals.waitP50 = max(totals.waitP50, metrics.waitP50);
+    totals.waitP95 = max(totals.waitP95, metrics.waitP95);
+    totals.waitP99 = max(totals.waitP99, metrics.waitP99);
+    if (windowHook)
+    {
+        windowHook(metrics);
+    }
+    windowCurr.Clear(scheduler.GetTime64() + 1);
+}
+
+// Begin measuring hyperperiods, if only periodic tasks are left and all of them were released, and the policy
+// repeats for good (or the caller said how many repeats to take)
+void ECSimWindowedSimulator ::StartCycle()
+{
+    if (numRepeats == 0 && !scheduler.IsReadinessOnly())
+    {
+        return;
+    }
+    ECSimTime tick = scheduler.GetTime64();
+    long long lcm = 1;
+    for (const auto &info : listInfo)
+    {
+        if (!info.fModel || info.period <= 0 || tick < info.offset)
+        {
+            return;
+        }
+        lcm = lcm / Gcd(lcm, info.period) * info.period;
+        if (lcm > maxHyperperiod)
+        {
+            return;
+        }
+    }
+    if (listInfo.empty())
+    {
+        return;
+    }
+    hyperperiod = (int)lcm;
+    tmCycleStart = tick;
+    hashCycle = 14695981039346656037ULL;
+    cycleCurr.Clear(tick + 1);
+    cyclePrev = ECSimWindowMetrics();
+    numSame = 0;
+}
+
+// Add a step to the hyperperiod being measured; at its end, compare it with the one before
+void ECSimWindowedSimulator ::UpdateCycle(ECSimTime numTicks, int index)
+{
+    // FNV-1a over (ticks, task that ran, number of ready tasks)
+    uint64_t listVals[3] = {(uint64_t)numTicks, (uint64_t)(index + 1), (uint64_t)scheduler.GetNumReady()};
+    for (uint64_t x : listVals)
+    {
+        hashCycle = (hashCycle ^ x) * 1099511628211ULL;
+    }
+    ECSimTime tick = scheduler.GetTime64();
+    if (tick < tmCycleStart + hyperperiod)
+    {
+        return;
+    }
+    ECSimWindowMetrics metrics;
+    cycleCurr.Close(metrics, tick);
+    if (cyclePrev.numTicks > 0 && hashCycle == hashPrev && IsSameMetrics(metrics, cyclePrev))
+    {
+        ++numSame;
+    }
+    else
+    {
+        numSame = 0;
+    }
+    if (numSame >= max(1, numRepeats))
+    {
+        fSteady = true;
+        tmSteady = tick;
+        steady = metrics;
+        tmCycleStart = -1;
+        return;
+    }
+    cyclePrev = metrics;
+    hashPrev = hashCycle;
+    hashCycle = 14695981039346656037ULL;
+    tmCycleStart = tick;
+    cycleCurr.Clear(tick + 1);
+}
+
+void ECSimWindowedSimulator ::AddTotals(const ECSimWindowMetrics &metrics, long long times)
+{
+    totals.numTicks += metrics.numTicks * times;
+    totals.numBusyTicks += metrics.numBusyTicks * times;
+    totals.tmTotWait += metrics.tmTotWait * times;
+    totals.numWaits += metrics.numWaits * times;
+    totals.numReleases += metrics.numReleases * times;
+    totals.numMisses += metrics.numMisses * times;
+    totals.waitP50 = max(totals.waitP50, metrics.waitP50);
+    totals.waitP95 = max(totals.waitP95, metrics.waitP95);
+    totals.waitP99 = max(totals.waitP99, metrics.waitP99);
+    totals.waitMax = max(totals.waitMax, metrics.waitMax);
+}
+
+} // namespace ecsim
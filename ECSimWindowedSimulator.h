@@ -0,0 +1,175 @@
+//
+//  ECSimWindowedSimulator.h
+//
+//
+//  Windowed simulation for workloads that never end (periodic tasks never finish, so Simulate(-1) runs on and
+//  on): the ticks are cut into windows of a fixed size, and each window is reduced to a few numbers
+//  (utilization, wait-time percentiles, deadline misses) handed to a hook and then dropped, so memory stays the
+//  same however long the simulation runs. Once only periodic tasks are left, the simulator looks for a steady
+//  state: when a whole hyperperiod (the lcm of the periods) repeats the one before it tick by tick, the rest is
+//  extrapolated from it instead of simulated. That only holds for good for policies that look at readiness alone;
+//  for the others the search is off unless asked for.
+//
+//      ECSimWindowedSimulator sim(scheduler, 1000);
+//      sim.AddTask(&task1); ...
+//      sim.SetWindowHook([](const ECSimWindowMetrics &m) { ... });
+//      sim.Simulate(-1);     // stops at the steady state; GetSteadyMetrics() describes one hyperperiod of it
+//
+
+#ifndef ECSimWindowedSimulator_h
+#define ECSimWindowedSimulator_h
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "ECSimTaskScheduler.h"
+
+namespace ecsim
+{
+
+//***********************************************************
+// Metrics of a run of ticks
+
+struct ECSimWindowMetrics
+{
+    ECSimWindowMetrics() : tmStart(0), tmEnd(0), numTicks(0), numBusyTicks(0), tmTotWait(0), numWaits(0), waitP50(0), waitP95(0), waitP99(0), waitMax(0), numReleases(0), numMisses(0) {}
+
+    // Fraction of the ticks in which some task ran
+    double GetUtilization() const { return numTicks > 0 ? (double)numBusyTicks / numTicks : 0.0; }
+
+    // ticks [tmStart, tmEnd]
+    ECSimTime tmStart;
+    ECSimTime tmEnd;
+    long long numTicks;
+    long long numBusyTicks;
+    // ticks waited by all tasks
+    long long tmTotWait;
+    // waits (ticks a task stayed ready without running, until it ran or was no longer ready) that ended in
+    // these ticks, and percentiles of their length; a totals' percentiles are those of the worst window
+    long long numWaits;
+    int waitP50;
+    int waitP95;
+    int waitP99;
+    int waitMax;
+    // releases of tasks with a timing model (see ECSimSchedulability.h) whose deadline fell in these ticks,
+    // and those that didn't get their wcet by it
+    long long numReleases;
+    long long numMisses;
+};
+
+//***********************************************************
+// Windowed simulation over a scheduler
+
+class ECSimWindowedSimulator
+{
+public:
+    // window: ticks per window (at least 1)
+    ECSimWindowedSimulator(ECSimTaskScheduler &schedulerIn, int window);
+
+    // Add a task to the scheduler and follow it
+    void AddTask(ECSimTask *pTask);
+    ECSimTask *AddTask(Task task);
+
+    // Called with the metrics of each window as it closes
+    void SetWindowHook(const std::function<void(const ECSimWindowMetrics &)> &hook) { windowHook = hook; }
+
+    // Look for a steady state (default: on), and the longest hyperperiod worth looking at (default: 65536 ticks).
+    // Policies that only look at which tasks are ready (IsReadinessOnly: FIFO, priority) repeat for good once a
+    // hyperperiod does. Those that weigh run / wait counters (LWTF, round robin, ...) may repeat a hyperperiod while
+    // the gaps between the counters grow, and choose otherwise later: they are only searched with numRepeats > 0,
+    // taking numRepeats repeats in a row as steady at the caller's risk (numRepeats 0: by the policy, as above)
+    void SetSteadyStateDetection(bool fDetectIn, int maxHyperperiodIn = 65536, int numRepeatsIn = 0);
+
+    // Simulate duration ticks (< 0: until no task is left, or until the steady state is reached). Full
+    // hyperperiods after the steady state are extrapolated: they count in the totals but not in the tasks' own
+    // counters nor in any window. Return the ticks covered, simulated or extrapolated
+    long long Simulate(long long duration);
+
+    // Metrics of all ticks covered so far, simulated or extrapolated
+    const ECSimWindowMetrics &GetTotals() const { return totals; }
+
+    // Steady state: reached?, its hyperperiod, the tick it was reached at and the metrics of one hyperperiod of it
+    bool IsSteady() const { return fSteady; }
+    int GetHyperperiod() const { return hyperperiod; }
+    ECSimTime GetSteadyTime() const { return tmSteady; }
+    const ECSimWindowMetrics &GetSteadyMetrics() const { return steady; }
+
+    // Ticks simulated so far, and ticks extrapolated
+    long long GetNumSimulatedTicks() const { return numSimulated; }
+    long long GetNumExtrapolatedTicks() const { return numExtrapolated; }
+
+#ifdef ECSIM_PERF_COUNTERS
+    // Add the phase counters of the scheduler to perf (to print once the run is over); extrapolated ticks cost nothing
+    void AddPerfCounters(ECSimPerfCounters &perf) const { perf.Add(scheduler.GetPerfCounters()); }
+#endif
+
+private:
+    ECSimWindowedSimulator(const ECSimWindowedSimulator &);
+    ECSimWindowedSimulator &operator=(const ECSimWindowedSimulator &);
+
+    // A followed task: its counters at the last tick, the wait under way, and its current release
+    struct TaskInfo
+    {
+        ECSimTask *pTask;
+        ECSimTime tmLastWait;
+        ECSimTime lenWait;
+        bool fModel;
+        int offset;
+        int wcet;
+        int period;
+        int deadline;
+        ECSimTime tmRelease;
+        int numReleaseRuns;
+    };
+
+    // Metrics being gathered, with the lengths of the waits that ended in them
+    struct Accumulator
+    {
+        void Clear(ECSimTime tmStartIn);
+        void Close(ECSimWindowMetrics &metrics, ECSimTime tmEnd);
+
+        ECSimWindowMetrics metrics;
+        std::vector<int> listWaits;
+    };
+
+    void FollowTask(ECSimTask *pTask);
+    void AfterStep(ECSimTime numTicks);
+    void AddWait(ECSimTime len);
+    void CloseWindow();
+    void UpdateCycle(ECSimTime numTicks, int index);
+    void StartCycle();
+    void AddTotals(const ECSimWindowMetrics &metrics, long long times);
+
+    ECSimTaskScheduler &scheduler;
+    int window;
+    std::vector<TaskInfo> listInfo;
+    std::function<void(const ECSimWindowMetrics &)> windowHook;
+
+    Accumulator windowCurr;
+    ECSimWindowMetrics totals;
+    long long numSimulated;
+    long long numExtrapolated;
+
+    // Steady state search: hyperperiods are measured from tmCycleStart (-1: not measuring) and compared by a hash
+    // of their decisions and by their metrics
+    bool fDetect;
+    int maxHyperperiod;
+    int numRepeats;
+    int hyperperiod;
+    ECSimTime tmCycleStart;
+    uint64_t hashCycle;
+    uint64_t hashPrev;
+    int numSame;
+    Accumulator cycleCurr;
+    ECSimWindowMetrics cyclePrev;
+    bool fSteady;
+    ECSimTime tmSteady;
+    ECSimWindowMetrics steady;
+};
+
+} // namespace ecsim
+
+using ecsim::ECSimWindowMetrics;
+using ecsim::ECSimWindowedSimulator;
+
+#endif /* ECSimWindowedSimulator_h */
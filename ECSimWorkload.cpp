@@ -0,0 +1,466 @@
+//
+//  ECSimWorkload.cpp
+//
+//
+//
+
+#include "ECSimWorkload.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+static const char *taskKindNames[EC_NUM_TASK_KINDS] = {"soft", "hard", "consecutive", "periodic", "multi", "interval", "composite"};
+static const char *decoratorNames[EC_NUM_DECORATOR_KINDS] = {"+consecutive", "+periodic", "+start", "+end"};
+
+//***********************************************************
+// Workload
+
+int ECSimWorkload ::GetNumTasks(int kind) const
+{
+    int num = 0;
+    for (const auto &spec : listSpecs)
+    {
+        if (spec.kind == kind)
+        {
+            ++num;
+        }
+    }
+    return num;
+}
+
+const char *ECSimWorkload ::GetKindName(int kind)
+{
+    return taskKindNames[kind];
+}
+
+// One line per task, the kind first:
+//   soft|hard|consecutive <id> <priority> <start> <end>
+//   periodic <id> <priority> <start> <runLen> <sleepLen>
+//   multi <id> <priority> <n> <a1> <b1> ... <an> <bn>
+//   interval <id> <start> <end> [decorators]
+//   composite <id> <n> <line1> ... <linen> [decorators]     (subtasks by line number, starting at 0)
+// Decorators are applied left to right: +consecutive, +periodic=<sleep>, +start=<deadline>, +end=<deadline>
+// Lines starting with # are comments
+string ECSimWorkload ::ToString() const
+{
+    ostringstream out;
+    out << "# ECSim scenario: " << listSpecs.size() << " tasks\n";
+    for (const auto &spec : listSpecs)
+    {
+        out << taskKindNames[spec.kind] << ' ' << spec.id;
+        switch (spec.kind)
+        {
+        case EC_PERIODIC:
+            out << ' ' << spec.priority << ' ' << spec.tmStart << ' ' << spec.runLen << ' ' << spec.sleepLen;
+            break;
+        case EC_MULTI_INTERVALS:
+            out << ' ' << spec.priority << ' ' << spec.listIntervals.size();
+            for (const auto &interval : spec.listIntervals)
+            {
+                out << ' ' << interval.first << ' ' << interval.second;
+            }
+            break;
+        case EC_INTERVAL3:
+            out << ' ' << spec.tmStart << ' ' << spec.tmEnd;
+            break;
+        case EC_COMPOSITE3:
+            out << ' ' << spec.listSubtasks.size();
+            for (int i : spec.listSubtasks)
+            {
+                out << ' ' << i;
+            }
+            break;
+        default:
+            out << ' ' << spec.priority << ' ' << spec.tmStart << ' ' << spec.tmEnd;
+            break;
+        }
+        for (const auto &decor : spec.listDecorators)
+        {
+            out << ' ' << decoratorNames[decor.first];
+            if (decor.first != EC_DECOR_CONSECUTIVE)
+            {
+                out << '=' << decor.second;
+            }
+        }
+        out << '\n';
+    }
+    return out.str();
+}
+
+bool ECSimWorkload ::FromString(const string &text)
+{
+    listSpecs.clear();
+    istringstream in(text);
+    string line;
+    while (getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        istringstream fields(line);
+        string kindName;
+        ECSimTaskSpec spec;
+        fields >> kindName >> spec.id;
+        spec.kind = (int)(find(taskKindNames, taskKindNames + EC_NUM_TASK_KINDS, kindName) - taskKindNames);
+        int num = 0;
+        switch (spec.kind)
+        {
+        case EC_NUM_TASK_KINDS:
+            return false;
+        case EC_PERIODIC:
+            fields >> spec.priority >> spec.tmStart >> spec.runLen >> spec.sleepLen;
+            // the period runLen + sleepLen divides the ticks
+            if (spec.runLen + spec.sleepLen <= 0)
+            {
+                return false;
+            }
+            break;
+        case EC_MULTI_INTERVALS:
+            fields >> spec.priority >> num;
+            // the task ends with its last interval: it needs one
+            if (num <= 0)
+            {
+                return false;
+            }
+            for (int i = 0; i < num && fields; ++i)
+            {
+                int a = 0, b = 0;
+                fields >> a >> b;
+                spec.listIntervals.push_back(make_pair(a, b));
+            }
+            break;
+        case EC_INTERVAL3:
+            fields >> spec.tmStart >> spec.tmEnd;
+            break;
+        case EC_COMPOSITE3:
+            fields >> num;
+            for (int i = 0; i < num && fields; ++i)
+            {
+                int index = -1;
+                fields >> index;
+                // an earlier task, not a subtask of another composite (nor listed twice)
+                if (index < 0 || index >= (int)listSpecs.size() || listSpecs[index].fSubtask)
+                {
+                    return false;
+                }
+                spec.listSubtasks.push_back(index);
+                listSpecs[index].fSubtask = true;
+            }
+            break;
+        default:
+            fields >> spec.priority >> spec.tmStart >> spec.tmEnd;
+            break;
+        }
+        // priorities as tasks keep them (16 bits, see ECSimTaskBase.h)
+        if (!fields || spec.priority < INT16_MIN || spec.priority > INT16_MAX)
+        {
+            return false;
+        }
+        string token;
+        while (fields >> token)
+        {
+            string name = token.substr(0, token.find('='));
+            int decor = (int)(find(decoratorNames, decoratorNames + EC_NUM_DECORATOR_KINDS, name) - decoratorNames);
+            if (decor == EC_NUM_DECORATOR_KINDS)
+            {
+                return false;
+            }
+            int param = 0;
+            if (decor != EC_DECOR_CONSECUTIVE)
+            {
+                if (token.find('=') == string::npos)
+                {
+                    return false;
+                }
+                param = atoi(token.c_str() + token.find('=') + 1);
+            }
+            spec.listDecorators.push_back(make_pair(decor, param));
+        }
+        listSpecs.push_back(spec);
+    }
+    return true;
+}
+
+bool ECSimWorkload ::Save(const string &path) const
+{
+    ofstream out(path.c_str());
+    out << ToString();
+    return (bool)out;
+}
+
+bool ECSimWorkload ::Load(const string &path)
+{
+    ifstream in(path.c_str());
+    if (!in)
+    {
+        return false;
+    }
+    ostringstream text;
+    text << in.rdbuf();
+    return FromString(text.str());
+}
+
+//***********************************************************
+// Generator settings
+
+ECSimWorkloadConfig ::ECSimWorkloadConfig() : seed(1), numTasks(1000), tmHorizon(100000), arrival(EC_ARRIVAL_POISSON), burstFactor(10.0), burstFraction(0.05),
+                                              diurnalPeriod(86400), diurnalAmplitude(0.8), lenMin(1), lenMax(100), probDecorator(0.2), maxSubtasks(4), maxDepth(2)
+{
+    SetGeneration(3);
+    priorityMix.push_back(make_pair(0, 1.0));
+}
+
+void ECSimWorkloadConfig ::SetGeneration(int gen)
+{
+    kindWeights.assign(EC_NUM_TASK_KINDS, 0.0);
+    if (gen == 3)
+    {
+        kindWeights[EC_INTERVAL3] = 0.9;
+        kindWeights[EC_COMPOSITE3] = 0.1;
+    }
+    else
+    {
+        kindWeights[EC_SOFT_INTERVAL] = 0.4;
+        kindWeights[EC_HARD_INTERVAL] = 0.15;
+        kindWeights[EC_CONSECUTIVE_INTERVAL] = 0.15;
+        kindWeights[EC_PERIODIC] = 0.1;
+        kindWeights[EC_MULTI_INTERVALS] = 0.2;
+    }
+}
+
+//***********************************************************
+// Generator
+
+ECSimWorkloadGenerator ::ECSimWorkloadGenerator(const ECSimWorkloadConfig &configIn) : config(configIn), state(configIn.seed), tmArrival(0.0), fInBurst(false), tmBurstEnd(0.0), numIds(0)
+{
+}
+
+// splitmix64
+unsigned long long ECSimWorkloadGenerator ::NextRandom()
+{
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// in [0, 1)
+double ECSimWorkloadGenerator ::Uniform()
+{
+    return (NextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// in [lo, hi]
+int ECSimWorkloadGenerator ::UniformInt(int lo, int hi)
+{
+    if (hi <= lo)
+    {
+        return lo;
+    }
+    return lo + (int)(NextRandom() % (unsigned long long)(hi - lo + 1));
+}
+
+double ECSimWorkloadGenerator ::Exponential(double mean)
+{
+    return -mean * log(1.0 - Uniform());
+}
+
+// Arrival tick of the next task
+int ECSimWorkloadGenerator ::NextArrival()
+{
+    double rate = (double)config.numTasks / config.tmHorizon;
+    if (config.arrival == EC_ARRIVAL_BURSTY)
+    {
+        // two-state modulated Poisson process: short bursts at burstFactor times the average rate, quieter in between
+        double rateBurst = rate * config.burstFactor;
+        double rateQuiet = rate * max(0.0, 1.0 - config.burstFraction * config.burstFactor) / max(1e-9, 1.0 - config.burstFraction);
+        double lenBurst = max(1.0, config.burstFactor / rateBurst);
+        while (true)
+        {
+            if (tmArrival >= tmBurstEnd)
+            {
+                fInBurst = !fInBurst;
+                double lenState = fInBurst ? lenBurst : lenBurst * (1.0 - config.burstFraction) / max(1e-9, config.burstFraction);
+                tmBurstEnd = tmArrival + Exponential(lenState);
+            }
+            double rateNow = fInBurst ? rateBurst : rateQuiet;
+            double tmNext = rateNow > 0.0 ? tmArrival + Exponential(1.0 / rateNow) : tmBurstEnd;
+            if (tmNext < tmBurstEnd)
+            {
+                tmArrival = tmNext;
+                break;
+            }
+            tmArrival = tmBurstEnd;
+        }
+    }
+    else if (config.arrival == EC_ARRIVAL_DIURNAL)
+    {
+        // sinusoidal rate over the day, sampled by thinning
+        double rateMax = rate * (1.0 + config.diurnalAmplitude);
+        while (true)
+        {
+            tmArrival += Exponential(1.0 / rateMax);
+            double phase = 2.0 * 3.14159265358979323846 * tmArrival / config.diurnalPeriod;
+            if (Uniform() * rateMax <= rate * (1.0 + config.diurnalAmplitude * sin(phase)))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        tmArrival += Exponential(1.0 / rate);
+    }
+    return 1 + (int)tmArrival;
+}
+
+int ECSimWorkloadGenerator ::ChooseKind()
+{
+    double total = 0.0;
+    for (double w : config.kindWeights)
+    {
+        total += w;
+    }
+    double x = Uniform() * total;
+    for (int kind = 0; kind < (int)config.kindWeights.size(); ++kind)
+    {
+        x -= config.kindWeights[kind];
+        if (x < 0.0)
+        {
+            return kind;
+        }
+    }
+    return EC_SOFT_INTERVAL;
+}
+
+int ECSimWorkloadGenerator ::ChoosePriority()
+{
+    double total = 0.0;
+    for (const auto &p : config.priorityMix)
+    {
+        total += p.second;
+    }
+    double x = Uniform() * total;
+    for (const auto &p : config.priorityMix)
+    {
+        x -= p.second;
+        if (x < 0.0)
+        {
+            return p.first;
+        }
+    }
+    return 0;
+}
+
+// Decorators in the order of the tests: periodic innermost, then consecutive, then deadlines
+void ECSimWorkloadGenerator ::AddDecorators(ECSimTaskSpec &spec, bool fPeriodic)
+{
+    int len = spec.tmEnd - spec.tmStart + 1;
+    if (fPeriodic && Uniform() < config.probDecorator)
+    {
+        spec.listDecorators.push_back(make_pair((int)EC_DECOR_PERIODIC, UniformInt(1, config.lenMax)));
+    }
+    if (Uniform() < config.probDecorator)
+    {
+        spec.listDecorators.push_back(make_pair((int)EC_DECOR_CONSECUTIVE, 0));
+    }
+    if (Uniform() < config.probDecorator)
+    {
+        spec.listDecorators.push_back(make_pair((int)EC_DECOR_START_DEADLINE, spec.tmStart + UniformInt(0, len)));
+    }
+    if (Uniform() < config.probDecorator)
+    {
+        spec.listDecorators.push_back(make_pair((int)EC_DECOR_END_DEADLINE, spec.tmEnd + UniformInt(-len / 2, config.lenMax)));
+    }
+}
+
+int ECSimWorkloadGenerator ::AddInterval3(ECSimWorkload &workload, int tmStart, bool fSubtask)
+{
+    ECSimTaskSpec spec;
+    spec.kind = EC_INTERVAL3;
+    spec.id = "t" + to_string(numIds++);
+    spec.tmStart = tmStart;
+    spec.tmEnd = tmStart + UniformInt(config.lenMin, config.lenMax) - 1;
+    spec.fSubtask = fSubtask;
+    // periodic subtasks would never let their composite finish
+    AddDecorators(spec, !fSubtask);
+    workload.GetSpecs().push_back(spec);
+    return (int)workload.GetSpecs().size() - 1;
+}
+
+int ECSimWorkloadGenerator ::AddComposite3(ECSimWorkload &workload, int tmStart, int depth, bool fSubtask)
+{
+    ECSimTaskSpec spec;
+    spec.kind = EC_COMPOSITE3;
+    spec.id = "c" + to_string(numIds++);
+    spec.fSubtask = fSubtask;
+    // stages one after another, with gaps
+    int num = UniformInt(2, max(2, config.maxSubtasks));
+    int tmStage = tmStart;
+    for (int i = 0; i < num; ++i)
+    {
+        int index;
+        if (depth + 1 < config.maxDepth && Uniform() < 0.25)
+        {
+            index = AddComposite3(workload, tmStage, depth + 1, true);
+        }
+        else
+        {
+            index = AddInterval3(workload, tmStage, true);
+        }
+        spec.listSubtasks.push_back(index);
+        tmStage += UniformInt(config.lenMin, config.lenMax);
+    }
+    spec.tmStart = tmStart;
+    spec.tmEnd = tmStage;
+    AddDecorators(spec, false);
+    workload.GetSpecs().push_back(spec);
+    return (int)workload.GetSpecs().size() - 1;
+}
+
+void ECSimWorkloadGenerator ::Generate(ECSimWorkload &workload)
+{
+    for (int i = 0; i < config.numTasks; ++i)
+    {
+        int tmStart = NextArrival();
+        int kind = ChooseKind();
+        if (kind == EC_INTERVAL3)
+        {
+            AddInterval3(workload, tmStart, false);
+            continue;
+        }
+        if (kind == EC_COMPOSITE3)
+        {
+            AddComposite3(workload, tmStart, 0, false);
+            continue;
+        }
+        ECSimTaskSpec spec;
+        spec.kind = kind;
+        spec.id = "t" + to_string(numIds++);
+        spec.priority = ChoosePriority();
+        spec.tmStart = tmStart;
+        spec.tmEnd = tmStart + UniformInt(config.lenMin, config.lenMax) - 1;
+        if (kind == EC_PERIODIC)
+        {
+            spec.runLen = spec.tmEnd - spec.tmStart + 1;
+            spec.sleepLen = UniformInt(1, config.lenMax);
+        }
+        else if (kind == EC_MULTI_INTERVALS)
+        {
+            int num = UniformInt(2, 4);
+            int a = tmStart;
+            for (int k = 0; k < num; ++k)
+            {
+                int b = a + UniformInt(config.lenMin, config.lenMax) - 1;
+                spec.listIntervals.push_back(make_pair(a, b));
+                a = b + 1 + UniformInt(1, config.lenMax);
+            }
+            spec.tmEnd = spec.listIntervals.back().second;
+        }
+        workload.GetSpecs().push_back(spec);
+    }
+}
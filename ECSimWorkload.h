@@ -0,0 +1,172 @@
+//
+//  ECSimWorkload.h
+//
+//
+//  Synthetic workloads: a seeded generator of task descriptions (soft, hard,
+//  consecutive, periodic and multi-interval tasks, ECSimTask3 interval tasks
+//  with decorator stacks, and composites), and a text scenario file format.
+//  The descriptions don't depend on either task hierarchy; ECSimWorkloadTasks
+//  (ECSimTask/ECSimTask2) and ECSimWorkloadTasks3 (ECSimTask3) turn them into tasks.
+//
+
+#ifndef ECSimWorkload_h
+#define ECSimWorkload_h
+
+#include <string>
+#include <vector>
+#include <utility>
+
+//***********************************************************
+// Kinds of tasks
+
+enum ECSimTaskKind
+{
+    // ECSimTask/ECSimTask2
+    EC_SOFT_INTERVAL = 0,
+    EC_HARD_INTERVAL,
+    EC_CONSECUTIVE_INTERVAL,
+    EC_PERIODIC,
+    EC_MULTI_INTERVALS,
+    // ECSimTask3
+    EC_INTERVAL3,
+    EC_COMPOSITE3,
+    EC_NUM_TASK_KINDS
+};
+
+// ECSimTask3 decorators
+enum ECSimDecoratorKind
+{
+    EC_DECOR_CONSECUTIVE = 0,
+    EC_DECOR_PERIODIC,
+    EC_DECOR_START_DEADLINE,
+    EC_DECOR_END_DEADLINE,
+    EC_NUM_DECORATOR_KINDS
+};
+
+// Arrival processes
+enum ECSimArrivalKind
+{
+    EC_ARRIVAL_POISSON = 0,
+    EC_ARRIVAL_BURSTY,
+    EC_ARRIVAL_DIURNAL
+};
+
+//***********************************************************
+// Description of one task
+
+struct ECSimTaskSpec
+{
+    ECSimTaskSpec() : kind(EC_SOFT_INTERVAL), priority(0), tmStart(0), tmEnd(0), runLen(0), sleepLen(0), fSubtask(false) {}
+
+    int kind;
+    std::string id;
+    int priority;
+    // interval [tmStart, tmEnd]; periodic: first start in tmStart
+    int tmStart;
+    int tmEnd;
+    // EC_PERIODIC
+    int runLen;
+    int sleepLen;
+    // EC_MULTI_INTERVALS
+    std::vector<std::pair<int, int> > listIntervals;
+    // EC_COMPOSITE3: indices of the subtasks (always earlier in the workload)
+    std::vector<int> listSubtasks;
+    // ECSimTask3 decorators, innermost first: (ECSimDecoratorKind, parameter)
+    std::vector<std::pair<int, int> > listDecorators;
+    // subtask of a composite: not added to the scheduler by itself
+    bool fSubtask;
+};
+
+//***********************************************************
+// A workload: task descriptions in the order they are added to the scheduler
+
+class ECSimWorkload
+{
+public:
+    std::vector<ECSimTaskSpec> &GetSpecs() { return listSpecs; }
+    const std::vector<ECSimTaskSpec> &GetSpecs() const { return listSpecs; }
+
+    // Number of tasks of a kind
+    int GetNumTasks(int kind) const;
+
+    // Name of a kind in scenario files
+    static const char *GetKindName(int kind);
+
+    // Scenario file: one task per line (see ECSimWorkload.cpp); return false on I/O or format errors
+    bool Save(const std::string &path) const;
+    bool Load(const std::string &path);
+    std::string ToString() const;
+    bool FromString(const std::string &text);
+
+private:
+    std::vector<ECSimTaskSpec> listSpecs;
+};
+
+//***********************************************************
+// Generator settings
+
+struct ECSimWorkloadConfig
+{
+    ECSimWorkloadConfig();
+
+    unsigned long long seed;
+    int numTasks;
+    // arrivals are spread over [1, tmHorizon]
+    int tmHorizon;
+    int arrival;
+    // bursty: arrival rate in a burst relative to the average, and fraction of time spent in bursts
+    double burstFactor;
+    double burstFraction;
+    // diurnal: period of the rate cycle and its relative amplitude (0..1)
+    int diurnalPeriod;
+    double diurnalAmplitude;
+    // length of a task's interval (periodic: of its run)
+    int lenMin;
+    int lenMax;
+    // relative weight of each ECSimTaskKind
+    std::vector<double> kindWeights;
+    // (priority, weight) pairs
+    std::vector<std::pair<int, double> > priorityMix;
+    // ECSimTask3: chance of each decorator on an interval task
+    double probDecorator;
+    // composites: at most this many subtasks per level and this many levels
+    int maxSubtasks;
+    int maxDepth;
+
+    // Use only the task kinds of one hierarchy: 2 (ECSimTask/ECSimTask2) or 3 (ECSimTask3)
+    void SetGeneration(int gen);
+};
+
+//***********************************************************
+// Deterministic generator: the same config always gives the same workload.
+// It has its own random source and distributions (std:: distributions differ between libraries)
+
+class ECSimWorkloadGenerator
+{
+public:
+    ECSimWorkloadGenerator(const ECSimWorkloadConfig &config);
+
+    // Generate config.numTasks top-level tasks (composites add their subtasks before them)
+    void Generate(ECSimWorkload &workload);
+
+private:
+    unsigned long long NextRandom();
+    double Uniform();
+    int UniformInt(int lo, int hi);
+    double Exponential(double mean);
+    int NextArrival();
+    int ChooseKind();
+    int ChoosePriority();
+    void AddDecorators(ECSimTaskSpec &spec, bool fPeriodic);
+    int AddInterval3(ECSimWorkload &workload, int tmArrival, bool fSubtask);
+    int AddComposite3(ECSimWorkload &workload, int tmArrival, int depth, bool fSubtask);
+
+    ECSimWorkloadConfig config;
+    unsigned long long state;
+    double tmArrival;
+    bool fInBurst;
+    double tmBurstEnd;
+    int numIds;
+};
+
+#endif /* ECSimWorkload_h */
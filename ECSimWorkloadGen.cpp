@@ -0,0 +1,127 @@
+// Generate a synthetic workload and write it as a scenario file
+// Build: cmake -S . -B build && cmake --build build --target ecsim_workloadgen (see CMakeLists.txt)
+// Usage: workloadgen [--seed N] [--tasks N] [--horizon T] [--gen 2|3] [--arrival poisson|bursty|diurnal]
+//                    [--burst FACTOR FRACTION] [--diurnal PERIOD AMPLITUDE] [--len MIN MAX]
+//                    [--priority P WEIGHT]... [--decorators PROB] [--subtasks MAX DEPTH] [--out FILE]
+
+#include "ECSimWorkload.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+using namespace std;
+
+static void Usage()
+{
+    cerr << "usage: workloadgen [--seed N] [--tasks N] [--horizon T] [--gen 2|3] [--arrival poisson|bursty|diurnal]\n"
+            "                   [--burst FACTOR FRACTION] [--diurnal PERIOD AMPLITUDE] [--len MIN MAX]\n"
+            "                   [--priority P WEIGHT]... [--decorators PROB] [--subtasks MAX DEPTH] [--out FILE]\n";
+}
+
+int main(int argc, char **argv)
+{
+    ECSimWorkloadConfig config;
+    string pathOut;
+    bool fPriorities = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        string opt = argv[i];
+        // number of values each option takes
+        int num = (opt == "--burst" || opt == "--diurnal" || opt == "--len" || opt == "--priority" || opt == "--subtasks") ? 2 : 1;
+        if (i + num >= argc)
+        {
+            Usage();
+            return 1;
+        }
+        const char *arg1 = argv[i + 1];
+        const char *arg2 = num > 1 ? argv[i + 2] : "";
+        if (opt == "--seed")
+            config.seed = strtoull(arg1, NULL, 10);
+        else if (opt == "--tasks")
+            config.numTasks = atoi(arg1);
+        else if (opt == "--horizon")
+            config.tmHorizon = atoi(arg1);
+        else if (opt == "--gen")
+            config.SetGeneration(atoi(arg1));
+        else if (opt == "--arrival")
+        {
+            string name = arg1;
+            if (name == "poisson")
+                config.arrival = EC_ARRIVAL_POISSON;
+            else if (name == "bursty")
+                config.arrival = EC_ARRIVAL_BURSTY;
+            else if (name == "diurnal")
+                config.arrival = EC_ARRIVAL_DIURNAL;
+            else
+            {
+                Usage();
+                return 1;
+            }
+        }
+        else if (opt == "--burst")
+        {
+            config.burstFactor = atof(arg1);
+            config.burstFraction = atof(arg2);
+        }
+        else if (opt == "--diurnal")
+        {
+            config.diurnalPeriod = atoi(arg1);
+            config.diurnalAmplitude = atof(arg2);
+        }
+        else if (opt == "--len")
+        {
+            config.lenMin = atoi(arg1);
+            config.lenMax = atoi(arg2);
+        }
+        else if (opt == "--priority")
+        {
+            if (!fPriorities)
+            {
+                config.priorityMix.clear();
+                fPriorities = true;
+            }
+            config.priorityMix.push_back(make_pair(atoi(arg1), atof(arg2)));
+        }
+        else if (opt == "--decorators")
+            config.probDecorator = atof(arg1);
+        else if (opt == "--subtasks")
+        {
+            config.maxSubtasks = atoi(arg1);
+            config.maxDepth = atoi(arg2);
+        }
+        else if (opt == "--out")
+            pathOut = arg1;
+        else
+        {
+            Usage();
+            return 1;
+        }
+        i += num;
+    }
+    if (config.numTasks <= 0 || config.tmHorizon <= 0 || config.lenMin < 1 || config.lenMax < config.lenMin)
+    {
+        Usage();
+        return 1;
+    }
+
+    ECSimWorkload workload;
+    ECSimWorkloadGenerator gen(config);
+    gen.Generate(workload);
+    if (pathOut.empty())
+    {
+        cout << workload.ToString();
+    }
+    else if (!workload.Save(pathOut))
+    {
+        cerr << "cannot write " << pathOut << endl;
+        return 1;
+    }
+    for (int kind = 0; kind < EC_NUM_TASK_KINDS; ++kind)
+    {
+        int num = workload.GetNumTasks(kind);
+        if (num > 0)
+        {
+            cerr << ECSimWorkload::GetKindName(kind) << ": " << num << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+//
+//  ECSimWorkloadTasks.cpp
+//
+//
+//
+
+#include "ECSimWorkloadTasks.h"
+#include "ECSimTask.h"
+#include "ECSimTask2.h"
+#include "ECSimTask3.h"
+#include "ECSimTaskScheduler.h"
+using namespace std;
+
+// Create the task a spec describes, without its decorators, into a handle of kind THandle
+template <class THandle>
+static THandle MakeTask(const ECSimTaskSpec &spec, const vector<ECSimTask *> &listOuter)
+{
+    switch (spec.kind)
+    {
+    case EC_SOFT_INTERVAL:
+        return THandle(ECSoftIntervalTask(spec.id, spec.tmStart, spec.tmEnd));
+    case EC_HARD_INTERVAL:
+        return THandle(ECHardIntervalTask(spec.id, spec.tmStart, spec.tmEnd));
+    case EC_CONSECUTIVE_INTERVAL:
+        return THandle(ECConsecutiveIntervalTask(spec.id, spec.tmStart, spec.tmEnd));
+    case EC_PERIODIC:
+        return THandle(ECPeriodicTask(spec.id, spec.tmStart, spec.runLen, spec.sleepLen));
+    case EC_MULTI_INTERVALS:
+    {
+        ECMultiIntervalsTask multi(spec.id);
+        for (const auto &interval : spec.listIntervals)
+        {
+            multi.AddInterval(interval.first, interval.second);
+        }
+        return THandle(std::move(multi));
+    }
+    case EC_COMPOSITE3:
+    {
+        // the subtasks are owned by their own specs
+        ECSimCompositeTask composite(spec.id);
+        for (int index : spec.listSubtasks)
+        {
+            composite.AddSubtask(listOuter[index]);
+        }
+        return THandle(std::move(composite));
+    }
+    default:
+        return THandle(ECSimIntervalTask(spec.id, spec.tmStart, spec.tmEnd));
+    }
+}
+
+// Wrap a task in one decorator, into a handle of kind THandle
+template <class THandle>
+static THandle Decorate(const pair<int, int> &decor, ECSimSubtaskHandle task)
+{
+    switch (decor.first)
+    {
+    case EC_DECOR_CONSECUTIVE:
+        return THandle(ECSimConsecutiveTask(std::move(task)));
+    case EC_DECOR_PERIODIC:
+        return THandle(ECSimPeriodicTask(std::move(task), decor.second));
+    case EC_DECOR_START_DEADLINE:
+        return THandle(ECSimStartDeadlineTask(std::move(task), decor.second));
+    default:
+        return THandle(ECSimEndDeadlineTask(std::move(task), decor.second));
+    }
+}
+
+bool ECSimWorkloadTasks ::Build(const ECSimWorkload &workload, ECSimTaskScheduler *pScheduler)
+{
+    const vector<ECSimTaskSpec> &listSpecs = workload.GetSpecs();
+    for (size_t i = 0; i < listSpecs.size(); ++i)
+    {
+        for (int index : listSpecs[i].listSubtasks)
+        {
+            if (index < 0 || index >= (int)i)
+            {
+                return false;
+            }
+        }
+    }
+    // outermost task of each spec; subtasks always come before their composite
+    vector<ECSimTask *> listOuter(listSpecs.size(), NULL);
+    for (size_t i = 0; i < listSpecs.size(); ++i)
+    {
+        const ECSimTaskSpec &spec = listSpecs[i];
+        // each layer is moved into the next, so a plain task with one decorator is a single inline object
+        ecsim::Task task;
+        if (spec.listDecorators.empty())
+        {
+            task = MakeTask<ecsim::Task>(spec, listOuter);
+        }
+        else
+        {
+            ECSimSubtaskHandle inner = MakeTask<ECSimSubtaskHandle>(spec, listOuter);
+            for (size_t k = 0; k + 1 < spec.listDecorators.size(); ++k)
+            {
+                inner = Decorate<ECSimSubtaskHandle>(spec.listDecorators[k], std::move(inner));
+            }
+            task = Decorate<ecsim::Task>(spec.listDecorators.back(), std::move(inner));
+        }
+        listOwned.push_back(std::move(task));
+        ECSimTask *pTask = listOwned.back().Get();
+        pTask->SetPriority(spec.priority);
+        listOuter[i] = pTask;
+        if (!spec.fSubtask)
+        {
+            listTop.push_back(pTask);
+            if (pScheduler != NULL)
+            {
+                pScheduler->AddTask(pTask);
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+//
+//  ECSimWorkloadTasks.h
+//
+//
+//  Build tasks of any kind (ECSimTask/ECSimTask2 tasks, ECSimTask3 decorator
+//  stacks and composites) from a generated or loaded workload
+//
+
+#ifndef ECSimWorkloadTasks_h
+#define ECSimWorkloadTasks_h
+
+#include <vector>
+#include <deque>
+#include "ECSimWorkload.h"
+#include "ECSimTaskHandle.h"
+
+namespace ecsim
+{
+class ECSimTaskScheduler;
+}
+
+class ECSimWorkloadTasks
+{
+public:
+    ECSimWorkloadTasks() {}
+
+    // Create the tasks and add the top-level ones (not subtasks) to the scheduler (if not NULL) in workload order.
+    // Return false (and create nothing) if a composite lists a subtask that doesn't come before it
+    bool Build(const ECSimWorkload &workload, ecsim::ECSimTaskScheduler *pScheduler);
+
+    // Top-level tasks (outermost decorator) in workload order
+    const std::vector<ecsim::ECSimTask *> &GetTasks() const { return listTop; }
+
+private:
+    ECSimWorkloadTasks(const ECSimWorkloadTasks &);
+    ECSimWorkloadTasks &operator=(const ECSimWorkloadTasks &);
+
+    // one task (decorator stack) per spec, held by value; a deque, so tasks stay put as more are added
+    std::deque<ecsim::Task> listOwned;
+    std::vector<ecsim::ECSimTask *> listTop;
+};
+
+#endif /* ECSimWorkloadTasks_h */
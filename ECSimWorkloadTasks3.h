@@ -0,0 +1,13 @@
+//
+//  ECSimWorkloadTasks3.h
+//
+//
+//  ECSimWorkloadTasks builds the ECSimTask3 kinds as well (see ECSimWorkloadTasks.h)
+//
+
+#ifndef ECSimWorkloadTasks3_h
+#define ECSimWorkloadTasks3_h
+
+#include "ECSimWorkloadTasks.h"
+
+#endif /* ECSimWorkloadTasks3_h */